@@ -0,0 +1,341 @@
+#include "AMRGrid.hpp"
+
+AMRChemoGrid::AMRChemoGrid ()
+{
+}
+
+//---------------------------------------------------------------------------------------------
+
+void AMRChemoGrid::Solve(const vector<vector<double> > & sources, const vector<double> & pSrc, const TissueGrid & settings)
+{
+    numberGridsX = settings.numberGridsX ;
+    numberGridsY = settings.numberGridsY ;
+    xDomainMin = settings.xDomainMin ;
+    yDomainMin = settings.yDomainMin ;
+    grid_dx = settings.grid_dx ;
+    grid_dy = settings.grid_dy ;
+    grid_dt = settings.grid_dt ;
+    Diffusion = settings.Diffusion ;
+    maxIterator = settings.maxIterator ;
+    sourceSupport = settings.sourceSupport ;
+    folderName = settings.folderName ;
+    blockSize = max(settings.amrBlockSize, 1) ;
+    coarsening = max(settings.amrCoarsening, 1) ;
+    refineHalo = max(settings.amrRefineHalo, 0) ;
+    nBlocksX = (numberGridsX + blockSize - 1) / blockSize ;
+    nBlocksY = (numberGridsY + blockSize - 1) / blockSize ;
+
+    FindRefinedBlocks(sources) ;
+    InitializeCoarseGrid(sources, pSrc, settings) ;
+    InitializePatches(sources, pSrc) ;
+    EulerMethod() ;
+
+    cout<<"AMR chemo grid: "<<patchBlockI.size()<<" of "<<nBlocksX * nBlocksY<<" blocks refined"<<endl ;
+    ParaViewGrids(0) ;
+    return ;
+}
+
+//---------------------------------------------------------------------------------------------
+
+void AMRChemoGrid::SourceIndex(double x, double y, int & i, int & j) const
+{
+    j = static_cast<int>(round ( ( x - xDomainMin ) / grid_dx ) ) ;
+    j = fmod(j, numberGridsX ) ;
+    i = static_cast<int>(round ( ( y - yDomainMin ) / grid_dy ) ) ;
+    i = fmod(i, numberGridsY ) ;
+}
+
+//---------------------------------------------------------------------------------------------
+
+void AMRChemoGrid::FindRefinedBlocks(const vector<vector<double> > & sources)
+{
+    blockPatch.assign(static_cast<size_t>(nBlocksX) * nBlocksY, -1) ;
+    patchBlockI.clear() ;
+    patchBlockJ.clear() ;
+    int tmpI ;
+    int tmpJ ;
+    for (unsigned int k = 0; k < sources.at(0).size(); k++)
+    {
+        SourceIndex(sources.at(0).at(k), sources.at(1).at(k), tmpI, tmpJ) ;
+        RefineBlocksAround(tmpI, tmpJ) ;
+    }
+}
+
+//---------------------------------------------------------------------------------------------
+
+void AMRChemoGrid::RefineBlocksAround(int i, int j)
+{
+    int bI = i / blockSize ;
+    int bJ = j / blockSize ;
+    for (int m = max(bI - refineHalo, 0) ; m <= min(bI + refineHalo, nBlocksY - 1) ; m++)
+    {
+        for (int n = max(bJ - refineHalo, 0) ; n <= min(bJ + refineHalo, nBlocksX - 1) ; n++)
+        {
+            if (blockPatch[m * nBlocksX + n] == -1)
+            {
+                blockPatch[m * nBlocksX + n] = static_cast<int>(patchBlockI.size()) ;
+                patchBlockI.push_back(m) ;
+                patchBlockJ.push_back(n) ;
+            }
+        }
+    }
+}
+
+//---------------------------------------------------------------------------------------------
+
+//The far field grid covers "coarsening" x "coarsening" fine grids per grid.
+//Production is spread over the coarse grid, so the rate is divided by the area ratio.
+void AMRChemoGrid::InitializeCoarseGrid(const vector<vector<double> > & sources, const vector<double> & pSrc, const TissueGrid & settings)
+{
+    int coarseNX = (numberGridsX + coarsening - 1) / coarsening ;
+    int coarseNY = (numberGridsY + coarsening - 1) / coarsening ;
+    coarse = settings ;
+    coarse.DomainBoundaries(xDomainMin, xDomainMin + coarseNX * coarsening * grid_dx,
+                            yDomainMin, yDomainMin + coarseNY * coarsening * grid_dy, coarseNX, coarseNY) ;
+    // DomainBoundaries scales the time step again. Same stability ratio as the fine grid
+    coarse.grid_dt = grid_dt * coarsening * coarsening ;
+    coarse.InitializeAllGrids() ;
+
+    int tmpI ;
+    int tmpJ ;
+    double areaRatio = 1.0 / (coarsening * coarsening) ;
+    for (unsigned int k = 0; k < pSrc.size(); k++)
+    {
+        SourceIndex(sources.at(0).at(k), sources.at(1).at(k), tmpI, tmpJ) ;
+        coarse.productionRate.at(static_cast<size_t>(tmpI / coarsening) * coarseNX + tmpJ / coarsening) += pSrc.at(k) * areaRatio ;
+    }
+}
+
+//---------------------------------------------------------------------------------------------
+
+void AMRChemoGrid::InitializePatches(const vector<vector<double> > & sources, const vector<double> & pSrc)
+{
+    size_t patchGrids = static_cast<size_t>(blockSize) * blockSize ;
+    size_t nPatches = patchBlockI.size() ;
+    patchValue.assign(nPatches * patchGrids, 0.0) ;
+    patchChange.assign(nPatches * patchGrids, 0.0) ;
+    patchProduction.assign(nPatches * patchGrids, 0.0) ;
+
+    //Every source is inside a refined block
+    int tmpI ;
+    int tmpJ ;
+    for (unsigned int k = 0; k < pSrc.size(); k++)
+    {
+        SourceIndex(sources.at(0).at(k), sources.at(1).at(k), tmpI, tmpJ) ;
+        int patch = blockPatch[ (tmpI / blockSize) * nBlocksX + tmpJ / blockSize ] ;
+        patchProduction[patch * patchGrids + (tmpI % blockSize) * blockSize + tmpJ % blockSize] += pSrc.at(k) ;
+    }
+}
+
+//---------------------------------------------------------------------------------------------
+
+double AMRChemoGrid::FineValue(int i, int j) const
+{
+    int patch = blockPatch[ (i / blockSize) * nBlocksX + j / blockSize ] ;
+    if (patch >= 0)
+    {
+        return patchValue[ static_cast<size_t>(patch) * blockSize * blockSize + (i % blockSize) * blockSize + j % blockSize ] ;
+    }
+    return coarse.value[ static_cast<size_t>(i / coarsening) * coarse.numberGridsX + j / coarsening ] ;
+}
+
+//---------------------------------------------------------------------------------------------
+
+//Same scheme and steady-state condition as TissueGrid::EulerMethod.
+//The far field takes one step for every "coarsening" x "coarsening" steps of the refined blocks, so both
+//cover the same time. Neighbors outside of the refined blocks come from the far field, the domain boundary has no flux.
+//The far field feeds the block boundaries, so it has to be steady at its last step as well
+void AMRChemoGrid::EulerMethod()
+{
+    size_t patchGrids = static_cast<size_t>(blockSize) * blockSize ;
+    size_t nPatches = patchBlockI.size() ;
+    double coeffX = Diffusion * grid_dt / (grid_dx * grid_dx) ;
+    double coeffY = Diffusion * grid_dt / (grid_dy * grid_dy) ;
+    double smallValue = 0.0001 ;
+    int subSteps = coarsening * coarsening ;
+    int l = 0 ;
+    bool status = false ;
+    bool coarseSteady = false ;
+    while (status == false && l < maxIterator)
+    {
+        if (l % subSteps == 0)
+        {
+            coarse.ClearChanges() ;
+            coarse.DiffusionChanges() ;
+            coarse.ProductionChanges() ;
+            coarseSteady = true ;
+            for (size_t k = 0; k < coarse.value.size(); k++)
+            {
+                if (coarse.change[k] / (coarse.value[k] + smallValue) > smallValue * coarse.grid_dt)
+                {
+                    coarseSteady = false ;
+                    break ;
+                }
+            }
+            coarse.UpdateChanges() ;
+        }
+        status = coarseSteady ;
+        for (size_t p = 0; p < nPatches; p++)
+        {
+            for (int li = 0; li < blockSize; li++)
+            {
+                int i = patchBlockI[p] * blockSize + li ;
+                if (i >= numberGridsY)
+                {
+                    break ;
+                }
+                for (int lj = 0; lj < blockSize; lj++)
+                {
+                    int j = patchBlockJ[p] * blockSize + lj ;
+                    if (j >= numberGridsX)
+                    {
+                        break ;
+                    }
+                    size_t k = p * patchGrids + li * blockSize + lj ;
+                    double c = patchValue[k] ;
+                    double tmpChange = 0.0 ;
+                    if (j > 0)                  tmpChange += coeffX * (FineValue(i, j - 1) - c) ;
+                    if (j < numberGridsX - 1)   tmpChange += coeffX * (FineValue(i, j + 1) - c) ;
+                    if (i > 0)                  tmpChange += coeffY * (FineValue(i - 1, j) - c) ;
+                    if (i < numberGridsY - 1)   tmpChange += coeffY * (FineValue(i + 1, j) - c) ;
+                    tmpChange += patchProduction[k] * grid_dt ;
+                    patchChange[k] = tmpChange ;
+                    if (status && tmpChange / (c + smallValue) > smallValue * grid_dt)
+                    {
+                        status = false ;
+                    }
+                }
+            }
+        }
+        for (size_t k = 0; k < patchValue.size(); k++)
+        {
+            patchValue[k] += patchChange[k] ;
+        }
+        l++ ;
+    }
+    coarse.RoundToZero() ;
+    for (size_t k = 0; k < patchValue.size(); k++)
+    {
+        if (patchValue[k] < pow(10, -30) )
+        {
+            patchValue[k] = 0.0 ;
+        }
+    }
+    vector<double>().swap(patchChange) ;
+    vector<double>().swap(coarse.change) ;
+    cout<<l<<endl ;
+    solvedIterations = l ;
+    unitResponse.Clear() ;
+    coarse.solvedIterations = (l + subSteps - 1) / subSteps ;
+    coarse.unitResponse.Clear() ;
+}
+
+//---------------------------------------------------------------------------------------------
+
+void AMRChemoGrid::AddProduction(double x, double y, double pSrc)
+{
+    if (coarse.value.empty() || pSrc == 0.0)
+    {
+        return ;
+    }
+    int tmpI ;
+    int tmpJ ;
+    SourceIndex(x, y, tmpI, tmpJ) ;
+    //The new blocks start from the far field before the source is added to it
+    size_t patchGrids = static_cast<size_t>(blockSize) * blockSize ;
+    size_t oldPatches = patchBlockI.size() ;
+    RefineBlocksAround(tmpI, tmpJ) ;
+    patchValue.resize(patchBlockI.size() * patchGrids, 0.0) ;
+    patchProduction.resize(patchBlockI.size() * patchGrids, 0.0) ;
+    for (size_t p = oldPatches; p < patchBlockI.size(); p++)
+    {
+        for (int li = 0; li < blockSize; li++)
+        {
+            int i = min(patchBlockI[p] * blockSize + li, numberGridsY - 1) ;
+            for (int lj = 0; lj < blockSize; lj++)
+            {
+                int j = min(patchBlockJ[p] * blockSize + lj, numberGridsX - 1) ;
+                patchValue[p * patchGrids + li * blockSize + lj] = coarse.value[ static_cast<size_t>(i / coarsening) * coarse.numberGridsX + j / coarsening ] ;
+            }
+        }
+    }
+    //Far field, spread over its grid as in InitializeCoarseGrid
+    int coarseI = tmpI / coarsening ;
+    int coarseJ = tmpJ / coarsening ;
+    coarse.AddProduction(coarse.xDomainMin + coarseJ * coarse.grid_dx, coarse.yDomainMin + coarseI * coarse.grid_dy, pSrc / (coarsening * coarsening) ) ;
+
+    int patch = blockPatch[ (tmpI / blockSize) * nBlocksX + tmpJ / blockSize ] ;
+    patchProduction[patch * patchGrids + (tmpI % blockSize) * blockSize + tmpJ % blockSize] += pSrc ;
+    if (unitResponse.empty() )
+    {
+        double coeffX = Diffusion * grid_dt / (grid_dx * grid_dx) ;
+        double coeffY = Diffusion * grid_dt / (grid_dy * grid_dy) ;
+        unitResponse.Build(coeffX, coeffY, 0.0, grid_dt, solvedIterations, sourceSupport, 2 * max(numberGridsX, numberGridsY) ) ;
+    }
+    unitResponse.ForWindow(tmpI, tmpJ, numberGridsX, numberGridsY, [&](int i, int j, double tmpResponse)
+    {
+        int tmpPatch = blockPatch[ (i / blockSize) * nBlocksX + j / blockSize ] ;
+        if (tmpPatch < 0)
+        {
+            return ;
+        }
+        double & c = patchValue[ static_cast<size_t>(tmpPatch) * patchGrids + (i % blockSize) * blockSize + j % blockSize ] ;
+        c += pSrc * tmpResponse ;
+        if (c < pow(10, -30) )
+        {
+            c = 0.0 ;
+        }
+    }) ;
+}
+
+//---------------------------------------------------------------------------------------------
+
+//Written at the finest resolution so it can be compared with TissueGrid::ParaViewGrids
+void AMRChemoGrid::ParaViewGrids(int index)
+{
+    string vtkFileName2 = folderName + "GridChemAMR"+ to_string(index)+ ".vtk" ;
+    ofstream SignalOut;
+    SignalOut.open(vtkFileName2.c_str());
+    SignalOut << "# vtk DataFile Version 2.0" << endl;
+    SignalOut << "Result for paraview 2d code" << endl;
+    SignalOut << "ASCII" << endl;
+    SignalOut << "DATASET RECTILINEAR_GRID" << endl;
+    SignalOut << "DIMENSIONS" << " " << numberGridsX  << " " << " " << numberGridsY << " " << 1  << endl;
+
+    SignalOut << "X_COORDINATES " << numberGridsX << " float" << endl;
+    for (int i = 0; i < numberGridsX ; i++) {
+        SignalOut << i * grid_dx << endl;
+    }
+
+    SignalOut << "Y_COORDINATES " << numberGridsY << " float" << endl;
+    for (int j = 0; j < numberGridsY; j++) {
+        SignalOut << j * grid_dy << endl;
+    }
+
+    SignalOut << "Z_COORDINATES " << 1 << " float" << endl;
+    SignalOut << 0 << endl;
+
+    SignalOut << "POINT_DATA " << (numberGridsX )*( numberGridsY ) << endl;
+    SignalOut << "SCALARS trehalose float 1" << endl;
+    SignalOut << "LOOKUP_TABLE default" << endl;
+
+    for (int j = 0; j < numberGridsY; j++) {
+        for (int i = 0; i < numberGridsX ; i++) {
+            SignalOut << FineValue(j, i) << endl;
+        }
+    }
+}
+
+//---------------------------------------------------------------------------------------------
+
+ChemoField AMRChemoGrid::Profile() const
+{
+    ChemoField tmpField(coarse.value.data(), numberGridsX, numberGridsY) ;
+    tmpField.blockPatch = blockPatch.data() ;
+    tmpField.patchData = patchValue.data() ;
+    tmpField.blockSize = blockSize ;
+    tmpField.nBlocksX = nBlocksX ;
+    tmpField.coarsening = coarsening ;
+    tmpField.coarseGridsX = coarse.numberGridsX ;
+    return tmpField ;
+}
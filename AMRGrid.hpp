@@ -0,0 +1,72 @@
+#ifndef AMRGrid_hpp
+#define AMRGrid_hpp
+
+#include "TissueGrid.hpp"
+
+//Block-structured chemoattractant grid.
+//The domain is split into blocks of blockSize x blockSize grids at the resolution of TissueGrid.
+//Blocks around the sources keep that resolution, every other block is represented by a grid that is
+//"coarsening" times coarser. Both levels are advanced together, the refined blocks take their outer
+//boundary from the far field ( one-way nesting).
+class AMRChemoGrid
+{
+public:
+    //---------------------------- Parameters and sub-classes ------------------------------
+    AMRChemoGrid () ;
+    TissueGrid coarse ;             //far field, stepped with the TissueGrid changes functions
+
+    //Finest resolution, same as the uniform TissueGrid
+    int numberGridsX = 0 ;
+    int numberGridsY = 0 ;
+    double xDomainMin = 0 ;
+    double yDomainMin = 0 ;
+    double grid_dx ;
+    double grid_dy ;
+    double grid_dt ;
+    double Diffusion ;
+    int maxIterator ;
+    int solvedIterations = 0 ;      //steps of the refined blocks taken by the last EulerMethod
+    double sourceSupport = 2.0 ;
+    UnitSourceResponse unitResponse ;   //at the finest resolution, the far field keeps its own in coarse
+
+    int blockSize = 16 ;
+    int coarsening = 4 ;
+    int refineHalo = 1 ;
+    int nBlocksX = 0 ;
+    int nBlocksY = 0 ;
+
+    vector<int> blockPatch ;        //patch id of each block, -1 if the block is not refined
+    vector<int> patchBlockI ;       //block row of each patch
+    vector<int> patchBlockJ ;       //block column of each patch
+    //Patch k stores its grids at (k * blockSize * blockSize + local row * blockSize + local column)
+    vector<double> patchValue ;
+    vector<double> patchChange ;
+    vector<double> patchProduction ;
+
+    string folderName ;
+
+    //---------------------------- Functions --------------------------------------------
+
+    //settings has to be set up with DomainBoundaries at the finest resolution
+    void Solve (const vector<vector<double> > & sources, const vector<double> & pSrc, const TissueGrid & settings) ;
+    //Grid of a source at the finest resolution, same index math as TissueGrid::FindProductionPoints
+    void SourceIndex (double x, double y, int & i, int & j) const ;
+    //Mark the blocks that contain a source, and their neighbors, as refined
+    void FindRefinedBlocks (const vector<vector<double> > & sources) ;
+    //Mark the block of grid (i, j) and its neighbors as refined, new patches are added at the end
+    void RefineBlocksAround (int i, int j) ;
+    void InitializeCoarseGrid (const vector<vector<double> > & sources, const vector<double> & pSrc, const TissueGrid & settings) ;
+    void InitializePatches (const vector<vector<double> > & sources, const vector<double> & pSrc) ;
+    //Euler method on both levels, the far field is sub-cycled
+    void EulerMethod () ;
+    //Add a source to the solved profile without solving again ( see TissueGrid::AddProduction). The blocks around
+    //it are refined, starting from the far field, and both levels get the unit response of their own resolution
+    void AddProduction (double x, double y, double pSrc) ;
+    //Concentration at the finest resolution, from a patch if the block is refined
+    double FineValue (int i, int j) const ;
+    void ParaViewGrids (int index) ;
+    ChemoField Profile () const ;
+
+};
+
+#endif /* AMRGrid_hpp */
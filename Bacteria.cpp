@@ -16,14 +16,14 @@ bool bacterium::SourceRegion()
 {
     int numberOfPoints = 0 ;
     bool tmpInsource = false ;
-    if (chemoPointSources.size() != 0)
+    if (chemoPointSources != nullptr && chemoPointSources->size() != 0)
     {
-        numberOfPoints = chemoPointSources.at(0).size() ;
+        numberOfPoints = chemoPointSources->at(0).size() ;
     }
     for (int i=0; i< numberOfPoints; i++)
     {
-        double pointX = chemoPointSources.at(0).at(i) ;
-        double pointY = chemoPointSources.at(1).at(i) ;
+        double pointX = chemoPointSources->at(0).at(i) ;
+        double pointY = chemoPointSources->at(1).at(i) ;
         double r2 = sqrt( pow( (nodes[(nnode-1)/2].x - pointX ) ,2 ) + pow( (nodes[(nnode-1)/2].y - pointY) ,2 ) );
         if (r2< sourceVicinity )
         {
@@ -63,7 +63,12 @@ double MotilityMetabolism::Cal_MethylationEnergy()
 
 double MotilityMetabolism::Cal_LegandEnergy()
 {
-    return LegandEnergy = log(1.0 + legand/ kI) - log(1.0 + legand/ kA) ;
+    LegandEnergy = log(1.0 + legand/ kI) - log(1.0 + legand/ kA) ;
+    for (int s = 1; s < nSpecies; s++)
+    {
+        LegandEnergy += speciesSign[s] * ( log(1.0 + speciesLegand[s]/ species_kI[s]) - log(1.0 + speciesLegand[s]/ species_kA[s]) ) ;
+    }
+    return LegandEnergy ;
 }
 
 double MotilityMetabolism::Cal_ReceptorActivity()
@@ -109,17 +114,25 @@ void MotilityMetabolism::UpdateMotility_FromConfigFile()
     kR = globalConfigVars.getConfigValue("motility_Feedback_kR").toDouble() ;
     kB = globalConfigVars.getConfigValue("motility_Feedback_kB").toDouble() ;
     km = globalConfigVars.getConfigValue("motility_methylEnergyCoeff_km").toDouble() ;
+    nSpecies = min(globalConfigVars.getConfigValue("chemo_NumberSpecies").toInt(), maxChemoSpecies) ;
+    for (int s = 1; s < nSpecies; s++)
+    {
+        string species = "species" + to_string(s) + "_" ;
+        species_kI[s] = globalConfigVars.getConfigValue(species + "kI").toDouble() ;
+        species_kA[s] = globalConfigVars.getConfigValue(species + "kA").toDouble() ;
+        speciesSign[s] = globalConfigVars.getConfigValue(species + "Sign").toDouble() ;
+    }
     
     
 }
 
-double bacterium::LogNormalMaxRunDuration(std::lognormal_distribution<double> &dist, std::default_random_engine &generator , double a, bool calib, double runVal)
+double bacterium::LogNormalMaxRunDuration(const std::lognormal_distribution<double> &dist, RandomStream &random , double a, bool calib, double runVal)
 {
  
     if (calib == true)
     {
         
-    maxRunDuration = 1.0/ a * dist(generator) ;
+    maxRunDuration = 1.0/ a * exp(dist.m() + dist.s() * random.Gaussian() ) ;
     return maxRunDuration ;
     }
     else
@@ -3,6 +3,7 @@
 #define Bacteria_hpp
 
 #include "Nodes.hpp"
+#include "RandomStreams.hpp"
 
 enum MovingDirection
 {
@@ -31,6 +32,12 @@ public:
     double MethylEnergy ;
     double LegandEnergy ;
     bool switchMode = false ;
+    //Other chemicals sensed by the same receptors. Species 0 is legand with kI and kA above
+    int nSpecies = 1 ;
+    double speciesLegand[maxChemoSpecies] = {} ;
+    double species_kI[maxChemoSpecies] = {} ;
+    double species_kA[maxChemoSpecies] = {} ;
+    double speciesSign[maxChemoSpecies] = {} ;     //1 for an attractant, -1 for a repellent
     
     MotilityMetabolism ();
     double Cal_MethylationEnergy ();
@@ -68,14 +75,18 @@ class bacterium
     // Changes with chemotaxis. It is also randomly chosen after each reverse
     double reversalPeriod = 7.0 ;   //This value updates during the simulations
     double internalReversalTimer ;  //Keep track of the duration that the bacteria spent on current run mode
+    //Time steps the current run, wrap and turn started at. The timers are found from them ( see TissueBacteria::Update_EventTimers)
+    long runStartStep = 0 ;
+    long wrapStartStep = 0 ;
+    long turnStartStep = 0 ;
     double maxRunDuration ;
     double protein ;
     bool duplicateIsNeeded ;
     double orientation ;
     
-    //Holding chemoattractnat source locations.
+    //Chemoattractnat source locations, shared by all bacteria ( owned by TissueBacteria).
     //Needed to check if the bacteria is in vicinity of any point sources
-    vector<vector<double> > chemoPointSources ;
+    const vector<vector<double> > * chemoPointSources = nullptr ;
     
     double locVelocity ;
     double locFriction ;
@@ -123,8 +134,8 @@ class bacterium
     //---------------------------- Functions -----------------------------------------
     void initialize_RandomForce () ;
     void UpdateBacteria_FromConfigFile() ;
-    //Update the maximum durations( run and wrap) based on logNormal distribution
-    double LogNormalMaxRunDuration (std::lognormal_distribution<double> &dist, std::default_random_engine &generator , double a, bool calib, double runVal) ;
+    //Update the maximum durations( run and wrap) based on logNormal distribution, drawn from the stream of the bacterium
+    double LogNormalMaxRunDuration (const std::lognormal_distribution<double> &dist, RandomStream &random , double a, bool calib, double runVal) ;
     bacterium () ;
     bool SourceRegion () ;
 };
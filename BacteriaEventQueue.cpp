@@ -0,0 +1,91 @@
+#include "BacteriaEventQueue.hpp"
+
+BacteriaEventQueue::BacteriaEventQueue ()
+{
+}
+
+//---------------------------------------------------------------------------------------------
+
+void BacteriaEventQueue::Initialize(int nBacteria)
+{
+    events = priority_queue<BacteriaEvent, vector<BacteriaEvent>, greater<BacteriaEvent> > () ;
+    version.assign(static_cast<size_t>(nBacteria) * numberEventTypes, 0) ;
+    dueStep.assign(static_cast<size_t>(nBacteria) * numberEventTypes, -1) ;
+    nPending = 0 ;
+}
+
+//---------------------------------------------------------------------------------------------
+
+void BacteriaEventQueue::Schedule(int i, Bacteria_Event_Type type, long step)
+{
+    size_t k = static_cast<size_t>(i) * numberEventTypes + type ;
+    if (dueStep[k] < 0)
+    {
+        nPending++ ;
+    }
+    version[k]++ ;
+    dueStep[k] = step ;
+    events.push(BacteriaEvent{step, i, type, version[k]}) ;
+    if (events.size() > 4 * static_cast<size_t>(nPending) + 64)
+    {
+        Compact() ;
+    }
+}
+
+//---------------------------------------------------------------------------------------------
+
+void BacteriaEventQueue::Cancel(int i, Bacteria_Event_Type type)
+{
+    size_t k = static_cast<size_t>(i) * numberEventTypes + type ;
+    if (dueStep[k] >= 0)
+    {
+        nPending-- ;
+        version[k]++ ;
+        dueStep[k] = -1 ;
+    }
+}
+
+//---------------------------------------------------------------------------------------------
+
+bool BacteriaEventQueue::Pending(int i, Bacteria_Event_Type type) const
+{
+    return dueStep[static_cast<size_t>(i) * numberEventTypes + type] >= 0 ;
+}
+
+//---------------------------------------------------------------------------------------------
+
+void BacteriaEventQueue::PopDue(long step, vector<BacteriaEvent> & due)
+{
+    due.clear() ;
+    while (events.empty() == false && events.top().step <= step)
+    {
+        BacteriaEvent tmpEvent = events.top() ;
+        events.pop() ;
+        size_t k = static_cast<size_t>(tmpEvent.bacterium) * numberEventTypes + tmpEvent.type ;
+        if (tmpEvent.version != version[k])
+        {
+            continue ;
+        }
+        dueStep[k] = -1 ;
+        nPending-- ;
+        due.push_back(tmpEvent) ;
+    }
+}
+
+//---------------------------------------------------------------------------------------------
+
+void BacteriaEventQueue::Compact()
+{
+    vector<BacteriaEvent> tmpEvents ;
+    tmpEvents.reserve(nPending) ;
+    while (events.empty() == false)
+    {
+        const BacteriaEvent & tmpEvent = events.top() ;
+        if (tmpEvent.version == version[static_cast<size_t>(tmpEvent.bacterium) * numberEventTypes + tmpEvent.type])
+        {
+            tmpEvents.push_back(tmpEvent) ;
+        }
+        events.pop() ;
+    }
+    events = priority_queue<BacteriaEvent, vector<BacteriaEvent>, greater<BacteriaEvent> > (greater<BacteriaEvent>(), move(tmpEvents) ) ;
+}
@@ -0,0 +1,60 @@
+#ifndef BacteriaEventQueue_hpp
+#define BacteriaEventQueue_hpp
+
+#include <vector>
+#include <queue>
+#include <functional>
+
+using namespace std ;
+
+enum Bacteria_Event_Type
+{
+    run_end_event = 0 ,         //reverse or start of a wrap when the run period is over
+    wrap_end_event = 1 ,        //unwrap and reverse
+    switch_event = 2 ,          //switchMode was set by the motility metabolism
+    turn_end_event = 3 ,
+    numberEventTypes = 4
+};
+
+struct BacteriaEvent
+{
+    long step ;
+    int bacterium ;
+    int type ;
+    unsigned int version ;
+    //Earlier steps first, then the bacteria in order as they were visited before
+    bool operator> (const BacteriaEvent & other) const
+    {
+        if (step != other.step) return step > other.step ;
+        if (bacterium != other.bacterium) return bacterium > other.bacterium ;
+        return type > other.type ;
+    }
+};
+
+//The next event of every type for every bacterium, ordered by the time step it is due.
+//Scheduling replaces the pending event of the same type. The replaced entry stays in the heap with an old version
+//and is dropped when it reaches the top, so both scheduling and cancelling are O(log N).
+class BacteriaEventQueue
+{
+public:
+    //---------------------------- Parameters and sub-classes ------------------------------
+    BacteriaEventQueue () ;
+    priority_queue<BacteriaEvent, vector<BacteriaEvent>, greater<BacteriaEvent> > events ;
+    vector<unsigned int> version ;          //current version of (bacterium, type)
+    vector<long> dueStep ;                  //-1 if nothing is pending
+    int nPending = 0 ;
+
+    //---------------------------- Functions --------------------------------------------
+    void Initialize (int nBacteria) ;
+    void Schedule (int i, Bacteria_Event_Type type, long step) ;
+    void Cancel (int i, Bacteria_Event_Type type) ;
+    bool Pending (int i, Bacteria_Event_Type type) const ;
+    //Move the events due at or before step to "due", in the order they are handled
+    void PopDue (long step, vector<BacteriaEvent> & due) ;
+
+private:
+    //Rebuild the heap from the pending events once the old entries outnumber them
+    void Compact () ;
+};
+
+#endif /* BacteriaEventQueue_hpp */
@@ -0,0 +1,83 @@
+#ifndef BacteriaOutputColumns_hpp
+#define BacteriaOutputColumns_hpp
+
+#include "FrameStore.hpp"
+
+using namespace std ;
+
+//Columns of the frame stores written by TissueBacteria. The simulator adds the columns from these tables and the
+//analysis tools ( tools/) look them up by the same names, so a column added here is seen by both sides
+struct OutputColumn
+{
+    const char * name ;
+    FrameColumn_Type type ;
+    bool perNode ;                  //nnode values per bacterium
+};
+
+//Columns of the frame store, in the order they are added
+enum StatsColumn
+{
+    stats_x = 0 ,                   //center node
+    stats_y ,
+    stats_velocity ,
+    stats_friction ,
+    stats_orientation ,
+    stats_oldChem ,
+    stats_numberReverse ,
+    stats_mode ,                    //1 forward, 2 wrap, 4 turn
+    stats_maxRunDuration ,
+    stats_receptorActivity ,
+    stats_methylation ,
+    stats_switchProbability ,
+    stats_timeToSource ,
+    stats_timeInSource ,
+    numberStatsColumns
+};
+
+static const OutputColumn statsColumns[numberStatsColumns] =
+{
+    {"x", frameColumn_float64, false} ,
+    {"y", frameColumn_float64, false} ,
+    {"velocity", frameColumn_float64, false} ,
+    {"friction", frameColumn_float64, false} ,
+    {"orientation", frameColumn_float64, false} ,
+    {"oldChem", frameColumn_float64, false} ,
+    {"numberReverse", frameColumn_int32, false} ,
+    {"mode", frameColumn_int32, false} ,
+    {"maxRunDuration", frameColumn_float64, false} ,
+    {"receptorActivity", frameColumn_float64, false} ,
+    {"methylation", frameColumn_float64, false} ,
+    {"switchProbability", frameColumn_float64, false} ,
+    {"timeToSource", frameColumn_float64, false} ,
+    {"timeInSource", frameColumn_float64, false}
+};
+
+//Columns of the frame store of the tracked bacteria
+enum TrackedColumn
+{
+    tracked_id = 0 ,
+    tracked_nodeX ,                 //nnode values per bacterium
+    tracked_nodeY ,
+    tracked_velocity ,
+    tracked_friction ,
+    tracked_orientation ,
+    tracked_oldChem ,
+    tracked_mode ,
+    tracked_switchProbability ,
+    numberTrackedColumns
+};
+
+static const OutputColumn trackedColumns[numberTrackedColumns] =
+{
+    {"id", frameColumn_int32, false} ,
+    {"nodeX", frameColumn_float64, true} ,
+    {"nodeY", frameColumn_float64, true} ,
+    {"velocity", frameColumn_float64, false} ,
+    {"friction", frameColumn_float64, false} ,
+    {"orientation", frameColumn_float64, false} ,
+    {"oldChem", frameColumn_float64, false} ,
+    {"mode", frameColumn_int32, false} ,
+    {"switchProbability", frameColumn_float64, false}
+};
+
+#endif /* BacteriaOutputColumns_hpp */
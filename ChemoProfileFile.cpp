@@ -0,0 +1,148 @@
+#include "ChemoProfileFile.hpp"
+
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static const char chemoProfileMagic[8] = {'C','H','E','M','O','P','R','F'} ;
+static const uint32_t chemoProfileVersion = 1 ;
+
+bool MappedChemoProfile::Open(const string & fileName)
+{
+    mapping.reset() ;
+    header = nullptr ;
+    int fd = open(fileName.c_str(), O_RDONLY) ;
+    if (fd < 0)
+    {
+        return false ;
+    }
+    struct stat fileStat ;
+    if (fstat(fd, &fileStat) != 0 || static_cast<size_t>(fileStat.st_size) < sizeof(ChemoProfileHeader) )
+    {
+        close(fd) ;
+        throw SceException("Chemo profile is too small to have a header: " + fileName, ConfigValueException) ;
+    }
+    size_t bytes = static_cast<size_t>(fileStat.st_size) ;
+    void * base = mmap(nullptr, bytes, PROT_READ, MAP_PRIVATE, fd, 0) ;
+    close(fd) ;
+    if (base == MAP_FAILED)
+    {
+        throw SceException("Could not map chemo profile: " + fileName, ConfigValueException) ;
+    }
+    mapping = shared_ptr<const void>(base, [bytes](const void * p) { munmap(const_cast<void *>(p), bytes) ; }) ;
+
+    const ChemoProfileHeader * tmpHeader = static_cast<const ChemoProfileHeader *>(base) ;
+    if (memcmp(tmpHeader->magic, chemoProfileMagic, sizeof(chemoProfileMagic) ) != 0 || tmpHeader->version != chemoProfileVersion)
+    {
+        mapping.reset() ;
+        throw SceException("Not a binary chemo profile: " + fileName, ConfigValueException) ;
+    }
+    uint64_t dataBytes = static_cast<uint64_t>(tmpHeader->numberGridsX) * tmpHeader->numberGridsY * tmpHeader->bytesPerValue ;
+    if ( (tmpHeader->bytesPerValue != 8 && tmpHeader->bytesPerValue != 4) || tmpHeader->dataOffset % 8 != 0
+        || tmpHeader->dataOffset + dataBytes > bytes)
+    {
+        mapping.reset() ;
+        throw SceException("Corrupted chemo profile: " + fileName, ConfigValueException) ;
+    }
+    header = tmpHeader ;
+    return true ;
+}
+
+const double * MappedChemoProfile::Data() const
+{
+    if (header == nullptr || header->bytesPerValue != 8)
+    {
+        return nullptr ;
+    }
+    return reinterpret_cast<const double *>(static_cast<const char *>(mapping.get() ) + header->dataOffset) ;
+}
+
+const float * MappedChemoProfile::Data32() const
+{
+    if (header == nullptr || header->bytesPerValue != 4)
+    {
+        return nullptr ;
+    }
+    return reinterpret_cast<const float *>(static_cast<const char *>(mapping.get() ) + header->dataOffset) ;
+}
+
+//---------------------------------------------------------------------------------------------
+
+void ConvertChemoProfile_CSVToBinary(const string & csvName, const string & binaryName, bool singlePrecision)
+{
+    ifstream file(csvName.c_str()) ;
+    if (!file.is_open() )
+    {
+        throw SceException("Chemo profile not found: " + csvName, ConfigFileNotFound) ;
+    }
+    vector<double> values ;
+    int64_t nX = -1 ;
+    int64_t nY = 0 ;
+    string line ;
+    while (getline(file, line) )
+    {
+        const char * p = line.c_str() ;
+        char * end ;
+        int64_t nRow = 0 ;
+        while (true)
+        {
+            double tmpValue = strtod(p, &end) ;
+            if (end == p)
+            {
+                break ;
+            }
+            values.push_back(tmpValue) ;
+            nRow++ ;
+            p = end ;
+            while (*p == ',' || *p == ' ' || *p == '\r')
+            {
+                p++ ;
+            }
+        }
+        if (nRow == 0)
+        {
+            continue ;
+        }
+        if (nX >= 0 && nRow != nX)
+        {
+            throw SceException("Rows of different length in chemo profile: " + csvName, ConfigValueException) ;
+        }
+        nX = nRow ;
+        nY++ ;
+    }
+
+    ChemoProfileHeader tmpHeader ;
+    memset(&tmpHeader, 0, sizeof(tmpHeader) ) ;
+    memcpy(tmpHeader.magic, chemoProfileMagic, sizeof(chemoProfileMagic) ) ;
+    tmpHeader.version = chemoProfileVersion ;
+    tmpHeader.bytesPerValue = singlePrecision ? 4 : 8 ;
+    tmpHeader.numberGridsX = max<int64_t>(nX, 0) ;
+    tmpHeader.numberGridsY = nY ;
+    tmpHeader.dataOffset = (sizeof(ChemoProfileHeader) + 7) / 8 * 8 ;
+
+    ofstream out(binaryName.c_str(), ios::binary) ;
+    if (!out.is_open() )
+    {
+        throw SceException("Could not write chemo profile: " + binaryName, ConfigFileNotFound) ;
+    }
+    out.write(reinterpret_cast<const char *>(&tmpHeader), sizeof(tmpHeader) ) ;
+    for (size_t k = sizeof(tmpHeader); k < tmpHeader.dataOffset; k++)
+    {
+        out.put(0) ;
+    }
+    if (singlePrecision)
+    {
+        vector<float> tmpValues(values.begin(), values.end() ) ;
+        out.write(reinterpret_cast<const char *>(tmpValues.data() ), tmpValues.size() * sizeof(float) ) ;
+    }
+    else
+    {
+        out.write(reinterpret_cast<const char *>(values.data() ), values.size() * sizeof(double) ) ;
+    }
+    cout<<"Converted chemo profile "<<csvName<<" ("<<nX<<" x "<<nY<<") to "<<binaryName<<endl ;
+}
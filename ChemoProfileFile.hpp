@@ -0,0 +1,46 @@
+#ifndef ChemoProfileFile_hpp
+#define ChemoProfileFile_hpp
+
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <string>
+#include "commonData.h"
+
+using namespace std ;
+
+//Binary chemoattractant profile. The header is followed by numberGridsY rows of numberGridsX values
+//(float64 or float32) starting at dataOffset, the same row-major order as TissueGrid::value.
+struct ChemoProfileHeader
+{
+    char magic[8] ;                 //"CHEMOPRF"
+    uint32_t version ;
+    uint32_t bytesPerValue ;        //8 for float64, 4 for float32
+    int64_t numberGridsX ;
+    int64_t numberGridsY ;
+    uint64_t dataOffset ;
+};
+
+//Read-only memory map of a binary profile. Copies share the same mapping, it is released with the last copy.
+class MappedChemoProfile
+{
+public:
+    //Returns false if the file does not exist, throws if it is not a valid profile
+    bool Open (const string & fileName) ;
+    bool IsOpen () const { return header != nullptr ; }
+    int NumberGridsX () const { return static_cast<int>(header->numberGridsX) ; }
+    int NumberGridsY () const { return static_cast<int>(header->numberGridsY) ; }
+    //Values of a float64 profile, used in place. nullptr for float32 profiles
+    const double * Data () const ;
+    //Values of a float32 profile. nullptr for float64 profiles
+    const float * Data32 () const ;
+
+private:
+    shared_ptr<const void> mapping ;
+    const ChemoProfileHeader * header = nullptr ;
+};
+
+//One-time conversion of a comma separated profile ( one grid row per line) to the binary format
+void ConvertChemoProfile_CSVToBinary (const string & csvName, const string & binaryName, bool singlePrecision = false) ;
+
+#endif /* ChemoProfileFile_hpp */
@@ -0,0 +1,238 @@
+#include "ChemoSpeciesGrid.hpp"
+
+ChemoSpeciesGrid::ChemoSpeciesGrid ()
+{
+}
+
+//---------------------------------------------------------------------------------------------
+
+void ChemoSpeciesGrid::DomainBoundaries(double xMin, double xMax, double yMin, double yMax, int nGridX , int nGridY)
+{
+    xDomainMin = xMin ;
+    yDomainMin = yMin ;
+    numberGridsX = nGridX ;
+    numberGridsY = nGridY ;
+    grid_dx = static_cast<double> ( ( xMax - xMin ) / numberGridsX ) ;
+    grid_dy = static_cast<double> ( ( yMax - yMin ) / numberGridsY ) ;
+    //The fastest species sets the stable time step
+    grid_dt = timeStep / *max_element(Diffusion.begin(), Diffusion.end() ) ;
+}
+
+//---------------------------------------------------------------------------------------------
+
+void ChemoSpeciesGrid::InitializeAllGrids()
+{
+    size_t nValues = static_cast<size_t>(numberGridsX) * numberGridsY * cellStride ;
+    value.assign(nValues, 0.0) ;
+    change.assign(nValues, 0.0) ;
+    productionRate.assign(nValues, 0.0) ;
+}
+
+//---------------------------------------------------------------------------------------------
+
+//Same index math as TissueGrid::FindProductionPoints, every species is produced at the hyphal sources
+void ChemoSpeciesGrid::FindProductionPoints(const vector<vector<double> > & sources, const vector<double> & pSrc)
+{
+    int tmpIndexX ;
+    int tmpIndexY ;
+    for (unsigned int k = 0; k < pSrc.size(); k++)
+    {
+        tmpIndexX = static_cast<int>(round ( ( sources.at(0).at(k) - xDomainMin ) / grid_dx ) ) ;
+        tmpIndexX = fmod(tmpIndexX, numberGridsX ) ;
+        tmpIndexY = static_cast<int>(round ( ( sources.at(1).at(k) - yDomainMin ) / grid_dy ) ) ;
+        tmpIndexY = fmod(tmpIndexY, numberGridsY ) ;
+        size_t cell = (static_cast<size_t>(tmpIndexY) * numberGridsX + tmpIndexX) * cellStride ;
+        for (int s = 0; s < nSpecies; s++)
+        {
+            productionRate[cell + s] += pSrc.at(k) * productionScale.at(s) ;
+        }
+    }
+}
+
+//---------------------------------------------------------------------------------------------
+
+//Same scheme and steady-state condition as TissueGrid::EulerMethod. The loop over species is innermost
+//and the species of a grid are contiguous, so the neighbors are read once per sweep for all species.
+void ChemoSpeciesGrid::EulerMethod()
+{
+    double coeffX[maxChemoSpecies] ;
+    double coeffY[maxChemoSpecies] ;
+    double degDt[maxChemoSpecies] ;
+    for (int s = 0; s < nSpecies; s++)
+    {
+        coeffX[s] = Diffusion[s] * grid_dt / (grid_dx * grid_dx) ;
+        coeffY[s] = Diffusion[s] * grid_dt / (grid_dy * grid_dy) ;
+        degDt[s] = deg[s] * grid_dt ;
+    }
+    size_t rowStride = static_cast<size_t>(numberGridsX) * cellStride ;
+    double smallValue = 0.0001 ;
+    int l = 0 ;
+    bool status = false ;
+    while (status == false && l < maxIterator)
+    {
+        status = true ;
+        #pragma omp parallel for reduction(&& : status)
+        for (int i = 0; i < numberGridsY; i++)
+        {
+            for (int j = 0; j < numberGridsX; j++)
+            {
+                size_t cell = static_cast<size_t>(i) * rowStride + static_cast<size_t>(j) * cellStride ;
+                const double * c = &value[cell] ;
+                const double * left = (j > 0) ? c - cellStride : nullptr ;
+                const double * right = (j < numberGridsX - 1) ? c + cellStride : nullptr ;
+                const double * down = (i > 0) ? c - rowStride : nullptr ;
+                const double * up = (i < numberGridsY - 1) ? c + rowStride : nullptr ;
+                for (int s = 0; s < nSpecies; s++)
+                {
+                    double tmpChange = productionRate[cell + s] * grid_dt - degDt[s] * c[s] ;
+                    if (left)   tmpChange += coeffX[s] * (left[s] - c[s]) ;
+                    if (right)  tmpChange += coeffX[s] * (right[s] - c[s]) ;
+                    if (down)   tmpChange += coeffY[s] * (down[s] - c[s]) ;
+                    if (up)     tmpChange += coeffY[s] * (up[s] - c[s]) ;
+                    change[cell + s] = tmpChange ;
+                    if (tmpChange / (c[s] + smallValue) > smallValue * grid_dt)
+                    {
+                        status = false ;
+                    }
+                }
+            }
+        }
+        for (size_t k = 0; k < value.size(); k++)
+        {
+            value[k] += change[k] ;
+        }
+        l++ ;
+    }
+    for (size_t k = 0; k < value.size(); k++)
+    {
+        if (value[k] < pow(10, -30) )
+        {
+            value[k] = 0.0 ;
+        }
+    }
+    ParaViewGrids(l/100) ;
+    cout<<l<<endl ;
+    solvedIterations = l ;
+    unitResponse.assign(nSpecies, UnitSourceResponse() ) ;
+    decltype(change)().swap(change) ;
+}
+
+//---------------------------------------------------------------------------------------------
+
+void ChemoSpeciesGrid::AddProduction(double x, double y, double pSrc)
+{
+    if (value.empty() || pSrc == 0.0)
+    {
+        return ;
+    }
+    int tmpIndexX = static_cast<int>(round ( ( x - xDomainMin ) / grid_dx ) ) ;
+    tmpIndexX = fmod(tmpIndexX, numberGridsX ) ;
+    int tmpIndexY = static_cast<int>(round ( ( y - yDomainMin ) / grid_dy ) ) ;
+    tmpIndexY = fmod(tmpIndexY, numberGridsY ) ;
+    size_t sourceCell = (static_cast<size_t>(tmpIndexY) * numberGridsX + tmpIndexX) * cellStride ;
+    for (int s = 0; s < nSpecies; s++)
+    {
+        double tmpRate = pSrc * productionScale.at(s) ;
+        productionRate[sourceCell + s] += tmpRate ;
+        UnitSourceResponse & response = unitResponse.at(s) ;
+        if (response.empty() )
+        {
+            double coeffX = Diffusion[s] * grid_dt / (grid_dx * grid_dx) ;
+            double coeffY = Diffusion[s] * grid_dt / (grid_dy * grid_dy) ;
+            response.Build(coeffX, coeffY, deg[s] * grid_dt, grid_dt, solvedIterations, sourceSupport, 2 * max(numberGridsX, numberGridsY) ) ;
+        }
+        response.ForWindow(tmpIndexY, tmpIndexX, numberGridsX, numberGridsY, [&](int i, int j, double tmpResponse)
+        {
+            double & c = value[(static_cast<size_t>(i) * numberGridsX + j) * cellStride + s] ;
+            c += tmpRate * tmpResponse ;
+            if (c < pow(10, -30) )
+            {
+                c = 0.0 ;
+            }
+        }) ;
+    }
+}
+
+//---------------------------------------------------------------------------------------------
+
+ChemoField ChemoSpeciesGrid::Profile(int species) const
+{
+    ChemoField tmpField(value.data() + species, numberGridsX, numberGridsY) ;
+    tmpField.stride = cellStride ;
+    return tmpField ;
+}
+
+//---------------------------------------------------------------------------------------------
+
+void ChemoSpeciesGrid::ParaViewGrids(int index)
+{
+    string vtkFileName2 = folderName + "GridChemSpecies"+ to_string(index)+ ".vtk" ;
+    ofstream SignalOut;
+    SignalOut.open(vtkFileName2.c_str());
+    SignalOut << "# vtk DataFile Version 2.0" << endl;
+    SignalOut << "Result for paraview 2d code" << endl;
+    SignalOut << "ASCII" << endl;
+    SignalOut << "DATASET RECTILINEAR_GRID" << endl;
+    SignalOut << "DIMENSIONS" << " " << numberGridsX  << " " << " " << numberGridsY << " " << 1  << endl;
+
+    SignalOut << "X_COORDINATES " << numberGridsX << " float" << endl;
+    for (int i = 0; i < numberGridsX ; i++) {
+        SignalOut << i * grid_dx << endl;
+    }
+
+    SignalOut << "Y_COORDINATES " << numberGridsY << " float" << endl;
+    for (int j = 0; j < numberGridsY; j++) {
+        SignalOut << j * grid_dy << endl;
+    }
+
+    SignalOut << "Z_COORDINATES " << 1 << " float" << endl;
+    SignalOut << 0 << endl;
+
+    SignalOut << "POINT_DATA " << (numberGridsX )*( numberGridsY ) << endl;
+    for (int s = 0; s < nSpecies; s++) {
+        SignalOut << "SCALARS species" << s << " float 1" << endl;
+        SignalOut << "LOOKUP_TABLE default" << endl;
+        for (int j = 0; j < numberGridsY; j++) {
+            for (int i = 0; i < numberGridsX ; i++) {
+                SignalOut << Cell(j, i)[s] << endl;
+            }
+        }
+    }
+}
+
+//---------------------------------------------------------------------------------------------
+
+void ChemoSpeciesGrid::UpdateSpecies_FromConfigFile(const TissueGrid & tissue)
+{
+    nSpecies = globalConfigVars.getConfigValue("chemo_NumberSpecies").toInt() ;
+    if (nSpecies < 1 || nSpecies > maxChemoSpecies)
+    {
+        throw SceException("chemo_NumberSpecies has to be between 1 and " + to_string(maxChemoSpecies), ConfigValueException) ;
+    }
+    //The species are solved on the uniform grid only, AMRChemoGrid has a single field
+    if (nSpecies > 1 && tissue.amrRefinement)
+    {
+        throw SceException("grid_AMR can not be used with more than one chemo species", ConfigValueException) ;
+    }
+    cellStride = 1 ;
+    while (cellStride < nSpecies)
+    {
+        cellStride *= 2 ;
+    }
+    timeStep = globalConfigVars.getConfigValue("grid_timeStep").toDouble() ;
+    maxIterator = tissue.maxIterator ;
+    sourceSupport = tissue.sourceSupport ;
+    folderName = tissue.folderName ;
+
+    //TissueGrid::EulerMethod does not degrade the chemoattractant
+    Diffusion.assign(1, tissue.Diffusion) ;
+    deg.assign(1, 0.0) ;
+    productionScale.assign(1, 1.0) ;
+    for (int s = 1; s < nSpecies; s++)
+    {
+        string species = "species" + to_string(s) + "_" ;
+        Diffusion.push_back(globalConfigVars.getConfigValue(species + "DiffusionCoeff").toDouble() ) ;
+        deg.push_back(globalConfigVars.getConfigValue(species + "degradationRate").toDouble() ) ;
+        productionScale.push_back(globalConfigVars.getConfigValue(species + "productionScale").toDouble() ) ;
+    }
+}
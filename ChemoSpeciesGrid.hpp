@@ -0,0 +1,72 @@
+#ifndef ChemoSpeciesGrid_hpp
+#define ChemoSpeciesGrid_hpp
+
+#include <cstdint>
+#include <new>
+#include "Nodes.hpp"
+#include "TissueGrid.hpp"
+
+//Allocator for the species grids, so that a grid never straddles two cache lines
+template <class T>
+struct CacheLineAllocator
+{
+    typedef T value_type ;
+    CacheLineAllocator () {}
+    template <class U> CacheLineAllocator (const CacheLineAllocator<U> &) {}
+    T * allocate (size_t n) { return static_cast<T *>(::operator new(n * sizeof(T), align_val_t(64) ) ) ; }
+    void deallocate (T * p, size_t) { ::operator delete(p, align_val_t(64) ) ; }
+    template <class U> bool operator == (const CacheLineAllocator<U> &) const { return true ; }
+    template <class U> bool operator != (const CacheLineAllocator<U> &) const { return false ; }
+};
+
+//Several chemicals on the same grids. The species of a grid are stored next to each other, index is
+//((i * numberGridsX + j) * cellStride + species), so one stencil sweep updates all of them and a bacterium
+//reads every ligand of its grid from one cache line. Species 0 is the chemoattractant of TissueGrid.
+class ChemoSpeciesGrid
+{
+public:
+    //---------------------------- Parameters and sub-classes ------------------------------
+    ChemoSpeciesGrid () ;
+    int nSpecies = 1 ;
+    int cellStride = 1 ;                //nSpecies rounded up to a power of two
+    vector<double, CacheLineAllocator<double> > value ;
+    vector<double, CacheLineAllocator<double> > change ;       //Only needed while solving
+    vector<double, CacheLineAllocator<double> > productionRate ;
+
+    double xDomainMin = 0 ;
+    double yDomainMin = 0 ;
+    int numberGridsX = 200 ;
+    int numberGridsY = 200 ;
+    double grid_dx ;
+    double grid_dy ;
+    double timeStep = 5.0 ;             //same meaning as grid_timeStep, divided by the largest diffusion coefficient
+    double grid_dt ;
+    int maxIterator = 100 ;
+    int solvedIterations = 0 ;          //Euler steps taken by the last EulerMethod
+    double sourceSupport = 2.0 ;        //same as TissueGrid::sourceSupport
+    string folderName ;
+
+    //Per species parameters
+    vector<double> Diffusion ;
+    vector<double> deg ;
+    vector<double> productionScale ;    //production of a species relative to the hyphal source rates
+    vector<UnitSourceResponse> unitResponse ;
+
+    //---------------------------- Functions --------------------------------------------
+    void DomainBoundaries (double xMin, double xMax, double yMin, double yMax, int nGridX , int nGridY) ;
+    void InitializeAllGrids () ;
+    void FindProductionPoints (const vector<vector<double> > & sources, const vector<double> & pSrc) ;
+    //Diffusion, degradation and production of all species in one sweep
+    void EulerMethod () ;
+    //Add a source to the solved species, same as TissueGrid::AddProduction with the degradation of each species
+    void AddProduction (double x, double y, double pSrc) ;
+    //Species of grid (i, j), cellStride values starting at species 0
+    const double * Cell (int i, int j) const { return value.data() + (static_cast<size_t>(i) * numberGridsX + j) * cellStride ; }
+    ChemoField Profile (int species) const ;
+    void ParaViewGrids (int index) ;
+    //Species 0 takes its parameters from tissue
+    void UpdateSpecies_FromConfigFile (const TissueGrid & tissue) ;
+
+};
+
+#endif /* ChemoSpeciesGrid_hpp */
@@ -0,0 +1,143 @@
+#include "CoarseField.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+static const char coarseFieldMagic[8] = {'C','O','A','R','S','E','F','D'} ;
+static const uint32_t coarseFieldVersion = 1 ;
+
+CoarseFieldBinner::CoarseFieldBinner ()
+{
+}
+
+//---------------------------------------------------------------------------------------------
+
+void CoarseFieldBinner::Initialize(int tmpNx, int tmpNy, double tmpDomainX, double tmpDomainY, int nBacteria, double tmpInterval)
+{
+    nx = tmpNx ;
+    ny = tmpNy ;
+    domainX = tmpDomainX ;
+    domainY = tmpDomainY ;
+    interval = tmpInterval ;
+    nSamples = 0 ;
+    hasLast = false ;
+    lastX.assign(nBacteria, 0.0) ;
+    lastY.assign(nBacteria, 0.0) ;
+    int nThreads = 1 ;
+#ifdef _OPENMP
+    nThreads = omp_get_max_threads() ;
+#endif
+    tiles.assign(nThreads, vector<Cell>(nx * ny) ) ;
+    field.resize(4 * nx * ny) ;
+}
+
+//---------------------------------------------------------------------------------------------
+
+void CoarseFieldBinner::Sample(const double * x, const double * y, const double * orientationX, const double * orientationY)
+{
+    int nBacteria = static_cast<int>(lastX.size() ) ;
+    #pragma omp parallel
+    {
+        int thread = 0 ;
+#ifdef _OPENMP
+        //the team can be larger than at Initialize ( omp_set_num_threads), every thread still gets a tile of its own.
+        //Tiles are only added, the samples already binned stay until the frame is written
+        #pragma omp single
+        {
+            if (static_cast<int>(tiles.size() ) < omp_get_num_threads() )
+            {
+                tiles.resize(omp_get_num_threads(), vector<Cell>(nx * ny) ) ;
+            }
+        }
+        thread = omp_get_thread_num() ;
+#endif
+        vector<Cell> & tile = tiles[thread] ;
+        #pragma omp for
+        for (int i = 0; i < nBacteria; i++)
+        {
+            //the positions are not wrapped, the grid is periodic
+            double tmpX = fmod(fmod(x[i], domainX) + domainX, domainX) ;
+            double tmpY = fmod(fmod(y[i], domainY) + domainY, domainY) ;
+            int m = min(static_cast<int>(tmpX / domainX * nx), nx - 1) ;
+            int n = min(static_cast<int>(tmpY / domainY * ny), ny - 1) ;
+            Cell & cell = tile[n * nx + m] ;
+            cell.count += 1.0 ;
+            cell.ox += orientationX[i] ;
+            cell.oy += orientationY[i] ;
+            if (hasLast)
+            {
+                cell.velocityCount += 1.0 ;
+                cell.vx += (x[i] - lastX[i]) / interval ;
+                cell.vy += (y[i] - lastY[i]) / interval ;
+            }
+            lastX[i] = x[i] ;
+            lastY[i] = y[i] ;
+        }
+    }
+    hasLast = true ;
+    nSamples++ ;
+}
+
+//---------------------------------------------------------------------------------------------
+
+void CoarseFieldBinner::Write(const string & fileName, double time)
+{
+    if (IsActive() == false)
+    {
+        return ;
+    }
+    int nCells = nx * ny ;
+    float * density = &field[0] ;
+    float * velocityX = &field[nCells] ;
+    float * velocityY = &field[2 * nCells] ;
+    float * polarOrder = &field[3 * nCells] ;
+    int nTiles = static_cast<int>(tiles.size() ) ;
+    #pragma omp parallel for
+    for (int c = 0; c < nCells; c++)
+    {
+        Cell sum ;
+        for (int t = 0; t < nTiles; t++)
+        {
+            Cell & cell = tiles[t][c] ;
+            sum.count += cell.count ;
+            sum.velocityCount += cell.velocityCount ;
+            sum.vx += cell.vx ;
+            sum.vy += cell.vy ;
+            sum.ox += cell.ox ;
+            sum.oy += cell.oy ;
+            cell = Cell() ;
+        }
+        density[c] = nSamples > 0 ? static_cast<float>(sum.count / nSamples) : 0.0f ;
+        velocityX[c] = sum.velocityCount > 0.0 ? static_cast<float>(sum.vx / sum.velocityCount) : 0.0f ;
+        velocityY[c] = sum.velocityCount > 0.0 ? static_cast<float>(sum.vy / sum.velocityCount) : 0.0f ;
+        polarOrder[c] = sum.count > 0.0 ? static_cast<float>(sqrt(sum.ox * sum.ox + sum.oy * sum.oy) / sum.count) : 0.0f ;
+    }
+
+    CoarseFieldHeader header ;
+    memcpy(header.magic, coarseFieldMagic, sizeof(coarseFieldMagic) ) ;
+    header.version = coarseFieldVersion ;
+    header.nx = nx ;
+    header.ny = ny ;
+    header.nSamples = nSamples ;
+    header.domainX = domainX ;
+    header.domainY = domainY ;
+    header.time = time ;
+    header.interval = interval ;
+    nSamples = 0 ;
+
+    FILE * file = fopen(fileName.c_str(), "wb") ;
+    if (file == nullptr)
+    {
+        cout<<"Could not open coarse field "<<fileName<<endl ;
+        return ;
+    }
+    fwrite(&header, sizeof(header), 1, file) ;
+    fwrite(field.data(), sizeof(float), field.size(), file) ;
+    fclose(file) ;
+    framesWritten++ ;
+}
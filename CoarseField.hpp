@@ -0,0 +1,67 @@
+#ifndef CoarseField_hpp
+#define CoarseField_hpp
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+using namespace std ;
+
+//File of one frame: CoarseFieldHeader, then nx * ny float32 values ( cell n * nx + m) of the density, the mean
+//velocity x, y and the polar order, one array after the other
+struct CoarseFieldHeader
+{
+    char magic[8] ;                 //"COARSEFD"
+    uint32_t version ;
+    uint32_t nx ;
+    uint32_t ny ;
+    uint32_t nSamples ;             //samples averaged in the frame
+    double domainX ;
+    double domainY ;
+    double time ;
+    double interval ;               //time between samples
+};
+
+//Density, mean velocity and polar order of the bacteria on a coarse periodic grid, averaged over the samples of a
+//frame. Every thread bins its bacteria into its own full-size tile, the tiles are only summed when the frame is written.
+//The velocity is the displacement of the center since the previous sample, the polar order |sum of the unit
+//orientations| / number of bacteria of the cell
+class CoarseFieldBinner
+{
+public:
+    //---------------------------- Parameters and sub-classes ------------------------------
+    CoarseFieldBinner () ;
+    long framesWritten = 0 ;
+
+    //---------------------------- Functions --------------------------------------------
+    void Initialize (int tmpNx, int tmpNy, double tmpDomainX, double tmpDomainY, int nBacteria, double tmpInterval) ;
+    bool IsActive () const { return tiles.empty() == false ; }
+    //center position and unit orientation of every bacterium
+    void Sample (const double * x, const double * y, const double * orientationX, const double * orientationY) ;
+    //Write the average of the samples since the last frame and start a new one
+    void Write (const string & fileName, double time) ;
+
+private:
+    struct Cell
+    {
+        double count = 0.0 ;
+        double velocityCount = 0.0 ;  //bacteria with a previous sample
+        double vx = 0.0 ;
+        double vy = 0.0 ;
+        double ox = 0.0 ;
+        double oy = 0.0 ;
+    };
+    int nx = 0 ;
+    int ny = 0 ;
+    double domainX = 0.0 ;
+    double domainY = 0.0 ;
+    double interval = 0.0 ;
+    uint32_t nSamples = 0 ;
+    bool hasLast = false ;
+    vector<double> lastX ;
+    vector<double> lastY ;
+    vector<vector<Cell> > tiles ;   //one per thread
+    vector<float> field ;
+};
+
+#endif /* CoarseField_hpp */
@@ -127,18 +127,17 @@ std::string ConfigParser::removeLeadingAndTrailingSpace(const std::string& str,
 	return str.substr(strBegin, strRange);
 }
 
+// Only the first equal sign separates the name, so values such as file names may contain it.
 std::vector<std::string> ConfigParser::splitLineByEqualSign(
 		std::string &inputString, const std::string& delimiters) {
-	std::string s = inputString;
 	std::vector<std::string> result;
-	size_t pos = 0;
-	std::string token;
-	while ((pos = s.find(delimiters)) != std::string::npos) {
-		token = s.substr(0, pos);
-		result.push_back(token);
-		s.erase(0, pos + delimiters.length());
+	size_t pos = inputString.find(delimiters);
+	if (pos == std::string::npos) {
+		result.push_back(inputString);
+		return result;
 	}
-	result.push_back(s);
+	result.push_back(inputString.substr(0, pos));
+	result.push_back(inputString.substr(pos + delimiters.length()));
 	return result;
 }
 
@@ -163,7 +162,7 @@ GlobalConfigVars ConfigParser::parseConfigFile(std::string configFileName) {
 		tmpReading = splitLineByEqualSign(line);
 		if (tmpReading.size() != 2) {
 			throw SceException(
-					"Error in Config file: More than one equal sign found in one line :"
+					"Error in Config file: No equal sign found in one line :"
 							+ line, ConfigValueException);
 		}
 		std::string varName = removeLeadingAndTrailingSpace(tmpReading[0]);
@@ -215,7 +214,7 @@ void ConfigParser::updateConfigFile(GlobalConfigVars& configVar,
 		tmpReading = splitLineByEqualSign(line);
 		if (tmpReading.size() != 2) {
 			throw SceException(
-					"Error in Config file: More than one equal sign found in one line :"
+					"Error in Config file: No equal sign found in one line :"
 							+ line, ConfigValueException);
 		}
 		std::string varName = removeLeadingAndTrailingSpace(tmpReading[0]);
@@ -288,7 +287,7 @@ ConfigVarsCollection ConfigParser::parseConfigCollection(
 					tmpReading = splitLineByEqualSign(configPairStr);
 					if (tmpReading.size() != 2) {
 						throw SceException(
-								"Error in Config file: More than one equal sign found in one line :"
+								"Error in Config file: No equal sign found in one line :"
 										+ line, ConfigValueException);
 					}
 					std::string varName = removeLeadingAndTrailingSpace(
@@ -2,13 +2,19 @@
 
 
 
-TissueGrid Diffusion2D (double xMin, double xMax, double yMin, double yMax,int nGridX , int nGridY ,vector<vector<double> > sources, vector<double> pSrc, TissueGrid tissue, Chemo_Profile_Type profileType)
+void Diffusion2D (double xMin, double xMax, double yMin, double yMax,int nGridX , int nGridY ,const vector<vector<double> > & sources, const vector<double> & pSrc, TissueGrid & tissue, Chemo_Profile_Type profileType)
 {
-    vector<vector<double> > pointSource = sources ;
     tissue.DomainBoundaries(xMin, xMax, yMin, yMax, nGridX , nGridY) ;
+    if (profileType == experimental_profile)
+    {
+        //The experimental profile is mapped from file, the solver grids are not needed
+        tissue.Create_Experimental_Gradient();
+        tissue.ParaViewGrids(1);
+        return ;
+    }
     
-    tissue.xSources = pointSource.at(0) ;
-    tissue.ySources = pointSource.at(1) ;
+    tissue.xSources = sources.at(0) ;
+    tissue.ySources = sources.at(1) ;
     //Create the 2D grid structure
     tissue.InitializeAllGrids() ;
     //Assign the production rates corresponding to the sources
@@ -24,14 +30,35 @@ TissueGrid Diffusion2D (double xMin, double xMax, double yMin, double yMax,int n
         tissue.Create_Linear_Gradient();
         tissue.ParaViewGrids(1);
     }
-    else if (profileType == experimental_profile)
-    {
-        tissue.Create_Experimental_Gradient();
-        tissue.ParaViewGrids(1);
-    }
 
     
-    return tissue ;
+    return ;
+    
+}
+
+void Diffusion2D_AMR (double xMin, double xMax, double yMin, double yMax,int nGridX , int nGridY ,const vector<vector<double> > & sources, const vector<double> & pSrc, TissueGrid & tissue, AMRChemoGrid & amrGrid)
+{
+    tissue.DomainBoundaries(xMin, xMax, yMin, yMax, nGridX , nGridY) ;
+    
+    tissue.xSources = sources.at(0) ;
+    tissue.ySources = sources.at(1) ;
+    amrGrid.Solve(sources, pSrc, tissue) ;
+    
+    return ;
+    
+}
+
+void Diffusion2D_Species (double xMin, double xMax, double yMin, double yMax,int nGridX , int nGridY ,const vector<vector<double> > & sources, const vector<double> & pSrc, TissueGrid & tissue, ChemoSpeciesGrid & speciesGrid)
+{
+    tissue.DomainBoundaries(xMin, xMax, yMin, yMax, nGridX , nGridY) ;
+    
+    tissue.xSources = sources.at(0) ;
+    tissue.ySources = sources.at(1) ;
+    speciesGrid.DomainBoundaries(xMin, xMax, yMin, yMax, nGridX , nGridY) ;
+    speciesGrid.InitializeAllGrids() ;
+    speciesGrid.FindProductionPoints(sources, pSrc) ;
+    speciesGrid.EulerMethod() ;
     
+    return ;
     
 }
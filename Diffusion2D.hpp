@@ -4,7 +4,14 @@
 #define Diffusion2D_h
 
 #include "TissueGrid.hpp"
+#include "AMRGrid.hpp"
+#include "ChemoSpeciesGrid.hpp"
 
-TissueGrid Diffusion2D (double xMin, double xMax, double yMin, double yMax ,int nGridX , int nGridY, vector<vector<double> > tips, vector<double> pSrc, TissueGrid tissue, Chemo_Profile_Type profileType) ;
+//Solve for the chemical profile in place. The sources and production rates are only read.
+void Diffusion2D (double xMin, double xMax, double yMin, double yMax ,int nGridX , int nGridY, const vector<vector<double> > & tips, const vector<double> & pSrc, TissueGrid & tissue, Chemo_Profile_Type profileType) ;
+//Production profile on the block refined grid. tissue only keeps the domain and the finest resolution.
+void Diffusion2D_AMR (double xMin, double xMax, double yMin, double yMax ,int nGridX , int nGridY, const vector<vector<double> > & tips, const vector<double> & pSrc, TissueGrid & tissue, AMRChemoGrid & amrGrid) ;
+//Production profiles of all species in one batched solve. tissue only keeps the domain and the resolution.
+void Diffusion2D_Species (double xMin, double xMax, double yMin, double yMax ,int nGridX , int nGridY, const vector<vector<double> > & tips, const vector<double> & pSrc, TissueGrid & tissue, ChemoSpeciesGrid & speciesGrid) ;
 
 #endif /* Diffusion2D_h */
@@ -0,0 +1,303 @@
+#include "FrameStore.hpp"
+
+#include <cstring>
+#include <iostream>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static const char frameStoreMagic[8] = {'F','R','A','M','E','S','T','R'} ;
+static const uint32_t frameStoreVersion = 1 ;
+
+uint64_t FrameColumn_Bytes(const FrameColumn & column, uint64_t nBacteria)
+{
+    uint64_t valueBytes = column.type == frameColumn_float64 ? sizeof(double) : sizeof(int32_t) ;
+    return (nBacteria * column.nComponents * valueBytes + 7) / 8 * 8 ;
+}
+
+//---------------------------------------------------------------------------------------------
+
+FrameStoreWriter::FrameStoreWriter ()
+{
+    memset(&header, 0, sizeof(header) ) ;
+    memcpy(header.magic, frameStoreMagic, sizeof(frameStoreMagic) ) ;
+    header.version = frameStoreVersion ;
+    header.dataOffset = (sizeof(FrameStoreHeader) + 7) / 8 * 8 ;
+}
+
+//---------------------------------------------------------------------------------------------
+
+FrameStoreWriter::~FrameStoreWriter ()
+{
+    Close() ;
+}
+
+//---------------------------------------------------------------------------------------------
+
+int FrameStoreWriter::AddColumn(const string & name, FrameColumn_Type type, int nComponents)
+{
+    if (IsOpen() || header.nColumns == maxFrameColumns || name.size() >= sizeof(header.columns[0].name) )
+    {
+        throw SceException("Can not add frame store column " + name, ConfigValueException) ;
+    }
+    FrameColumn & column = header.columns[header.nColumns] ;
+    strncpy(column.name, name.c_str(), sizeof(column.name) ) ;
+    column.type = type ;
+    column.nComponents = nComponents ;
+    return static_cast<int>(header.nColumns++) ;
+}
+
+//---------------------------------------------------------------------------------------------
+
+void FrameStoreWriter::Open(const string & fileName, int tmpNBacteria, int tmpChunkFrames)
+{
+    Close() ;
+    header.nBacteria = tmpNBacteria ;
+    header.chunkFrames = max(tmpChunkFrames, 1) ;
+    data = fopen(fileName.c_str(), "wb") ;
+    index = fopen( (fileName + ".idx").c_str(), "wb") ;
+    if (data == nullptr || index == nullptr)
+    {
+        cout<<"Could not open frame store "<<fileName<<endl ;
+        Close() ;
+        return ;
+    }
+    vector<char> tmpHeader(header.dataOffset, 0) ;
+    memcpy(tmpHeader.data(), &header, sizeof(header) ) ;
+    fwrite(tmpHeader.data(), 1, tmpHeader.size(), data) ;
+    fflush(data) ;
+    fileOffset = header.dataOffset ;
+
+    columnBytes.resize(header.nColumns) ;
+    chunk.resize(header.nColumns) ;
+    for (uint32_t c = 0; c < header.nColumns; c++)
+    {
+        columnBytes[c] = FrameColumn_Bytes(header.columns[c], header.nBacteria) ;
+        chunk[c].assign(columnBytes[c] * header.chunkFrames, 0) ;
+    }
+    pending.clear() ;
+    pending.reserve(header.chunkFrames) ;
+}
+
+//---------------------------------------------------------------------------------------------
+
+double * FrameStoreWriter::Float64(int column)
+{
+    return reinterpret_cast<double *>(&chunk[column][pending.size() * columnBytes[column]]) ;
+}
+
+//---------------------------------------------------------------------------------------------
+
+int32_t * FrameStoreWriter::Int32(int column)
+{
+    return reinterpret_cast<int32_t *>(&chunk[column][pending.size() * columnBytes[column]]) ;
+}
+
+//---------------------------------------------------------------------------------------------
+
+void FrameStoreWriter::EndFrame(long frame, double time)
+{
+    FrameIndexEntry entry ;
+    entry.frame = frame ;
+    entry.time = time ;
+    entry.chunkOffset = fileOffset ;
+    entry.slot = static_cast<uint32_t>(pending.size() ) ;
+    entry.chunkFrames = 0 ;
+    pending.push_back(entry) ;
+    if (pending.size() == header.chunkFrames)
+    {
+        Flush() ;
+    }
+}
+
+//---------------------------------------------------------------------------------------------
+
+void FrameStoreWriter::Flush()
+{
+    if (IsOpen() == false || pending.empty() )
+    {
+        return ;
+    }
+    uint64_t chunkBytes = 0 ;
+    for (uint32_t c = 0; c < header.nColumns; c++)
+    {
+        fwrite(chunk[c].data(), 1, pending.size() * columnBytes[c], data) ;
+        chunkBytes += pending.size() * columnBytes[c] ;
+    }
+    fflush(data) ;
+    //The index is written after the data, so every frame in the index is complete
+    for (uint32_t k = 0; k < pending.size(); k++)
+    {
+        pending[k].chunkFrames = static_cast<uint32_t>(pending.size() ) ;
+    }
+    fwrite(pending.data(), sizeof(FrameIndexEntry), pending.size(), index) ;
+    fflush(index) ;
+    fileOffset += chunkBytes ;
+    pending.clear() ;
+}
+
+//---------------------------------------------------------------------------------------------
+
+void FrameStoreWriter::Close()
+{
+    Flush() ;
+    if (data != nullptr)
+    {
+        fclose(data) ;
+        data = nullptr ;
+    }
+    if (index != nullptr)
+    {
+        fclose(index) ;
+        index = nullptr ;
+    }
+}
+
+//---------------------------------------------------------------------------------------------
+
+//Maps a whole file, nullptr if it does not exist. An empty file is mapped as an empty slice
+static shared_ptr<const void> MapFile(const string & fileName, uint64_t & bytes)
+{
+    static const char empty = 0 ;
+    int fd = open(fileName.c_str(), O_RDONLY) ;
+    if (fd < 0)
+    {
+        return nullptr ;
+    }
+    struct stat fileStat ;
+    if (fstat(fd, &fileStat) != 0)
+    {
+        close(fd) ;
+        return nullptr ;
+    }
+    bytes = static_cast<uint64_t>(fileStat.st_size) ;
+    if (bytes == 0)
+    {
+        close(fd) ;
+        return shared_ptr<const void>(&empty, [](const void *) {}) ;
+    }
+    void * base = mmap(nullptr, bytes, PROT_READ, MAP_PRIVATE, fd, 0) ;
+    close(fd) ;
+    if (base == MAP_FAILED)
+    {
+        throw SceException("Could not map " + fileName, ConfigValueException) ;
+    }
+    uint64_t tmpBytes = bytes ;
+    return shared_ptr<const void>(base, [tmpBytes](const void * p) { munmap(const_cast<void *>(p), tmpBytes) ; }) ;
+}
+
+//---------------------------------------------------------------------------------------------
+
+bool MappedFrameStore::Open(const string & fileName)
+{
+    mapping.reset() ;
+    indexMapping.reset() ;
+    header = nullptr ;
+    frames = nullptr ;
+    nFrames = 0 ;
+    mapping = MapFile(fileName, fileBytes) ;
+    if (mapping == nullptr)
+    {
+        return false ;
+    }
+    const FrameStoreHeader * tmpHeader = static_cast<const FrameStoreHeader *>(mapping.get() ) ;
+    if (fileBytes < sizeof(FrameStoreHeader) || memcmp(tmpHeader->magic, frameStoreMagic, sizeof(frameStoreMagic) ) != 0
+        || tmpHeader->version != frameStoreVersion || tmpHeader->nColumns > maxFrameColumns)
+    {
+        mapping.reset() ;
+        throw SceException("Not a frame store: " + fileName, ConfigValueException) ;
+    }
+    uint64_t indexBytes = 0 ;
+    indexMapping = MapFile(fileName + ".idx", indexBytes) ;
+    if (indexMapping == nullptr)
+    {
+        mapping.reset() ;
+        throw SceException("Frame store has no index: " + fileName + ".idx", ConfigValueException) ;
+    }
+    header = tmpHeader ;
+    frames = static_cast<const FrameIndexEntry *>(indexMapping.get() ) ;
+    //A run that stopped while writing the index leaves a partial record at the end
+    nFrames = indexBytes / sizeof(FrameIndexEntry) ;
+    uint64_t frameBytes = 0 ;
+    for (uint32_t c = 0; c < header->nColumns; c++)
+    {
+        frameBytes += FrameColumn_Bytes(header->columns[c], header->nBacteria) ;
+    }
+    while (nFrames > 0 && frames[nFrames - 1].chunkOffset + frames[nFrames - 1].chunkFrames * frameBytes > fileBytes)
+    {
+        nFrames-- ;
+    }
+    return true ;
+}
+
+//---------------------------------------------------------------------------------------------
+
+int MappedFrameStore::Column(const string & name) const
+{
+    for (uint32_t c = 0; c < header->nColumns; c++)
+    {
+        if (strncmp(header->columns[c].name, name.c_str(), sizeof(header->columns[c].name) ) == 0)
+        {
+            return static_cast<int>(c) ;
+        }
+    }
+    return -1 ;
+}
+
+//---------------------------------------------------------------------------------------------
+
+const char * MappedFrameStore::Slice(int column, long k) const
+{
+    const FrameIndexEntry & entry = frames[k] ;
+    uint64_t offset = entry.chunkOffset ;
+    for (int c = 0; c < column; c++)
+    {
+        offset += entry.chunkFrames * FrameColumn_Bytes(header->columns[c], header->nBacteria) ;
+    }
+    offset += entry.slot * FrameColumn_Bytes(header->columns[column], header->nBacteria) ;
+    return static_cast<const char *>(mapping.get() ) + offset ;
+}
+
+//---------------------------------------------------------------------------------------------
+
+const double * MappedFrameStore::Float64(int column, long k) const
+{
+    if (header->columns[column].type != frameColumn_float64)
+    {
+        return nullptr ;
+    }
+    return reinterpret_cast<const double *>(Slice(column, k) ) ;
+}
+
+//---------------------------------------------------------------------------------------------
+
+const int32_t * MappedFrameStore::Int32(int column, long k) const
+{
+    if (header->columns[column].type != frameColumn_int32)
+    {
+        return nullptr ;
+    }
+    return reinterpret_cast<const int32_t *>(Slice(column, k) ) ;
+}
+
+//---------------------------------------------------------------------------------------------
+
+long MappedFrameStore::FindFrame(double tmpTime) const
+{
+    long low = 0 ;
+    long high = static_cast<long>(nFrames) ;
+    while (low < high)
+    {
+        long middle = (low + high) / 2 ;
+        if (frames[middle].time < tmpTime)
+        {
+            low = middle + 1 ;
+        }
+        else
+        {
+            high = middle ;
+        }
+    }
+    return low ;
+}
@@ -0,0 +1,109 @@
+#ifndef FrameStore_hpp
+#define FrameStore_hpp
+
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <vector>
+#include "commonData.h"
+
+using namespace std ;
+
+//Columnar binary store of per-bacterium values, one value ( or nComponents values) per bacterium, column and frame.
+//The header is followed by chunks of up to chunkFrames frames. Inside a chunk every column is contiguous, frame after
+//frame, so one column of a time range is a few large slices. The index file ( fileName + ".idx") has one record per
+//frame, appended when its chunk is written. A reader maps both files and never parses text.
+enum FrameColumn_Type {frameColumn_float64 = 0, frameColumn_int32 = 1} ;
+
+static const int maxFrameColumns = 32 ;
+
+struct FrameColumn
+{
+    char name[24] ;
+    uint32_t type ;                 //FrameColumn_Type
+    uint32_t nComponents ;
+};
+
+struct FrameStoreHeader
+{
+    char magic[8] ;                 //"FRAMESTR"
+    uint32_t version ;
+    uint32_t nColumns ;
+    uint64_t nBacteria ;
+    uint64_t chunkFrames ;
+    uint64_t dataOffset ;           //first chunk
+    FrameColumn columns[maxFrameColumns] ;
+};
+
+struct FrameIndexEntry
+{
+    int64_t frame ;
+    double time ;
+    uint64_t chunkOffset ;          //file offset of the chunk of this frame
+    uint32_t slot ;                 //frame within its chunk
+    uint32_t chunkFrames ;          //frames in that chunk, the last chunk can be short
+};
+
+//Bytes of one frame of a column, padded to 8 so every slice of a float64 column is aligned
+uint64_t FrameColumn_Bytes (const FrameColumn & column, uint64_t nBacteria) ;
+
+//Usage: AddColumn for every column, Open, then for every frame fill the arrays returned by Float64/Int32 and call EndFrame
+class FrameStoreWriter
+{
+public:
+    //---------------------------- Parameters and sub-classes ------------------------------
+    FrameStoreWriter () ;
+    ~FrameStoreWriter () ;
+
+    //---------------------------- Functions --------------------------------------------
+    //Returns the column number. Only before Open
+    int AddColumn (const string & name, FrameColumn_Type type, int nComponents = 1) ;
+    void Open (const string & fileName, int tmpNBacteria, int tmpChunkFrames) ;
+    bool IsOpen () const { return data != nullptr ; }
+    //Values of the frame being filled, bacterium i at i * nComponents
+    double * Float64 (int column) ;
+    int32_t * Int32 (int column) ;
+    void EndFrame (long frame, double time) ;
+    //Write the buffered frames as a ( possibly short) chunk
+    void Flush () ;
+    void Close () ;
+
+private:
+    FrameStoreHeader header ;
+    vector<uint64_t> columnBytes ;
+    vector<vector<char> > chunk ;           //one buffer of chunkFrames frames per column
+    vector<FrameIndexEntry> pending ;
+    uint64_t fileOffset = 0 ;
+    FILE * data = nullptr ;
+    FILE * index = nullptr ;
+};
+
+//Read-only memory map of a store and its index. Copies share the same mapping
+class MappedFrameStore
+{
+public:
+    //Returns false if the file does not exist, throws if it is not a valid store
+    bool Open (const string & fileName) ;
+    bool IsOpen () const { return header != nullptr ; }
+    int NumberBacteria () const { return static_cast<int>(header->nBacteria) ; }
+    long NumberFrames () const { return static_cast<long>(nFrames) ; }
+    const FrameIndexEntry & Frame (long k) const { return frames[k] ; }
+    //Column number by name, -1 if there is no such column
+    int Column (const string & name) const ;
+    const double * Float64 (int column, long k) const ;
+    const int32_t * Int32 (int column, long k) const ;
+    //First frame with time >= tmpTime
+    long FindFrame (double tmpTime) const ;
+
+private:
+    const char * Slice (int column, long k) const ;
+    shared_ptr<const void> mapping ;
+    shared_ptr<const void> indexMapping ;
+    const FrameStoreHeader * header = nullptr ;
+    const FrameIndexEntry * frames = nullptr ;
+    uint64_t nFrames = 0 ;
+    uint64_t fileBytes = 0 ;
+};
+
+#endif /* FrameStore_hpp */
@@ -65,7 +65,7 @@ void Fungi::Find_Hyphae_Tips2()
 }
 //---------------------------------------------------------------------------------------------
 
-void Fungi:: WriteSourceLoc(vector<vector<double> > pointSource)
+void Fungi:: WriteSourceLoc(const vector<vector<double> > & pointSource)
 {
     ofstream sourceLoc (statsFolder + "sourceLocation.txt") ;
     for (uint i = 0; i< pointSource.at(0).size() ; i++)
@@ -76,166 +76,238 @@ void Fungi:: WriteSourceLoc(vector<vector<double> > pointSource)
 }
 //---------------------------------------------------------------------------------------------
 
-void Fungi::FindProductionNetwork()
+//Children of every segment in compressed sparse row form, and the segments ordered from the roots ( from_who == -1)
+//outwards, so every segment comes after its parent
+void Fungi::BuildAdjacency()
 {
-    vector<int> ngbrList ;
-    for (int i = 0; i< tips_SegmentID.size() ; i++)
+    int nSegments = static_cast<int>(hyphaeSegments.size() ) ;
+    childrenStart.assign(nSegments + 1, 0) ;
+    for (int i = 0; i < nSegments; i++)
     {
-        bool tmpConnection = false ;
-        int id = tips_SegmentID.at(i) ;
-        hyphaeSegments.at(id).p2 += production ;
-        hyphaeSegments.at(id).p1 += production * proDecayFactor ;
-        hyphaeSegments.at(id).tmpP1 = production * proDecayFactor ;
-        hyphaeSegments.at(id).tmpP2 = production ;
-        
-        ngbrList = FindNeighborList(id) ;
-        for (int nbrElement = 0; nbrElement< ngbrList.size(); nbrElement++)
+        int parent = hyphaeSegments.at(i).from_who ;
+        if (parent >= 0)
         {
-            Rec_CalNeighborProduction(id, ngbrList, nbrElement, tmpConnection) ;
+            childrenStart.at(parent + 1)++ ;
         }
-        
     }
-    
-}
-//---------------------------------------------------------------------------------------------
-
-void Fungi::FindProductionNetwork2()
-{
-    vector<int> ngbrList ;
-    for (int i = 0; i< hyphaeSegments.size() ; i++)
+    for (int i = 0; i < nSegments; i++)
+    {
+        childrenStart.at(i + 1) += childrenStart.at(i) ;
+    }
+    children.resize(childrenStart.back() ) ;
+    vector<int> tmpFill (childrenStart.begin(), childrenStart.end() - 1) ;
+    for (int i = 0; i < nSegments; i++)
     {
-        if (hyphaeSegments.at(i).from_who == -1 )
+        int parent = hyphaeSegments.at(i).from_who ;
+        if (parent >= 0)
         {
-            hyphaeSegments.at(i).p1 = production ;
-            hyphaeSegments.at(i).p2 = production * proDecayFactor ;
-            hyphaeSegments.at(i).tmpP2 = production * proDecayFactor ;
-            hyphaeSegments.at(i).tmpP1 = production ;
-        
-            ngbrList = FindNeighborList(i) ;
-            for (int nbrElement = 0; nbrElement< ngbrList.size(); nbrElement++)
-            {
-                Rec_CalNeighborProduction2(i, ngbrList, nbrElement) ;
-            }
+            children.at(tmpFill.at(parent)++) = i ;
+        }
+    }
+    traversalOrder.clear() ;
+    traversalOrder.reserve(nSegments) ;
+    for (int i = 0; i < nSegments; i++)
+    {
+        if (hyphaeSegments.at(i).from_who == -1)
+        {
+            traversalOrder.push_back(i) ;
+        }
+    }
+    for (size_t k = 0; k < traversalOrder.size(); k++)
+    {
+        int id = traversalOrder[k] ;
+        for (int c = childrenStart[id]; c < childrenStart[id + 1]; c++)
+        {
+            traversalOrder.push_back(children[c]) ;
         }
-        
     }
-    
 }
 //---------------------------------------------------------------------------------------------
 
-vector<int> Fungi::FindNeighborList(int i)
+//Every tip sends its production through the whole network. Arriving at the end of a segment adds the
+//value to that end and the decayed value to the other end, and the value decays each time it passes along a segment.
+//Reaching a segment at the center forwards the value to the other center segments.
+//All tips are handled together: upFlow is what a segment sends to its parent from the tips in its subtree,
+//downFlow is what it receives from its parent from all other tips.
+void Fungi::FindProductionNetwork()
 {
-    vector<int> ngbrList ;
-    
-    if( hyphaeSegments.at(i).from_who !=  -1 )
-        ngbrList.push_back(hyphaeSegments.at(i).from_who) ;
-    if( hyphaeSegments.at(i).can_branch != true)
-        ngbrList.push_back(hyphaeSegments.at(i).branch_to) ;
-    if( hyphaeSegments.at(i).can_extend != true)
-        ngbrList.push_back(hyphaeSegments.at(i).extend_to) ;
-    
-    return ngbrList ;
+    if (childrenStart.size() != hyphaeSegments.size() + 1)
+    {
+        BuildAdjacency() ;
+    }
+    int nSegments = static_cast<int>(hyphaeSegments.size() ) ;
+    vector<double> tipProduction (nSegments, 0.0) ;
+    for (int i = 0; i< tips_SegmentID.size() ; i++)
+    {
+        tipProduction.at(tips_SegmentID.at(i) ) += production ;
+    }
+    vector<double> upFlow (nSegments, 0.0) ;
+    vector<double> childrenFlow (nSegments, 0.0) ;        //sum of upFlow of the children
+    for (int k = static_cast<int>(traversalOrder.size() ) - 1; k >= 0; k--)
+    {
+        int id = traversalOrder[k] ;
+        upFlow[id] = (tipProduction[id] + childrenFlow[id]) * proDecayFactor ;
+        int parent = hyphaeSegments.at(id).from_who ;
+        if (parent >= 0)
+        {
+            childrenFlow[parent] += upFlow[id] ;
+        }
+    }
+    //Value forwarded between the center segments
+    double centerFlow = 0.0 ;
+    for (int i = 0; i < centerConnectedSegments.size(); i++)
+    {
+        centerFlow += childrenFlow[centerConnectedSegments.at(i)] * proDecayFactor ;
+    }
+    vector<double> downFlow (nSegments, 0.0) ;
+    for (int i = 0; i < centerConnectedSegments.size(); i++)
+    {
+        int id = centerConnectedSegments.at(i) ;
+        downFlow[id] = centerFlow - childrenFlow[id] * proDecayFactor ;
+    }
+    for (size_t k = 0; k < traversalOrder.size(); k++)
+    {
+        int id = traversalOrder[k] ;
+        HyphaeSegment & hy = hyphaeSegments.at(id) ;
+        //own production and what comes from the children arrive at the end of the segment, the rest at the beginning
+        double atEnd = tipProduction[id] + childrenFlow[id] ;
+        hy.p2 += atEnd + downFlow[id] * proDecayFactor ;
+        hy.p1 += atEnd * proDecayFactor + downFlow[id] ;
+        hy.tmpP1 = upFlow[id] ;
+        hy.tmpP2 = atEnd + downFlow[id] * proDecayFactor ;
+        for (int c = childrenStart[id]; c < childrenStart[id + 1]; c++)
+        {
+            downFlow[children[c]] = hy.tmpP2 - upFlow[children[c]] ;
+        }
+    }
 }
 //---------------------------------------------------------------------------------------------
 
-void Fungi::Rec_CalNeighborProduction(int id, vector<int> ngbrList, int nbrElement, bool connection )
+//Production decays with the number of segments from the center of the network
+void Fungi::FindProductionNetwork2()
 {
-        int neighbor = ngbrList.at(nbrElement) ;
-        if (neighbor < id)
+    if (childrenStart.size() != hyphaeSegments.size() + 1)
+    {
+        BuildAdjacency() ;
+    }
+    for (size_t k = 0; k < traversalOrder.size(); k++)
+    {
+        int id = traversalOrder[k] ;
+        HyphaeSegment & hy = hyphaeSegments.at(id) ;
+        if (hy.from_who == -1 )
         {
-        hyphaeSegments.at(neighbor).p2 += hyphaeSegments.at(id).tmpP1 ;
-        hyphaeSegments.at(neighbor).p1 += hyphaeSegments.at(id).tmpP1 * proDecayFactor ;
-        hyphaeSegments.at(neighbor).tmpP1 = hyphaeSegments.at(id).tmpP1 * proDecayFactor ;
-        hyphaeSegments.at(neighbor).tmpP2 = hyphaeSegments.at(id).tmpP1 ;
-            
+            hy.p1 = production ;
+            hy.p2 = production * proDecayFactor ;
+            hy.tmpP2 = production * proDecayFactor ;
+            hy.tmpP1 = production ;
         }
-        else
+        for (int c = childrenStart[id]; c < childrenStart[id + 1]; c++)
         {
-            hyphaeSegments.at(neighbor).p1 += hyphaeSegments.at(id).tmpP2 ;
-            hyphaeSegments.at(neighbor).p2 += hyphaeSegments.at(id).tmpP2 * proDecayFactor ;
-            hyphaeSegments.at(neighbor).tmpP2 = hyphaeSegments.at(id).tmpP2 * proDecayFactor ;
-            hyphaeSegments.at(neighbor).tmpP1 = hyphaeSegments.at(id).tmpP2 ;
+            HyphaeSegment & child = hyphaeSegments.at(children[c]) ;
+            child.p1 = hy.tmpP2 ;
+            child.p2 = hy.tmpP2 * proDecayFactor ;
+            child.tmpP2 = hy.tmpP2 * proDecayFactor ;
+            child.tmpP1 = hy.tmpP2 ;
         }
-        vector<int> tmpList = FindNeighborList(neighbor) ;
-        
-        //remove id from tmpList
-        for (int k =0 ; k<tmpList.size(); k++)
+    }
+}
+//---------------------------------------------------------------------------------------------
+
+//Every new segment extends a random tip, or with branchProbability branches from a random segment that has not branched.
+//Candidates are drawn at random until one can grow, so the cost does not depend on the size of the network.
+void Fungi::Grow_Network(double tmpDt, vector<int> & newSegments, vector<int> & gainedTips, vector<int> & lostTips)
+{
+    newSegments.clear() ;
+    gainedTips.clear() ;
+    lostTips.clear() ;
+    //In liquid the network is not a source ( see Find_Hyphae_Tips2)
+    if (Bacteria_inLiquid == 1 || hyphaeSegments.empty() )
+    {
+        return ;
+    }
+    growthBacklog += growthRate * tmpDt ;
+    RandomStream tmpRandom = rng.Stream(0, growthSteps++, random_fungalGrowth) ;
+    const int maxTrials = 64 ;
+    while (growthBacklog >= 1.0)
+    {
+        growthBacklog -= 1.0 ;
+        bool branching = tmpRandom.Uniform() < branchProbability ;
+        int parent = -1 ;
+        int tipEntry = -1 ;
+        for (int trial = 0; trial < maxTrials && parent == -1; trial++)
         {
-            if (tmpList.at(k) == id )
+            if (branching)
             {
-                tmpList.erase(tmpList.begin()+k ) ;
+                int tmpID = static_cast<int>(tmpRandom.Uniform() * hyphaeSegments.size() ) ;
+                if (hyphaeSegments.at(tmpID).can_branch)
+                {
+                    parent = tmpID ;
+                }
+            }
+            else if (tips_SegmentID.size() > 0)
+            {
+                int tmpEntry = static_cast<int>(tmpRandom.Uniform() * tips_SegmentID.size() ) ;
+                if (hyphaeSegments.at(tips_SegmentID.at(tmpEntry) ).can_extend)
+                {
+                    tipEntry = tmpEntry ;
+                    parent = tips_SegmentID.at(tmpEntry) ;
+                }
             }
         }
-        for (int k =0 ; k<tmpList.size(); k++)
+        if (parent == -1)
         {
-            Rec_CalNeighborProduction(neighbor, tmpList, k, connection) ;
+            continue ;
         }
-    
-    if (hyphaeSegments.at(neighbor).from_who == -1 &&  connection == false)
-    {
-        connection = true ;
-        for (int i=0; i< centerConnectedSegments.size() ; i++)
+        HyphaeSegment & hy = hyphaeSegments.at(parent) ;
+        //loaded networks only have the coordinates
+        hy.angle = atan2(hy.y2 - hy.y1, hy.x2 - hy.x1) ;
+        double tmpAngle = growthAngleSDV * tmpRandom.Gaussian() ;
+        if (branching)
         {
-            int centerNeighbor = centerConnectedSegments.at(i) ;
-            
-            if (centerConnectedSegments.at(i) != neighbor )
+            tmpAngle += (tmpRandom.Uniform() < 0.5) ? branchingAngle : -branchingAngle ;
+            add_new_hyphae(hyphaeSegments, parent, tmpAngle, "branch") ;
+            if (branchIsTip)
             {
-                hyphaeSegments.at(centerNeighbor ).p1 += hyphaeSegments.at(neighbor).tmpP1 ;
-                hyphaeSegments.at(centerNeighbor ).p2 += hyphaeSegments.at(neighbor).tmpP1 * proDecayFactor ;
-                hyphaeSegments.at(centerNeighbor ).tmpP2 = hyphaeSegments.at(neighbor).tmpP1 * proDecayFactor ;
-                hyphaeSegments.at(centerNeighbor ).tmpP1 = hyphaeSegments.at(neighbor).tmpP1 ;
-                
-                
-                vector<int> tmpListCenter = FindNeighborList(centerNeighbor) ;
-                
-                //remove id from tmpList
-                for (int k =0 ; k<tmpListCenter.size(); k++)
-                {
-                    if (tmpListCenter.at(k) == neighbor )
-                    {
-                        tmpListCenter.erase(tmpListCenter.begin()+k ) ;
-                    }
-                }
-                for (int k =0 ; k<tmpListCenter.size(); k++)
-                {
-                    Rec_CalNeighborProduction(centerNeighbor, tmpListCenter, k, connection) ;
-                }
-                
-                
+                tips_Coord[0].push_back(hyphaeSegments.at(parent).x2) ;
+                tips_Coord[1].push_back(hyphaeSegments.at(parent).y2) ;
+                tips_SegmentID.push_back(parent) ;
+                gainedTips.push_back(parent) ;
             }
         }
+        else
+        {
+            add_new_hyphae(hyphaeSegments, parent, tmpAngle, "extend") ;
+            //the extended tip is replaced by the last one
+            tips_Coord[0].at(tipEntry) = tips_Coord[0].back() ;
+            tips_Coord[1].at(tipEntry) = tips_Coord[1].back() ;
+            tips_SegmentID.at(tipEntry) = tips_SegmentID.back() ;
+            tips_Coord[0].pop_back() ;
+            tips_Coord[1].pop_back() ;
+            tips_SegmentID.pop_back() ;
+            lostTips.push_back(parent) ;
+        }
+        int newID = static_cast<int>(hyphaeSegments.size() ) - 1 ;
+        tips_Coord[0].push_back(hyphaeSegments.at(newID).x2) ;
+        tips_Coord[1].push_back(hyphaeSegments.at(newID).y2) ;
+        tips_SegmentID.push_back(newID) ;
+        newSegments.push_back(newID) ;
+        gainedTips.push_back(newID) ;
     }
-    
-    
-    
-   
 }
 //---------------------------------------------------------------------------------------------
 
-void Fungi::Rec_CalNeighborProduction2(int id, vector<int> ngbrList, int nbrElement )
+vector<int> Fungi::FindNeighborList(int i)
 {
+    vector<int> ngbrList ;
     
-        int neighbor = ngbrList.at(nbrElement) ;
-        
-        hyphaeSegments.at(neighbor).p1 = hyphaeSegments.at(id).tmpP2 ;
-        hyphaeSegments.at(neighbor).p2 = hyphaeSegments.at(id).tmpP2 * proDecayFactor ;
-        hyphaeSegments.at(neighbor).tmpP2 = hyphaeSegments.at(id).tmpP2 * proDecayFactor ;
-        hyphaeSegments.at(neighbor).tmpP1 = hyphaeSegments.at(id).tmpP2 ;
+    if( hyphaeSegments.at(i).from_who !=  -1 )
+        ngbrList.push_back(hyphaeSegments.at(i).from_who) ;
+    if( hyphaeSegments.at(i).can_branch != true)
+        ngbrList.push_back(hyphaeSegments.at(i).branch_to) ;
+    if( hyphaeSegments.at(i).can_extend != true)
+        ngbrList.push_back(hyphaeSegments.at(i).extend_to) ;
     
-        vector<int> tmpList = FindNeighborList(neighbor) ;
-        
-        //remove id from tmpList
-        for (int k =0 ; k<tmpList.size(); k++)
-        {
-            if (tmpList.at(k) == id )
-            {
-                tmpList.erase(tmpList.begin()+k ) ;
-            }
-        }
-        for (int k =0 ; k<tmpList.size(); k++)
-        {
-            Rec_CalNeighborProduction2(neighbor, tmpList, k) ;
-        }
+    return ngbrList ;
 }
 
 //---------------------------------------------------------------------------------------------
@@ -268,7 +340,13 @@ void Fungi::UpdateFungi_FromConfigFile()
     hyphaeWidth = globalConfigVars.getConfigValue("hyphae_Width").toDouble() ;
     hyphaeOverLiq = globalConfigVars.getConfigValue("hyphae_OverLiq").toDouble() ;
     loading_Network = static_cast<bool>(globalConfigVars.getConfigValue("hyphae_Loading_Network").toInt() ) ;
+    networkFile = globalConfigVars.getConfigValue("hyphae_NetworkFile").toString() ;
+    networkBinaryFile = globalConfigVars.getConfigValue("hyphae_NetworkBinaryFile").toString() ;
     branchIsTip = static_cast<bool>(globalConfigVars.getConfigValue("hyphae_BranchIsTip").toInt() ) ;
+    growing = static_cast<bool>(globalConfigVars.getConfigValue("hyphae_Growth").toInt() ) ;
+    growthRate = globalConfigVars.getConfigValue("hyphae_GrowthRate").toDouble() ;
+    branchProbability = globalConfigVars.getConfigValue("hyphae_BranchProbability").toDouble() ;
+    growthAngleSDV = globalConfigVars.getConfigValue("hyphae_GrowthAngleSDV").toDouble() ;
     Bacteria_inLiquid = globalConfigVars.getConfigValue("Bacteria_inLiquid").toDouble() ;
     
 }
@@ -15,8 +15,10 @@
 #include <string>
 #include <math.h>
 #include <vector>
+#include <random>
 
 #include "growthFunctions.h"
+#include "RandomStreams.hpp"
 
 class Fungi {
 public:
@@ -25,6 +27,10 @@ public:
     vector<vector<double> > tips_Coord ;
     vector<int > tips_SegmentID ;
     vector<int> centerConnectedSegments ;
+    //Children of segment i are children[childrenStart[i]] ... children[childrenStart[i+1] - 1]
+    vector<int> childrenStart ;
+    vector<int> children ;
+    vector<int> traversalOrder ;        //parents before children
     vector<double> Hypahe_X1Values;
     vector<double> Hypahe_X2Values;
     vector<double> Hypahe_Y1Values;
@@ -47,8 +53,20 @@ public:
     double Bacteria_inLiquid = 1.0 ; //Parameter that takes 1 if Simulation is In Liquid and 0 if with Fungi
     int init_Count = 4 ;
     bool loading_Network = true ;
+    string networkFile ;                //hyphal coordinates, one segment "x1,y1,x2,y2" per line
+    string networkBinaryFile ;          //segments with their connections, written from networkFile on first load
     bool branchIsTip = false ;
     
+    //Growth of the network during the simulation
+    bool growing = false ;
+    double growthRate = 0.0 ;           //new segments per unit time
+    double branchProbability = 0.2 ;    //chance that a new segment is a branch instead of an extension of a tip
+    double growthAngleSDV = 0.1 ;       //random change of direction of a new segment
+    double branchingAngle = constants::pi / 3.0 ;
+    double growthBacklog = 0.0 ;        //fraction of a segment carried to the next growth step
+    RandomGenerator rng ;               //set from the run seed in main
+    long growthSteps = 0 ;              //calls of Grow_Network, the step of its random stream
+    
     int machineID = 1 ;
     string folderName = "./animation/machine" + to_string(machineID) + "/" ;
     string statsFolder = "./dataStats/machine" + to_string(machineID) + "/" ;
@@ -57,14 +75,16 @@ public:
     Fungi () ;
     void Find_Hyphae_Tips() ;               // Store the branch points and the tips in the "tips vector"
     void Find_Hyphae_Tips2() ;              //Only the tips of fungi network are stored in the "tips vector"
-    void WriteSourceLoc(vector<vector<double> >) ;
+    void WriteSourceLoc(const vector<vector<double> > &) ;
     //Need calibration if you want to use it. (proDecayFactor, HyphaeSegment.p1 & p2, and etc. )
     //Scale production rates based on the network-distance from:
     void FindProductionNetwork ();          // the tips
     void FindProductionNetwork2();          //the Center of the network
     vector<int> FindNeighborList (int i) ;
-    void Rec_CalNeighborProduction (int id, vector<int> ngbrList, int nbrElement, bool connection) ;
-    void Rec_CalNeighborProduction2(int id, vector<int> ngbrList, int nbrElement ) ;
+    //Children lists and the order from the center outwards, built from from_who
+    void BuildAdjacency () ;
+    //Add the segments grown over tmpDt and keep the tips up to date. The tips are given by segment ID (tip at x2)
+    void Grow_Network (double tmpDt, vector<int> & newSegments, vector<int> & gainedTips, vector<int> & lostTips) ;
     
     //Find the neighbors of the segments at the center of the network
     vector<int> FindCenterPointConnection () ;
@@ -1,11 +1,13 @@
 #include "Grid.hpp"
 
 
+ChemoField::ChemoField ()
+{
+}
 
-void Grid::UpdateValue()
+ChemoField::ChemoField(const double * tmpData, int nGridX, int nGridY)
 {
-    value += change ;
-    change = 0.0 ;
-    
-    return ;
+    data = tmpData ;
+    numberGridsX = nGridX ;
+    numberGridsY = nGridY ;
 }
@@ -18,15 +18,41 @@
 #include "driver.h"
 using namespace std ;
 
-class Grid
+//Non-owning view of a row-major 2D concentration field.
+//The storage belongs to TissueGrid (or AMRChemoGrid), so the view is valid as long as the grids are not re-initialized
+class ChemoField
 {
 public:
-    double value = 0.0 ;
-    double change = 0.0 ;
-    double productionRate = 0.0 ;
+    const double * data = nullptr ;
+    int numberGridsX = 0 ;
+    int numberGridsY = 0 ;
+    int stride = 1 ;                        //distance between two grids, more than 1 for one species of ChemoSpeciesGrid
     
+    //Only used for a block-refined field. data is then the coarse grid and the refined blocks are in patchData
+    const int * blockPatch = nullptr ;      //patch id of each block, -1 if the block is coarse
+    const double * patchData = nullptr ;
+    int blockSize = 1 ;
+    int nBlocksX = 0 ;
+    int coarsening = 1 ;
+    int coarseGridsX = 0 ;
     
-    void UpdateValue () ;
+    ChemoField () ;
+    ChemoField (const double * tmpData, int nGridX, int nGridY) ;
+    // i is the row (y index), j is the column (x index), both at the finest resolution
+    double at (int i, int j) const
+    {
+        if (blockPatch == nullptr)
+        {
+            return data[ (static_cast<size_t>(i) * numberGridsX + j) * stride ] ;
+        }
+        int patch = blockPatch[ (i / blockSize) * nBlocksX + j / blockSize ] ;
+        if (patch >= 0)
+        {
+            return patchData[ static_cast<size_t>(patch) * blockSize * blockSize + (i % blockSize) * blockSize + j % blockSize ] ;
+        }
+        return data[ static_cast<size_t>(i / coarsening) * coarseGridsX + j / coarsening ] ;
+    }
+    bool empty () const { return data == nullptr ; }
     
 };
 #endif /* Grid_hpp */
@@ -0,0 +1,316 @@
+#include "HyphaeSegmentIndex.hpp"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+HyphaeSegmentIndex::HyphaeSegmentIndex ()
+{
+}
+
+//---------------------------------------------------------------------------------------------
+
+int HyphaeSegmentIndex::BinX(double x) const
+{
+    return min(max(static_cast<int>(floor( (x - xMin) / binSize) ), 0), nBinsX - 1) ;
+}
+
+int HyphaeSegmentIndex::BinY(double y) const
+{
+    return min(max(static_cast<int>(floor( (y - yMin) / binSize) ), 0), nBinsY - 1) ;
+}
+
+//---------------------------------------------------------------------------------------------
+
+void HyphaeSegmentIndex::Build(const vector<HyphaeSegment> & segments, double tmpBinSize)
+{
+    size_t nSegments = segments.size() ;
+    x1.resize(nSegments) ;
+    y1.resize(nSegments) ;
+    x2.resize(nSegments) ;
+    y2.resize(nSegments) ;
+    root.resize(nSegments) ;
+    binSize = tmpBinSize ;
+    nBinsX = 0 ;
+    nBinsY = 0 ;
+    binStart.clear() ;
+    segmentIDs.clear() ;
+    binInserted.clear() ;
+    if (nSegments == 0)
+    {
+        return ;
+    }
+    if (binSize <= 0.0)
+    {
+        double totalLength = 0.0 ;
+        for (size_t k = 0; k < nSegments; k++)
+        {
+            totalLength += hypot(segments[k].x2 - segments[k].x1, segments[k].y2 - segments[k].y1) ;
+        }
+        binSize = (totalLength > 0.0) ? totalLength / nSegments : 1.0 ;
+    }
+    double xMax = -numeric_limits<double>::max() ;
+    double yMax = -numeric_limits<double>::max() ;
+    xMin = numeric_limits<double>::max() ;
+    yMin = numeric_limits<double>::max() ;
+    for (size_t k = 0; k < nSegments; k++)
+    {
+        x1[k] = segments[k].x1 ;
+        y1[k] = segments[k].y1 ;
+        x2[k] = segments[k].x2 ;
+        y2[k] = segments[k].y2 ;
+        root[k] = (segments[k].from_who == -1) ;
+        xMin = min(xMin, min(x1[k], x2[k]) ) ;
+        xMax = max(xMax, max(x1[k], x2[k]) ) ;
+        yMin = min(yMin, min(y1[k], y2[k]) ) ;
+        yMax = max(yMax, max(y1[k], y2[k]) ) ;
+    }
+    nBinsX = static_cast<int>(floor( (xMax - xMin) / binSize) ) + 1 ;
+    nBinsY = static_cast<int>(floor( (yMax - yMin) / binSize) ) + 1 ;
+
+    //Counting sort of the segments into the bins
+    binStart.assign(static_cast<size_t>(nBinsX) * nBinsY + 1, 0) ;
+    for (int pass = 0; pass < 2; pass++)
+    {
+        vector<int> fill ;
+        if (pass == 1)
+        {
+            for (size_t b = 1; b < binStart.size(); b++)
+            {
+                binStart[b] += binStart[b - 1] ;
+            }
+            segmentIDs.resize(binStart.back() ) ;
+            fill.assign(binStart.begin(), binStart.end() - 1) ;
+        }
+        for (size_t k = 0; k < nSegments; k++)
+        {
+            int bxMin = BinX(min(x1[k], x2[k]) ) ;
+            int bxMax = BinX(max(x1[k], x2[k]) ) ;
+            int byMin = BinY(min(y1[k], y2[k]) ) ;
+            int byMax = BinY(max(y1[k], y2[k]) ) ;
+            for (int bx = bxMin; bx <= bxMax; bx++)
+            {
+                for (int by = byMin; by <= byMax; by++)
+                {
+                    size_t b = static_cast<size_t>(by) * nBinsX + bx ;
+                    if (pass == 0)
+                    {
+                        binStart[b + 1]++ ;
+                    }
+                    else
+                    {
+                        segmentIDs[fill[b]++] = static_cast<int>(k) ;
+                    }
+                }
+            }
+        }
+    }
+}
+
+//---------------------------------------------------------------------------------------------
+
+bool HyphaeSegmentIndex::Insert(const HyphaeSegment & segment)
+{
+    if (empty() )
+    {
+        return false ;
+    }
+    double tmpXMin = min(segment.x1, segment.x2) ;
+    double tmpXMax = max(segment.x1, segment.x2) ;
+    double tmpYMin = min(segment.y1, segment.y2) ;
+    double tmpYMax = max(segment.y1, segment.y2) ;
+    if (tmpXMin < xMin || tmpYMin < yMin || tmpXMax >= xMin + nBinsX * binSize || tmpYMax >= yMin + nBinsY * binSize)
+    {
+        return false ;
+    }
+    int k = static_cast<int>(x1.size() ) ;
+    x1.push_back(segment.x1) ;
+    y1.push_back(segment.y1) ;
+    x2.push_back(segment.x2) ;
+    y2.push_back(segment.y2) ;
+    root.push_back(segment.from_who == -1) ;
+    if (binInserted.empty() )
+    {
+        binInserted.resize(static_cast<size_t>(nBinsX) * nBinsY) ;
+    }
+    for (int bx = BinX(tmpXMin); bx <= BinX(tmpXMax); bx++)
+    {
+        for (int by = BinY(tmpYMin); by <= BinY(tmpYMax); by++)
+        {
+            binInserted[static_cast<size_t>(by) * nBinsX + bx].push_back(k) ;
+        }
+    }
+    return true ;
+}
+
+//---------------------------------------------------------------------------------------------
+
+double HyphaeSegmentIndex::DistanceToSegment(int k, double x, double y, double & t) const
+{
+    double ex = x2[k] - x1[k] ;
+    double ey = y2[k] - y1[k] ;
+    double length2 = ex * ex + ey * ey ;
+    t = (length2 > 0.0) ? ( (x - x1[k]) * ex + (y - y1[k]) * ey) / length2 : 0.0 ;
+    t = min(max(t, 0.0), 1.0) ;
+    double px = x1[k] + t * ex - x ;
+    double py = y1[k] + t * ey - y ;
+    return sqrt(px * px + py * py) ;
+}
+
+//---------------------------------------------------------------------------------------------
+
+void HyphaeSegmentIndex::WithinRadius(double x, double y, double radius, vector<int> & found) const
+{
+    found.clear() ;
+    if (empty() )
+    {
+        return ;
+    }
+    int bxMin = BinX(x - radius) ;
+    int bxMax = BinX(x + radius) ;
+    int byMin = BinY(y - radius) ;
+    int byMax = BinY(y + radius) ;
+    double t ;
+    for (int by = byMin; by <= byMax; by++)
+    {
+        for (int bx = bxMin; bx <= bxMax; bx++)
+        {
+            ForEachInBin(static_cast<size_t>(by) * nBinsX + bx, [&](int k)
+            {
+                if (DistanceToSegment(k, x, y, t) < radius)
+                {
+                    found.push_back(k) ;
+                }
+            }) ;
+        }
+    }
+    //A segment is listed in every bin it overlaps
+    sort(found.begin(), found.end() ) ;
+    found.erase(unique(found.begin(), found.end() ), found.end() ) ;
+}
+
+//---------------------------------------------------------------------------------------------
+
+//Rings of bins are searched outwards until no closer segment can be found
+int HyphaeSegmentIndex::Nearest(double x, double y, double maxRadius, double & distance) const
+{
+    int nearest = -1 ;
+    distance = maxRadius ;
+    if (empty() )
+    {
+        return nearest ;
+    }
+    int cx = static_cast<int>(floor( (x - xMin) / binSize) ) ;
+    int cy = static_cast<int>(floor( (y - yMin) / binSize) ) ;
+    //Distance from the query point to the bins, when it is outside of the binned area
+    double outsideX = max(max(xMin - x, x - (xMin + nBinsX * binSize) ), 0.0) ;
+    double outsideY = max(max(yMin - y, y - (yMin + nBinsY * binSize) ), 0.0) ;
+    int maxRing = max(nBinsX, nBinsY) + max(abs(cx), abs(cy) ) ;
+    double t ;
+    for (int ring = 0; ring <= maxRing; ring++)
+    {
+        //Every segment outside of the rings searched so far is at least this far
+        double ringDistance = max( (ring - 1) * binSize, sqrt(outsideX * outsideX + outsideY * outsideY) ) ;
+        if (ring > 0 && ringDistance >= distance)
+        {
+            break ;
+        }
+        for (int by = cy - ring; by <= cy + ring; by++)
+        {
+            if (by < 0 || by >= nBinsY)
+            {
+                continue ;
+            }
+            for (int bx = cx - ring; bx <= cx + ring; bx++)
+            {
+                if (bx < 0 || bx >= nBinsX || (abs(bx - cx) != ring && abs(by - cy) != ring) )
+                {
+                    continue ;
+                }
+                ForEachInBin(static_cast<size_t>(by) * nBinsX + bx, [&](int k)
+                {
+                    double tmpDistance = DistanceToSegment(k, x, y, t) ;
+                    if (tmpDistance < distance)
+                    {
+                        distance = tmpDistance ;
+                        nearest = k ;
+                    }
+                }) ;
+            }
+        }
+    }
+    return nearest ;
+}
+
+//---------------------------------------------------------------------------------------------
+
+//Walks the bins along the ray ( Amanatides-Woo) and stops at the first bin with a hit
+int HyphaeSegmentIndex::RayCast(double x, double y, double dirX, double dirY, double maxLength, double & hitLength) const
+{
+    hitLength = maxLength ;
+    double dirLength = sqrt(dirX * dirX + dirY * dirY) ;
+    if (empty() || dirLength == 0.0)
+    {
+        return -1 ;
+    }
+    dirX /= dirLength ;
+    dirY /= dirLength ;
+    int hit = -1 ;
+    int bx = static_cast<int>(floor( (x - xMin) / binSize) ) ;
+    int by = static_cast<int>(floor( (y - yMin) / binSize) ) ;
+    int stepX = (dirX > 0.0) ? 1 : -1 ;
+    int stepY = (dirY > 0.0) ? 1 : -1 ;
+    double inf = numeric_limits<double>::infinity() ;
+    double tMaxX = (dirX != 0.0) ? ( (xMin + (bx + (stepX > 0 ? 1 : 0) ) * binSize) - x) / dirX : inf ;
+    double tMaxY = (dirY != 0.0) ? ( (yMin + (by + (stepY > 0 ? 1 : 0) ) * binSize) - y) / dirY : inf ;
+    double tDeltaX = (dirX != 0.0) ? binSize / fabs(dirX) : inf ;
+    double tDeltaY = (dirY != 0.0) ? binSize / fabs(dirY) : inf ;
+    double tBin = 0.0 ;
+    while (tBin <= hitLength)
+    {
+        if (bx >= 0 && bx < nBinsX && by >= 0 && by < nBinsY)
+        {
+            ForEachInBin(static_cast<size_t>(by) * nBinsX + bx, [&](int k)
+            {
+                //Intersection of the ray with segment k
+                double ex = x2[k] - x1[k] ;
+                double ey = y2[k] - y1[k] ;
+                double denominator = dirX * ey - dirY * ex ;
+                if (denominator == 0.0)
+                {
+                    return ;
+                }
+                double qx = x1[k] - x ;
+                double qy = y1[k] - y ;
+                double tRay = (qx * ey - qy * ex) / denominator ;
+                double tSegment = (qx * dirY - qy * dirX) / denominator ;
+                if (tRay >= 0.0 && tRay < hitLength && tSegment >= 0.0 && tSegment <= 1.0)
+                {
+                    hitLength = tRay ;
+                    hit = k ;
+                }
+            }) ;
+        }
+        else if ( (stepX > 0 && bx >= nBinsX) || (stepX < 0 && bx < 0) || (stepY > 0 && by >= nBinsY) || (stepY < 0 && by < 0) )
+        {
+            break ;
+        }
+        //A hit inside of this bin can not be beaten by the next bins
+        if (hit >= 0 && hitLength <= min(tMaxX, tMaxY) )
+        {
+            break ;
+        }
+        if (tMaxX < tMaxY)
+        {
+            tBin = tMaxX ;
+            tMaxX += tDeltaX ;
+            bx += stepX ;
+        }
+        else
+        {
+            tBin = tMaxY ;
+            tMaxY += tDeltaY ;
+            by += stepY ;
+        }
+    }
+    return hit ;
+}
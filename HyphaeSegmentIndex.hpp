@@ -0,0 +1,71 @@
+#ifndef HyphaeSegmentIndex_hpp
+#define HyphaeSegmentIndex_hpp
+
+#include <cstdint>
+#include <vector>
+#include "hyphaeSegment.h"
+
+using namespace std ;
+
+//Uniform bins over the hyphae segments. Every segment is listed in the bins its bounding box overlaps,
+//so the queries only look at the segments of the bins around the query point instead of the whole network.
+class HyphaeSegmentIndex
+{
+public:
+    //---------------------------- Parameters and sub-classes ------------------------------
+    HyphaeSegmentIndex () ;
+    double xMin = 0.0 ;
+    double yMin = 0.0 ;
+    double binSize = 1.0 ;
+    int nBinsX = 0 ;
+    int nBinsY = 0 ;
+    //Segments of bin b are segmentIDs[binStart[b]] ... segmentIDs[binStart[b+1] - 1]
+    vector<int> binStart ;
+    vector<int> segmentIDs ;
+    //Segments inserted after Build, per bin. Empty until the first Insert
+    vector<vector<int> > binInserted ;
+    //Copy of the end points, so the index does not depend on the life time of the network
+    vector<double> x1 ;
+    vector<double> y1 ;
+    vector<double> x2 ;
+    vector<double> y2 ;
+    vector<uint8_t> root ;          //1 for the first segments of the network ( from_who == -1)
+
+    //---------------------------- Functions --------------------------------------------
+    //tmpBinSize is usually close to the segment length, the mean segment length is used if it is not positive
+    void Build (const vector<HyphaeSegment> & segments, double tmpBinSize) ;
+    //Add the next segment ( id is the number of segments so far) without building again. False if it is outside
+    //of the binned area, then the index has to be built again
+    bool Insert (const HyphaeSegment & segment) ;
+    bool empty () const { return x1.empty() ; }
+    //Distance from (x, y) to segment k, and the relative position (0 at x1, 1 at x2) of the closest point
+    double DistanceToSegment (int k, double x, double y, double & t) const ;
+    //Closest segment within maxRadius, -1 if there is none
+    int Nearest (double x, double y, double maxRadius, double & distance) const ;
+    //All segments closer than radius
+    void WithinRadius (double x, double y, double radius, vector<int> & found) const ;
+    //First segment hit by the ray from (x, y) along (dirX, dirY) within maxLength, -1 if there is none
+    int RayCast (double x, double y, double dirX, double dirY, double maxLength, double & hitLength) const ;
+
+private:
+    int BinX (double x) const ;
+    int BinY (double y) const ;
+    //Calls visit(k) for every segment k of bin b
+    template <class F>
+    void ForEachInBin (size_t b, F visit) const
+    {
+        for (int s = binStart[b]; s < binStart[b + 1]; s++)
+        {
+            visit(segmentIDs[s]) ;
+        }
+        if (binInserted.empty() == false)
+        {
+            for (size_t s = 0; s < binInserted[b].size(); s++)
+            {
+                visit(binInserted[b][s]) ;
+            }
+        }
+    }
+};
+
+#endif /* HyphaeSegmentIndex_hpp */
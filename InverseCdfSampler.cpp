@@ -0,0 +1,146 @@
+#include "InverseCdfSampler.hpp"
+
+InverseCdfSampler::InverseCdfSampler ()
+{
+}
+
+//---------------------------------------------------------------------------------------------
+
+void InverseCdfSampler::Build(const function<double(double)> & inverseCdf, double lowest, double highest)
+{
+    table.resize(nIntervals + 1) ;
+    table[0] = lowest ;
+    table[nIntervals] = highest ;
+    for (int k = 1; k < nIntervals; k++)
+    {
+        table[k] = inverseCdf(static_cast<double>(k) / nIntervals) ;
+    }
+}
+
+//---------------------------------------------------------------------------------------------
+
+//Same distribution as log_normal_truncated_ab_sample: the log of the sample is normal, truncated to [log a, log b]
+void InverseCdfSampler::Build_TruncatedLogNormal(double mu, double sigma, double a, double b)
+{
+    double cdfA = a > 0.0 ? NormalCdf( (log(a) - mu) / sigma) : 0.0 ;
+    double cdfB = NormalCdf( (log(b) - mu) / sigma) ;
+    Build([=](double p) { return exp(mu + sigma * NormalQuantile(cdfA + p * (cdfB - cdfA) ) ) ; }, a, b) ;
+}
+
+//---------------------------------------------------------------------------------------------
+
+void InverseCdfSampler::Build_TruncatedExponential(double rate, double norm)
+{
+    Build([=](double p) { return -log(1.0 - p / norm) / rate ; }, 0.0, -log(1.0 - 1.0 / norm) / rate) ;
+}
+
+//---------------------------------------------------------------------------------------------
+
+void InverseCdfSampler::Sample(const double * u, double * x, int n) const
+{
+    const double * tmpTable = table.data() ;
+    int tmpN = nIntervals ;
+    #pragma omp simd
+    for (int i = 0; i < n; i++)
+    {
+        double t = u[i] * tmpN ;
+        int k = static_cast<int>(t) ;
+        k = k < tmpN - 1 ? k : tmpN - 1 ;
+        x[i] = tmpTable[k] + (t - k) * (tmpTable[k + 1] - tmpTable[k]) ;
+    }
+}
+
+//---------------------------------------------------------------------------------------------
+
+double InverseCdfSampler::NormalCdf(double z)
+{
+    return 0.5 * erfc(-z / sqrt(2.0) ) ;
+}
+
+//---------------------------------------------------------------------------------------------
+
+//Acklam's rational approximation, then one Halley step with erfc for full double precision
+double InverseCdfSampler::NormalQuantile(double p)
+{
+    const double a[6] = {-3.969683028665376e+01, 2.209460984245205e+02, -2.759285104469687e+02,
+                          1.383577518672690e+02, -3.066479806614716e+01, 2.506628277459239e+00} ;
+    const double b[5] = {-5.447609879822406e+01, 1.615858368580409e+02, -1.556989798598866e+02,
+                          6.680131188771972e+01, -1.328068155288572e+01} ;
+    const double c[6] = {-7.784894002430293e-03, -3.223964580411365e-01, -2.400758277161838e+00,
+                         -2.549732539343734e+00, 4.374664141464968e+00, 2.938163982698783e+00} ;
+    const double d[4] = {7.784695709041462e-03, 3.224671290700398e-01, 2.445134137142996e+00,
+                          3.754408661907416e+00} ;
+    const double pLow = 0.02425 ;
+    double z ;
+    if (p < pLow)
+    {
+        double q = sqrt(-2.0 * log(p) ) ;
+        z = (((((c[0] * q + c[1]) * q + c[2]) * q + c[3]) * q + c[4]) * q + c[5]) /
+            ((((d[0] * q + d[1]) * q + d[2]) * q + d[3]) * q + 1.0) ;
+    }
+    else if (p <= 1.0 - pLow)
+    {
+        double q = p - 0.5 ;
+        double r = q * q ;
+        z = (((((a[0] * r + a[1]) * r + a[2]) * r + a[3]) * r + a[4]) * r + a[5]) * q /
+            (((((b[0] * r + b[1]) * r + b[2]) * r + b[3]) * r + b[4]) * r + 1.0) ;
+    }
+    else
+    {
+        double q = sqrt(-2.0 * log(1.0 - p) ) ;
+        z = -(((((c[0] * q + c[1]) * q + c[2]) * q + c[3]) * q + c[4]) * q + c[5]) /
+             ((((d[0] * q + d[1]) * q + d[2]) * q + d[3]) * q + 1.0) ;
+    }
+    double e = NormalCdf(z) - p ;
+    double u = e * sqrt(2.0 * M_PI) * exp(z * z / 2.0) ;
+    return z - u / (1.0 + z * u / 2.0) ;
+}
+
+//---------------------------------------------------------------------------------------------
+
+SampleBuffers::SampleBuffers ()
+{
+}
+
+//---------------------------------------------------------------------------------------------
+
+void SampleBuffers::Initialize(const InverseCdfSampler * tmpSampler, Random_Purpose tmpPurpose, int tmpNBacteria)
+{
+    sampler = tmpSampler ;
+    purpose = tmpPurpose ;
+    nBacteria = tmpNBacteria ;
+    samples.assign(static_cast<size_t>(nBacteria) * depth, 0.0) ;
+    used.assign(nBacteria, depth) ;
+    refills.assign(nBacteria, 0) ;
+    uniforms.resize(static_cast<size_t>(nBacteria) * depth) ;
+}
+
+//---------------------------------------------------------------------------------------------
+
+void SampleBuffers::Refill(int i, const RandomGenerator & rng)
+{
+    RandomStream tmpRandom = rng.Stream(i, refills[i]++, purpose) ;
+    double * tmpUniforms = &uniforms[static_cast<size_t>(i) * depth] ;
+    for (int k = 0; k < depth; k++)
+    {
+        tmpUniforms[k] = tmpRandom.Uniform() ;
+    }
+    sampler->Sample(tmpUniforms, &samples[static_cast<size_t>(i) * depth], depth) ;
+    used[i] = 0 ;
+}
+
+//---------------------------------------------------------------------------------------------
+
+void SampleBuffers::Refill_All(const RandomGenerator & rng)
+{
+    for (int i = 0; i < nBacteria; i++)
+    {
+        RandomStream tmpRandom = rng.Stream(i, refills[i]++, purpose) ;
+        for (int k = 0; k < depth; k++)
+        {
+            uniforms[static_cast<size_t>(i) * depth + k] = tmpRandom.Uniform() ;
+        }
+        used[i] = 0 ;
+    }
+    sampler->Sample(uniforms.data(), samples.data(), nBacteria * depth) ;
+}
@@ -0,0 +1,71 @@
+#ifndef InverseCdfSampler_hpp
+#define InverseCdfSampler_hpp
+
+#include <vector>
+#include <cmath>
+#include <functional>
+#include "RandomStreams.hpp"
+
+using namespace std ;
+
+//Samples of a distribution by linear interpolation in a table of its inverse CDF, built once when the parameters are read.
+//A sample costs one multiply, one table lookup and one interpolation, with no log, exp or rejection.
+class InverseCdfSampler
+{
+public:
+    //---------------------------- Parameters and sub-classes ------------------------------
+    InverseCdfSampler () ;
+    int nIntervals = 4096 ;
+    vector<double> table ;              //inverse CDF at k / nIntervals, k = 0 ... nIntervals
+
+    //---------------------------- Functions --------------------------------------------
+    void Build (const function<double(double)> & inverseCdf, double lowest, double highest) ;
+    //log-normal of the underlying normal (mu, sigma), truncated to [a, b]
+    void Build_TruncatedLogNormal (double mu, double sigma, double a, double b) ;
+    //CDF norm * (1 - exp(-rate * x)), truncated where it reaches 1
+    void Build_TruncatedExponential (double rate, double norm) ;
+    double Sample (double u) const
+    {
+        double t = u * nIntervals ;
+        int k = min(static_cast<int>(t), nIntervals - 1) ;
+        return table[k] + (t - k) * (table[k + 1] - table[k]) ;
+    }
+    //x[k] = Sample(u[k]), vectorized
+    void Sample (const double * u, double * x, int n) const ;
+
+    static double NormalCdf (double z) ;
+    static double NormalQuantile (double p) ;
+};
+
+//A few samples of one distribution for every bacterium, drawn ahead of time. A bacterium that runs out refills its own
+//buffer in one batch from its stream ( bacterium, refill, purpose), so the samples do not depend on the order of use.
+class SampleBuffers
+{
+public:
+    //---------------------------- Parameters and sub-classes ------------------------------
+    SampleBuffers () ;
+    int depth = 16 ;
+    int nBacteria = 0 ;
+    Random_Purpose purpose = random_runDuration ;
+    const InverseCdfSampler * sampler = nullptr ;
+    vector<double> samples ;            //bacterium i at i * depth ...
+    vector<int> used ;
+    vector<long> refills ;
+    vector<double> uniforms ;
+
+    //---------------------------- Functions --------------------------------------------
+    void Initialize (const InverseCdfSampler * tmpSampler, Random_Purpose tmpPurpose, int tmpNBacteria) ;
+    void Refill (int i, const RandomGenerator & rng) ;
+    //every buffer full, one batch for the whole population
+    void Refill_All (const RandomGenerator & rng) ;
+    double Next (int i, const RandomGenerator & rng)
+    {
+        if (used[i] == depth)
+        {
+            Refill(i, rng) ;
+        }
+        return samples[static_cast<size_t>(i) * depth + used[i]++] ;
+    }
+};
+
+#endif /* InverseCdfSampler_hpp */
@@ -0,0 +1,262 @@
+#include "MotilityAnalytics.hpp"
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+
+void MultiTauCorrelator::Resize(int tmpLevels, int tmpPoints, int tmpBlock)
+{
+    nLevels = tmpLevels ;
+    nPoints = tmpPoints ;
+    blockSize = tmpBlock ;
+    position.assign(nLevels * nPoints * 2, 0.0) ;
+    velocity.assign(nLevels * nPoints * 2, 0.0) ;
+    head.assign(nLevels, 0) ;
+    filled.assign(nLevels, 0) ;
+    blockPosition.assign(nLevels * 2, 0.0) ;
+    blockVelocity.assign(nLevels * 2, 0.0) ;
+    blockCount.assign(nLevels, 0) ;
+    msd.assign(nLevels * nPoints, 0.0) ;
+    vacf.assign(nLevels * nPoints, 0.0) ;
+    count.assign(nLevels * nPoints, 0) ;
+}
+
+//---------------------------------------------------------------------------------------------
+
+void MultiTauCorrelator::Add(int level, double x, double y, double vx, double vy)
+{
+    if (level >= nLevels)
+    {
+        return ;
+    }
+    int h = (head[level] + nPoints - 1) % nPoints ;
+    head[level] = h ;
+    double * p = &position[level * nPoints * 2] ;
+    double * v = &velocity[level * nPoints * 2] ;
+    p[2 * h] = x ;
+    p[2 * h + 1] = y ;
+    v[2 * h] = vx ;
+    v[2 * h + 1] = vy ;
+    filled[level]++ ;
+
+    //the lags below nPoints / blockSize of a level are covered by the level below it
+    long available = min(filled[level], static_cast<long>(nPoints) ) ;
+    int first = level == 0 ? 0 : nPoints / blockSize ;
+    for (int k = first; k < available; k++)
+    {
+        int slot = (h + k) % nPoints ;
+        double dx = x - p[2 * slot] ;
+        double dy = y - p[2 * slot + 1] ;
+        msd[level * nPoints + k] += dx * dx + dy * dy ;
+        vacf[level * nPoints + k] += vx * v[2 * slot] + vy * v[2 * slot + 1] ;
+        count[level * nPoints + k]++ ;
+    }
+
+    blockPosition[2 * level] += x ;
+    blockPosition[2 * level + 1] += y ;
+    blockVelocity[2 * level] += vx ;
+    blockVelocity[2 * level + 1] += vy ;
+    blockCount[level]++ ;
+    if (blockCount[level] == blockSize)
+    {
+        Add(level + 1, blockPosition[2 * level] / blockSize, blockPosition[2 * level + 1] / blockSize,
+            blockVelocity[2 * level] / blockSize, blockVelocity[2 * level + 1] / blockSize) ;
+        blockPosition[2 * level] = 0.0 ;
+        blockPosition[2 * level + 1] = 0.0 ;
+        blockVelocity[2 * level] = 0.0 ;
+        blockVelocity[2 * level + 1] = 0.0 ;
+        blockCount[level] = 0 ;
+    }
+}
+
+//---------------------------------------------------------------------------------------------
+
+void LogHistogram::Resize(const string & tmpName, double tmpMin, int decades, int tmpBinsPerDecade)
+{
+    name = tmpName ;
+    minValue = tmpMin ;
+    binsPerDecade = tmpBinsPerDecade ;
+    bins.assign(decades * binsPerDecade, 0) ;
+    underflow = 0 ;
+    overflow = 0 ;
+    n = 0 ;
+    mean = 0.0 ;
+    m2 = 0.0 ;
+}
+
+//---------------------------------------------------------------------------------------------
+
+void LogHistogram::Add(double value)
+{
+    if (n == 0)
+    {
+        smallest = value ;
+        largest = value ;
+    }
+    smallest = min(smallest, value) ;
+    largest = max(largest, value) ;
+    n++ ;
+    double delta = value - mean ;
+    mean += delta / n ;
+    m2 += delta * (value - mean) ;
+
+    if (value < minValue)
+    {
+        underflow++ ;
+        return ;
+    }
+    long bin = static_cast<long>(floor(log10(value / minValue) * binsPerDecade) ) ;
+    if (bin >= static_cast<long>(bins.size() ) )
+    {
+        overflow++ ;
+        return ;
+    }
+    bins[bin]++ ;
+}
+
+//---------------------------------------------------------------------------------------------
+
+void LogHistogram::Write(ostream & str) const
+{
+    double deviation = n > 1 ? sqrt(m2 / (n - 1) ) : 0.0 ;
+    str<<"#"<<name<<": n "<<n<<" mean "<<mean<<" sd "<<deviation<<" min "<<smallest<<" max "<<largest
+       <<" underflow "<<underflow<<" overflow "<<overflow<<endl ;
+    for (size_t b = 0; b < bins.size(); b++)
+    {
+        if (bins[b] == 0)
+        {
+            continue ;
+        }
+        double lower = minValue * pow(10.0, static_cast<double>(b) / binsPerDecade) ;
+        double upper = minValue * pow(10.0, static_cast<double>(b + 1) / binsPerDecade) ;
+        str<<lower<<'\t'<<upper<<'\t'<<bins[b]<<endl ;
+    }
+    str<<endl ;
+}
+
+//---------------------------------------------------------------------------------------------
+
+MotilityAnalytics::MotilityAnalytics ()
+{
+}
+
+//---------------------------------------------------------------------------------------------
+
+void MotilityAnalytics::Initialize(int nBacteria, double tmpInterval, int nLevels, int nPoints, int blockSize)
+{
+    interval = tmpInterval ;
+    nSamples = 0 ;
+    lastX.assign(nBacteria, 0.0) ;
+    lastY.assign(nBacteria, 0.0) ;
+    runStart.assign(nBacteria, -1.0) ;
+    correlators.resize(nBacteria) ;
+    for (MultiTauCorrelator & correlator : correlators)
+    {
+        correlator.Resize(nLevels, nPoints, blockSize) ;
+    }
+    //durations in s from 10 us, angles in rad from 1 urad
+    histograms[histogram_run].Resize("run duration", 1.0e-5, 8, 10) ;
+    histograms[histogram_wrap].Resize("wrap duration", 1.0e-5, 8, 10) ;
+    histograms[histogram_turn].Resize("turn duration", 1.0e-5, 8, 10) ;
+    histograms[histogram_turnAngle].Resize("turn angle", 1.0e-6, 7, 10) ;
+    histograms[histogram_wrapAngle].Resize("wrap angle", 1.0e-6, 7, 10) ;
+}
+
+//---------------------------------------------------------------------------------------------
+
+void MotilityAnalytics::Sample(const double * x, const double * y)
+{
+    int nBacteria = static_cast<int>(correlators.size() ) ;
+    //the first sample only gives the start of the first velocity
+    if (nSamples > 0)
+    {
+        #pragma omp parallel for
+        for (int i = 0; i < nBacteria; i++)
+        {
+            double vx = (x[i] - lastX[i]) / interval ;
+            double vy = (y[i] - lastY[i]) / interval ;
+            correlators[i].Add(0, x[i], y[i], vx, vy) ;
+        }
+    }
+    copy(x, x + nBacteria, lastX.begin() ) ;
+    copy(y, y + nBacteria, lastY.begin() ) ;
+    nSamples++ ;
+}
+
+//---------------------------------------------------------------------------------------------
+
+void MotilityAnalytics::Event(int i, MotilityLog_Event type, double time, double angle, double duration)
+{
+    if (IsActive() == false)
+    {
+        return ;
+    }
+    //a run starts with a reversal and ends with the next reversal or with a wrap
+    if (type == motilityLog_reversal || type == motilityLog_wrapStart)
+    {
+        if (runStart[i] >= 0.0)
+        {
+            histograms[histogram_run].Add(time - runStart[i]) ;
+        }
+        runStart[i] = type == motilityLog_reversal ? time : -1.0 ;
+    }
+    if (type == motilityLog_reversal)
+    {
+        histograms[histogram_turnAngle].Add(fabs(angle) ) ;
+    }
+    else if (type == motilityLog_wrapStart)
+    {
+        histograms[histogram_wrapAngle].Add(fabs(angle) ) ;
+    }
+    else if (type == motilityLog_wrapEnd)
+    {
+        histograms[histogram_wrap].Add(duration) ;
+    }
+    else if (type == motilityLog_turnEnd)
+    {
+        histograms[histogram_turn].Add(duration) ;
+    }
+}
+
+//---------------------------------------------------------------------------------------------
+
+void MotilityAnalytics::Write(const string & msdFile, const string & histogramFile) const
+{
+    if (IsActive() == false)
+    {
+        return ;
+    }
+    const MultiTauCorrelator & layout = correlators[0] ;
+    ofstream strMSD (msdFile.c_str() ) ;
+    strMSD<<"#lag\tMSD\tVACF\tsamples"<<endl ;
+    strMSD<<setprecision(10) ;
+    double levelLag = interval ;
+    for (int level = 0; level < layout.nLevels; level++)
+    {
+        int first = level == 0 ? 0 : layout.nPoints / layout.blockSize ;
+        for (int k = first; k < layout.nPoints; k++)
+        {
+            double msd = 0.0 ;
+            double vacf = 0.0 ;
+            long n = 0 ;
+            for (const MultiTauCorrelator & correlator : correlators)
+            {
+                msd += correlator.msd[level * layout.nPoints + k] ;
+                vacf += correlator.vacf[level * layout.nPoints + k] ;
+                n += correlator.count[level * layout.nPoints + k] ;
+            }
+            if (n > 0)
+            {
+                strMSD<<k * levelLag<<'\t'<<msd / n<<'\t'<<vacf / n<<'\t'<<n<<endl ;
+            }
+        }
+        levelLag *= layout.blockSize ;
+    }
+
+    ofstream strHistograms (histogramFile.c_str() ) ;
+    strHistograms<<setprecision(10) ;
+    for (int h = 0; h < numberHistograms; h++)
+    {
+        histograms[h].Write(strHistograms) ;
+    }
+}
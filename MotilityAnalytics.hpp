@@ -0,0 +1,85 @@
+#ifndef MotilityAnalytics_hpp
+#define MotilityAnalytics_hpp
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+#include "MotilityEventLog.hpp"
+
+using namespace std ;
+
+//Multi-tau correlator of one bacterium. Level 0 keeps the last nPoints samples, every higher level the last nPoints
+//averages of blockSize values of the level below, so the lags grow geometrically and the memory is nLevels * nPoints.
+//The mean squared displacement uses the positions and the velocity autocorrelation the velocities of the same blocks
+struct MultiTauCorrelator
+{
+    int nLevels = 0 ;
+    int nPoints = 0 ;
+    int blockSize = 2 ;
+    vector<double> position ;       //( level * nPoints + k) * 2, newest at head[level]
+    vector<double> velocity ;
+    vector<int> head ;
+    vector<long> filled ;           //values inserted in every level
+    vector<double> blockPosition ;  //sum of the values waiting to be averaged, level * 2
+    vector<double> blockVelocity ;
+    vector<int> blockCount ;
+    vector<double> msd ;            //sums, level * nPoints + lag index
+    vector<double> vacf ;
+    vector<long> count ;
+
+    void Resize (int tmpLevels, int tmpPoints, int tmpBlock) ;
+    void Add (int level, double x, double y, double vx, double vy) ;
+};
+
+//Streaming histogram of a positive quantity with log spaced bins, and its exact count, mean, deviation and range
+struct LogHistogram
+{
+    string name ;
+    double minValue = 1.0e-6 ;
+    int binsPerDecade = 10 ;
+    vector<long> bins ;
+    long underflow = 0 ;            //below minValue, zero included
+    long overflow = 0 ;
+    long n = 0 ;
+    double mean = 0.0 ;
+    double m2 = 0.0 ;               //Welford sum of squared deviations
+    double smallest = 0.0 ;
+    double largest = 0.0 ;
+
+    void Resize (const string & tmpName, double tmpMin, int decades, int tmpBinsPerDecade) ;
+    void Add (double value) ;
+    //A header line, then lower edge, upper edge and count of every non-empty bin
+    void Write (ostream & str) const ;
+};
+
+//In-situ statistics of the whole population, so long runs can be compared with experiments without the trajectories.
+//Sample is called every sampling interval with the center positions, Event with every motility event.
+//Write replaces the summary files, MSD ( lag, mean squared displacement, velocity autocorrelation, samples) and
+//histograms of the run, wrap and turn durations and of the turn and wrap angles
+class MotilityAnalytics
+{
+public:
+    //---------------------------- Parameters and sub-classes ------------------------------
+    MotilityAnalytics () ;
+    enum { histogram_run = 0, histogram_wrap, histogram_turn, histogram_turnAngle, histogram_wrapAngle, numberHistograms } ;
+    LogHistogram histograms[numberHistograms] ;
+
+    //---------------------------- Functions --------------------------------------------
+    void Initialize (int nBacteria, double tmpInterval, int nLevels, int nPoints, int blockSize) ;
+    bool IsActive () const { return correlators.empty() == false ; }
+    //center positions of every bacterium, interval apart
+    void Sample (const double * x, const double * y) ;
+    void Event (int i, MotilityLog_Event type, double time, double angle, double duration) ;
+    void Write (const string & msdFile, const string & histogramFile) const ;
+
+private:
+    double interval = 0.0 ;
+    long nSamples = 0 ;
+    vector<double> lastX ;
+    vector<double> lastY ;
+    vector<double> runStart ;       //time the current run started, negative while not running or not known
+    vector<MultiTauCorrelator> correlators ;
+};
+
+#endif /* MotilityAnalytics_hpp */
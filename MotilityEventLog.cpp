@@ -0,0 +1,125 @@
+#include "MotilityEventLog.hpp"
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+static const char motilityLogMagic[8] = {'M','O','T','I','L','L','O','G'} ;
+static const uint32_t motilityLogVersion = 1 ;
+
+MotilityEventLog::MotilityEventLog ()
+{
+}
+
+//---------------------------------------------------------------------------------------------
+
+MotilityEventLog::~MotilityEventLog ()
+{
+    Close() ;
+}
+
+//---------------------------------------------------------------------------------------------
+
+void MotilityEventLog::Open(const string & fileName, int ringRecords)
+{
+    Close() ;
+    file = fopen(fileName.c_str(), "wb") ;
+    if (file == nullptr)
+    {
+        cout<<"Could not open motility event log "<<fileName<<endl ;
+        return ;
+    }
+    MotilityLogHeader header ;
+    memcpy(header.magic, motilityLogMagic, sizeof(motilityLogMagic) ) ;
+    header.version = motilityLogVersion ;
+    header.recordBytes = sizeof(MotilityLogRecord) ;
+    fwrite(&header, sizeof(header), 1, file) ;
+
+    int nThreads = 1 ;
+#ifdef _OPENMP
+    nThreads = omp_get_max_threads() ;
+#endif
+    rings = vector<Ring>(nThreads) ;
+    for (Ring & ring : rings)
+    {
+        ring.records.resize(max(ringRecords, 1) ) ;
+    }
+    recordsWritten = 0 ;
+    ringFlushes = 0 ;
+}
+
+//---------------------------------------------------------------------------------------------
+
+void MotilityEventLog::Record(const MotilityLogRecord & record)
+{
+    if (file == nullptr)
+    {
+        return ;
+    }
+    size_t thread = 0 ;
+#ifdef _OPENMP
+    thread = omp_get_thread_num() ;
+#endif
+    //nested regions can have more threads than the rings made at Open
+    if (thread >= rings.size() )
+    {
+        lock_guard<mutex> lock (fileMutex) ;
+        fwrite(&record, sizeof(record), 1, file) ;
+        recordsWritten++ ;
+        return ;
+    }
+    Ring & ring = rings[thread] ;
+    ring.records[ring.used] = record ;
+    ring.records[ring.used].thread = static_cast<uint8_t>(thread) ;
+    ring.used++ ;
+    if (ring.used == ring.records.size() )
+    {
+        Drain(ring) ;
+    }
+}
+
+//---------------------------------------------------------------------------------------------
+
+void MotilityEventLog::Drain(Ring & ring)
+{
+    if (ring.used == 0)
+    {
+        return ;
+    }
+    lock_guard<mutex> lock (fileMutex) ;
+    fwrite(ring.records.data(), sizeof(MotilityLogRecord), ring.used, file) ;
+    recordsWritten += ring.used ;
+    ringFlushes++ ;
+    ring.used = 0 ;
+}
+
+//---------------------------------------------------------------------------------------------
+
+void MotilityEventLog::Flush()
+{
+    if (file == nullptr)
+    {
+        return ;
+    }
+    for (Ring & ring : rings)
+    {
+        Drain(ring) ;
+    }
+    fflush(file) ;
+}
+
+//---------------------------------------------------------------------------------------------
+
+void MotilityEventLog::Close()
+{
+    if (file == nullptr)
+    {
+        return ;
+    }
+    Flush() ;
+    fclose(file) ;
+    file = nullptr ;
+    rings.clear() ;
+}
@@ -0,0 +1,76 @@
+#ifndef MotilityEventLog_hpp
+#define MotilityEventLog_hpp
+
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <vector>
+
+using namespace std ;
+
+enum MotilityLog_Event
+{
+    motilityLog_reversal = 0 ,      //angle: turn angle, duration: drawn duration of the run that starts
+    motilityLog_wrapStart = 1 ,     //angle: wrap angle per step, duration: drawn wrap duration
+    motilityLog_wrapEnd = 2 ,       //angle: wrap angle per step, duration: time spent wrapping
+    motilityLog_turnEnd = 3         //angle: turn angle, duration: time spent turning
+};
+
+struct MotilityLogHeader
+{
+    char magic[8] ;                 //"MOTILLOG"
+    uint32_t version ;
+    uint32_t recordBytes ;
+};
+
+//Position and orientation of the bacterium right after the event
+struct MotilityLogRecord
+{
+    double time ;
+    int64_t step ;                  //eventStep
+    int32_t bacterium ;
+    uint8_t type ;                  //MotilityLog_Event
+    uint8_t thread ;                //ring the record went through
+    uint16_t reserved ;
+    double angle ;
+    double duration ;
+    double x ;                      //center node
+    double y ;
+    double orientation ;
+};
+
+//Reversal, wrap and turn events of every bacterium in one binary file of MotilityLogRecord after a MotilityLogHeader.
+//Every thread fills its own ring of ringRecords records, without locking, and a full ring is written in one fwrite.
+//The records of different rings are not interleaved in time, the readers sort them by ( step, bacterium) if needed
+class MotilityEventLog
+{
+public:
+    //---------------------------- Parameters and sub-classes ------------------------------
+    MotilityEventLog () ;
+    ~MotilityEventLog () ;
+    long recordsWritten = 0 ;
+    long ringFlushes = 0 ;
+
+    //---------------------------- Functions --------------------------------------------
+    void Open (const string & fileName, int ringRecords) ;
+    bool IsOpen () const { return file != nullptr ; }
+    void Record (const MotilityLogRecord & record) ;
+    //Write every ring, called outside of parallel regions
+    void Flush () ;
+    void Close () ;
+
+private:
+    //One cache line apart, so the rings of different threads do not share their counters
+    struct alignas(64) Ring
+    {
+        vector<MotilityLogRecord> records ;
+        size_t used = 0 ;
+    };
+    void Drain (Ring & ring) ;
+    vector<Ring> rings ;
+    FILE * file = nullptr ;
+    mutex fileMutex ;
+};
+
+#endif /* MotilityEventLog_hpp */
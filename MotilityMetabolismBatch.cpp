@@ -0,0 +1,94 @@
+#include "MotilityMetabolismBatch.hpp"
+
+MotilityMetabolismBatch::MotilityMetabolismBatch ()
+{
+}
+
+//---------------------------------------------------------------------------------------------
+
+void MotilityMetabolismBatch::Gather(const bacterium * tmpBacteria, int nBacteria)
+{
+    n = nBacteria ;
+    parameters = tmpBacteria[0].motilityMetabolism ;
+    legand.resize(n) ;
+    speciesLegand.resize(static_cast<size_t>(parameters.nSpecies) * n) ;
+    methylation.resize(n) ;
+    receptorActivity.resize(n) ;
+    switchProbability.resize(n) ;
+    legandEnergy.resize(n) ;
+    methylEnergy.resize(n) ;
+    for (int i = 0; i < n; i++)
+    {
+        const MotilityMetabolism & mm = tmpBacteria[i].motilityMetabolism ;
+        legand[i] = mm.legand ;
+        methylation[i] = mm.methylation ;
+        receptorActivity[i] = mm.receptorActivity ;
+        for (int s = 1; s < parameters.nSpecies; s++)
+        {
+            speciesLegand[static_cast<size_t>(s) * n + i] = mm.speciesLegand[s] ;
+        }
+    }
+}
+
+//---------------------------------------------------------------------------------------------
+
+void MotilityMetabolismBatch::Scatter(bacterium * tmpBacteria) const
+{
+    for (int i = 0; i < n; i++)
+    {
+        MotilityMetabolism & mm = tmpBacteria[i].motilityMetabolism ;
+        mm.methylation = methylation[i] ;
+        mm.receptorActivity = receptorActivity[i] ;
+        mm.switchProbability = switchProbability[i] ;
+        mm.LegandEnergy = legandEnergy[i] ;
+        mm.MethylEnergy = methylEnergy[i] ;
+    }
+}
+
+//---------------------------------------------------------------------------------------------
+
+void MotilityMetabolismBatch::Cal_SwitchProbability(double tmpDt, int nRepeat)
+{
+    const MotilityMetabolism & p = parameters ;
+    double invKI = 1.0 / p.kI ;
+    double invKA = 1.0 / p.kA ;
+    const double * tmpLegand = legand.data() ;
+    double * tmpLegandEnergy = legandEnergy.data() ;
+    #pragma omp simd
+    for (int i = 0; i < n; i++)
+    {
+        tmpLegandEnergy[i] = VectorMath::Log( (1.0 + tmpLegand[i] * invKI) / (1.0 + tmpLegand[i] * invKA) ) ;
+    }
+    for (int s = 1; s < p.nSpecies; s++)
+    {
+        const double * tmpSpecies = &speciesLegand[static_cast<size_t>(s) * n] ;
+        double sign = p.speciesSign[s] ;
+        double speciesInvKI = 1.0 / p.species_kI[s] ;
+        double speciesInvKA = 1.0 / p.species_kA[s] ;
+        #pragma omp simd
+        for (int i = 0; i < n; i++)
+        {
+            tmpLegandEnergy[i] += sign * VectorMath::Log( (1.0 + tmpSpecies[i] * speciesInvKI) / (1.0 + tmpSpecies[i] * speciesInvKA) ) ;
+        }
+    }
+
+    double * tmpMethylation = methylation.data() ;
+    double * tmpActivity = receptorActivity.data() ;
+    double * tmpSwitch = switchProbability.data() ;
+    double * tmpMethylEnergy = methylEnergy.data() ;
+    for (int l = 0; l < nRepeat; l++)
+    {
+        #pragma omp simd
+        for (int i = 0; i < n; i++)
+        {
+            double a = tmpActivity[i] ;
+            double m = tmpMethylation[i] + tmpDt * (p.kR * (1.0 - a) - p.kB * a) ;
+            double methylE = p.km * (p.m0 - m) ;
+            a = 1.0 / (1.0 + VectorMath::Exp(p.N * (tmpLegandEnergy[i] + methylE) ) ) ;
+            tmpMethylation[i] = m ;
+            tmpMethylEnergy[i] = methylE ;
+            tmpActivity[i] = a ;
+            tmpSwitch[i] = VectorMath::Exp(p.lnA_a + p.b * (a / (a + p.gamma) ) ) ;
+        }
+    }
+}
@@ -0,0 +1,32 @@
+#ifndef MotilityMetabolismBatch_hpp
+#define MotilityMetabolismBatch_hpp
+
+#include "Bacteria.hpp"
+#include "VectorMath.hpp"
+
+//Receptor model of all bacteria in one structure of arrays, so one vectorized loop updates the whole population.
+//The parameters are the same for every bacterium and are taken from the first one.
+class MotilityMetabolismBatch
+{
+public:
+    //---------------------------- Parameters and sub-classes ------------------------------
+    MotilityMetabolismBatch () ;
+    int n = 0 ;
+    MotilityMetabolism parameters ;
+    vector<double> legand ;
+    vector<double> speciesLegand ;          //species s of bacterium i at (s * n + i), s >= 1
+    vector<double> methylation ;
+    vector<double> receptorActivity ;
+    vector<double> switchProbability ;
+    vector<double> legandEnergy ;
+    vector<double> methylEnergy ;
+
+    //---------------------------- Functions --------------------------------------------
+    void Gather (const bacterium * tmpBacteria, int nBacteria) ;
+    void Scatter (bacterium * tmpBacteria) const ;
+    //Same as calling MotilityMetabolism::Cal_SwitchProbability(tmpDt) nRepeat times for every bacterium.
+    //The legand does not change between the repeats, so its energy is found once
+    void Cal_SwitchProbability (double tmpDt, int nRepeat) ;
+};
+
+#endif /* MotilityMetabolismBatch_hpp */
@@ -23,6 +23,7 @@ using namespace std ;
 //#define domainx  1000.0
 //#define domainy  1000.0
 #define nPili   1
+#define maxChemoSpecies 8                                      // ligands of one grid fit in a cache line
 
 
 class node
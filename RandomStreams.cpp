@@ -0,0 +1,135 @@
+#include "RandomStreams.hpp"
+#include <iostream>
+#include <chrono>
+
+RandomStream::RandomStream (uint64_t runSeed, uint32_t id, uint64_t step, Random_Purpose purpose)
+{
+    key[0] = static_cast<uint32_t>(runSeed) ;
+    key[1] = static_cast<uint32_t>(runSeed >> 32) ;
+    counter[0] = 0 ;
+    counter[1] = id ;
+    counter[2] = static_cast<uint32_t>(step) ;
+    counter[3] = (static_cast<uint32_t>(step >> 32) & 0x00ffffff) | (static_cast<uint32_t>(purpose) << 24) ;
+}
+
+//---------------------------------------------------------------------------------------------
+
+uint32_t RandomStream::NextInt()
+{
+    if (used == 4)
+    {
+        for (int k = 0; k < 4; k++)
+        {
+            block[k] = counter[k] ;
+        }
+        RandomGenerator::Philox4x32(block, key) ;
+        counter[0]++ ;
+        used = 0 ;
+    }
+    return block[used++] ;
+}
+
+//---------------------------------------------------------------------------------------------
+
+//53 random bits
+double RandomStream::Uniform()
+{
+    uint64_t tmp = (static_cast<uint64_t>(NextInt() ) << 32) | NextInt() ;
+    return (tmp >> 11) * (1.0 / 9007199254740992.0) ;
+}
+
+//---------------------------------------------------------------------------------------------
+
+double RandomStream::OpenUniform()
+{
+    uint64_t tmp = (static_cast<uint64_t>(NextInt() ) << 32) | NextInt() ;
+    return ( (tmp >> 12) + 0.5) * (1.0 / 4503599627370496.0) ;
+}
+
+//---------------------------------------------------------------------------------------------
+
+//Box-Muller, the second value of every pair is kept for the next call. Same numbers as RandomGenerator::BoxMuller
+double RandomStream::Gaussian()
+{
+    if (hasGaussian)
+    {
+        hasGaussian = false ;
+        return nextGaussian ;
+    }
+    double r = VectorMath::Sqrt(-2.0 * VectorMath::Log(OpenUniform() ) ) ;
+    double cosValue ;
+    VectorMath::SinCosTwoPi(Uniform(), nextGaussian, cosValue) ;
+    nextGaussian *= r ;
+    hasGaussian = true ;
+    return r * cosValue ;
+}
+
+//---------------------------------------------------------------------------------------------
+
+void RandomStream::UniformPairs(double * u1, double * u2, int n)
+{
+    for (int k = 0; k < n; k++)
+    {
+        u1[k] = OpenUniform() ;
+        u2[k] = Uniform() ;
+    }
+}
+
+//---------------------------------------------------------------------------------------------
+
+void RandomGenerator::SetSeed(long tmpSeed)
+{
+    if (tmpSeed < 0)
+    {
+        tmpSeed = static_cast<long>(std::chrono::system_clock::now().time_since_epoch().count() & 0x7fffffff) ;
+    }
+    runSeed = static_cast<uint64_t>(tmpSeed) ;
+    cout<<"Random seed of the run is "<<runSeed<<endl ;
+}
+
+//---------------------------------------------------------------------------------------------
+
+RandomStream RandomGenerator::Stream(int id, long step, Random_Purpose purpose) const
+{
+    return RandomStream(runSeed, static_cast<uint32_t>(id), static_cast<uint64_t>(step), purpose) ;
+}
+
+//---------------------------------------------------------------------------------------------
+
+void RandomGenerator::BoxMuller(const double * u1, const double * u2, double * z1, double * z2, long n)
+{
+    #pragma omp parallel for simd
+    for (long k = 0; k < n; k++)
+    {
+        double r = VectorMath::Sqrt(-2.0 * VectorMath::Log(u1[k]) ) ;
+        double sinValue ;
+        double cosValue ;
+        VectorMath::SinCosTwoPi(u2[k], sinValue, cosValue) ;
+        z1[k] = r * cosValue ;
+        z2[k] = r * sinValue ;
+    }
+}
+
+//---------------------------------------------------------------------------------------------
+
+//Salmon et al., "Parallel random numbers: as easy as 1, 2, 3", SC 2011
+void RandomGenerator::Philox4x32(uint32_t * ctr, const uint32_t * tmpKey)
+{
+    uint32_t k0 = tmpKey[0] ;
+    uint32_t k1 = tmpKey[1] ;
+    for (int round = 0; round < 10; round++)
+    {
+        uint64_t p0 = static_cast<uint64_t>(0xD2511F53u) * ctr[0] ;
+        uint64_t p1 = static_cast<uint64_t>(0xCD9E8D57u) * ctr[2] ;
+        uint32_t c0 = static_cast<uint32_t>(p1 >> 32) ^ ctr[1] ^ k0 ;
+        uint32_t c1 = static_cast<uint32_t>(p1) ;
+        uint32_t c2 = static_cast<uint32_t>(p0 >> 32) ^ ctr[3] ^ k1 ;
+        uint32_t c3 = static_cast<uint32_t>(p0) ;
+        ctr[0] = c0 ;
+        ctr[1] = c1 ;
+        ctr[2] = c2 ;
+        ctr[3] = c3 ;
+        k0 += 0x9E3779B9u ;
+        k1 += 0xBB67AE85u ;
+    }
+}
@@ -0,0 +1,67 @@
+#ifndef RandomStreams_hpp
+#define RandomStreams_hpp
+
+#include <cstdint>
+#include <cmath>
+#include "VectorMath.hpp"
+
+using namespace std ;
+
+//What a stream is used for. Draws for different purposes of the same bacterium in the same step are independent
+enum Random_Purpose
+{
+    random_initialization = 0 ,     //positions and orientations of the bacteria
+    random_piliInitialization = 1 ,
+    random_pili = 2 ,               //attachment and detachment
+    random_piliRetraction = 3 ,
+    random_reversalTimer = 4 ,      //phase of the first run
+    random_thermal = 5 ,
+    random_turn = 6 ,               //side of the turn after a reversal
+    random_reversal = 7 ,           //wrap or reverse and the wrap direction
+    random_switch = 8 ,             //motility metabolism switch
+    random_protein = 9 ,
+    random_runDuration = 10 ,       //refills of the sample buffers, the step is the number of the refill
+    random_fungalGrowth = 11 ,
+    random_wrapDuration = 12 ,
+    random_turnAngle = 13 ,
+    numberRandomPurposes = 14
+};
+
+//Random numbers of one ( id, step, purpose). Block i of the stream is Philox4x32-10 of the counter
+//( i, id, step, purpose) under the run seed, so the numbers do not depend on the order streams are used in.
+class RandomStream
+{
+public:
+    RandomStream (uint64_t runSeed, uint32_t id, uint64_t step, Random_Purpose purpose) ;
+    uint32_t NextInt () ;
+    double Uniform () ;             //[0, 1)
+    double OpenUniform () ;         //(0, 1), safe for log
+    double Gaussian () ;            //mean 0, variance 1
+    //n values of OpenUniform for u1 and of Uniform for u2, in the order Gaussian would use them
+    void UniformPairs (double * u1, double * u2, int n) ;
+
+private:
+    uint32_t key[2] ;
+    uint32_t counter[4] ;
+    uint32_t block[4] ;
+    int used = 4 ;
+    bool hasGaussian = false ;
+    double nextGaussian = 0.0 ;
+};
+
+//The only source of random numbers of a run. Streams are made on demand and cost nothing to keep,
+//so every bacterium can draw in parallel and a run is repeated exactly by its seed.
+class RandomGenerator
+{
+public:
+    uint64_t runSeed = 12345 ;
+
+    void SetSeed (long tmpSeed) ;           //negative seeds are replaced by the clock
+    RandomStream Stream (int id, long step, Random_Purpose purpose) const ;
+    //Box-Muller on arrays of UniformPairs, vectorized and split between threads. z1 and z2 are independent normals
+    static void BoxMuller (const double * u1, const double * u2, double * z1, double * z2, long n) ;
+    //10 rounds on ctr in place
+    static void Philox4x32 (uint32_t * ctr, const uint32_t * tmpKey) ;
+};
+
+#endif /* RandomStreams_hpp */
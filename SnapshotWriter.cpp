@@ -0,0 +1,133 @@
+#include "SnapshotWriter.hpp"
+#include <chrono>
+#include <iostream>
+
+void BacteriaSnapshot::Resize(int nBacteria, int nNodes)
+{
+    nodeX.resize(static_cast<size_t>(nBacteria) * nNodes) ;
+    nodeY.resize(static_cast<size_t>(nBacteria) * nNodes) ;
+    protein.resize(static_cast<size_t>(nBacteria) * nNodes) ;
+    for (vector<double> * values : {&x, &y, &velocity, &friction, &orientation, &oldChem, &maxRunDuration, &receptorActivity,
+                                    &legand, &methylation, &changeRate, &legandEnergy, &methylEnergy, &switchProbability,
+                                    &timeToSource, &timeInSource})
+    {
+        values->resize(nBacteria) ;
+    }
+    numberReverse.resize(nBacteria) ;
+    mode.resize(nBacteria) ;
+    switchMode.resize(nBacteria) ;
+}
+
+//---------------------------------------------------------------------------------------------
+
+SnapshotWriter::SnapshotWriter ()
+{
+}
+
+//---------------------------------------------------------------------------------------------
+
+SnapshotWriter::~SnapshotWriter ()
+{
+    Stop() ;
+}
+
+//---------------------------------------------------------------------------------------------
+
+void SnapshotWriter::Start(int nBuffers, Backpressure_Mode tmpBackpressure, int nBacteria, int nNodes,
+                           function<void(const BacteriaSnapshot &)> tmpWrite)
+{
+    Stop() ;
+    nBuffers = max(nBuffers, 1) ;
+    backpressure = tmpBackpressure ;
+    write = tmpWrite ;
+    buffers.resize(nBuffers) ;
+    full.Resize(nBuffers) ;
+    available.Resize(nBuffers) ;
+    for (int k = 0; k < nBuffers; k++)
+    {
+        buffers[k].Resize(nBacteria, nNodes) ;
+        available.Push(k) ;
+    }
+    framesWritten = 0 ;
+    framesDropped = 0 ;
+    framesSubmitted = 0 ;
+    maxQueueDepth = 0 ;
+    sumQueueDepth = 0 ;
+    stopping = false ;
+    writer = thread(&SnapshotWriter::Run, this) ;
+}
+
+//---------------------------------------------------------------------------------------------
+
+BacteriaSnapshot * SnapshotWriter::Acquire()
+{
+    int k ;
+    while (available.Pop(k) == false)
+    {
+        if (backpressure == backpressure_drop)
+        {
+            framesDropped++ ;
+            return nullptr ;
+        }
+        this_thread::sleep_for(chrono::microseconds(200) ) ;
+    }
+    return &buffers[k] ;
+}
+
+//---------------------------------------------------------------------------------------------
+
+void SnapshotWriter::Submit(BacteriaSnapshot * snapshot)
+{
+    size_t depth = full.Size() ;
+    maxQueueDepth = max(maxQueueDepth, depth) ;
+    sumQueueDepth += depth ;
+    framesSubmitted++ ;
+    //There is always room, the queue holds every buffer
+    full.Push(static_cast<int>(snapshot - buffers.data() ) ) ;
+}
+
+//---------------------------------------------------------------------------------------------
+
+void SnapshotWriter::Run()
+{
+    int k ;
+    while (true)
+    {
+        if (full.Pop(k) )
+        {
+            write(buffers[k]) ;
+            framesWritten++ ;
+            available.Push(k) ;
+        }
+        else if (stopping.load(memory_order_acquire) )
+        {
+            //a frame submitted between the failed Pop and Stop is still in the queue
+            while (full.Pop(k) )
+            {
+                write(buffers[k]) ;
+                framesWritten++ ;
+                available.Push(k) ;
+            }
+            return ;
+        }
+        else
+        {
+            this_thread::sleep_for(chrono::microseconds(500) ) ;
+        }
+    }
+}
+
+//---------------------------------------------------------------------------------------------
+
+void SnapshotWriter::Stop()
+{
+    if (writer.joinable() == false)
+    {
+        return ;
+    }
+    stopping.store(true, memory_order_release) ;
+    writer.join() ;
+    cout<<"Snapshot writer: "<<framesWritten<<" frames written, "<<framesDropped<<" dropped, queue depth max "
+        <<maxQueueDepth<<" mean "<<(framesSubmitted > 0 ? static_cast<double>(sumQueueDepth) / framesSubmitted : 0.0)
+        <<" of "<<buffers.size()<<" buffers"<<endl ;
+}
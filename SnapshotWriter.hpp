@@ -0,0 +1,141 @@
+#ifndef SnapshotWriter_hpp
+#define SnapshotWriter_hpp
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <thread>
+#include <vector>
+
+using namespace std ;
+
+//Copy of the state written at an output frame. The simulation fills it, so the files can be written later by another thread
+struct BacteriaSnapshot
+{
+    int vtkIndex = 0 ;              //file index of the bacteria frame
+    int statsIndex = 0 ;            //file index of the stats frame
+    double time = 0.0 ;
+    long switchRecord = 0 ;         //number of the switch probability record
+    long outputFrame = 0 ;          //number of the frame, for the cadence of every output
+    bool hasNodes = true ;          //false for the metabolism-only snapshots of the relaxation phase
+
+    //every node of the duplicates, bacterium after bacterium
+    vector<double> nodeX ;
+    vector<double> nodeY ;
+    vector<double> protein ;
+
+    //one value per bacterium
+    vector<double> x ;              //center node
+    vector<double> y ;
+    vector<double> velocity ;
+    vector<double> friction ;
+    vector<double> orientation ;
+    vector<double> oldChem ;
+    vector<int32_t> numberReverse ;
+    vector<int32_t> mode ;          //1 forward, 2 wrap, 4 turn
+    vector<double> maxRunDuration ;
+    vector<double> receptorActivity ;
+    vector<double> legand ;
+    vector<double> methylation ;
+    vector<double> changeRate ;
+    vector<double> legandEnergy ;
+    vector<double> methylEnergy ;
+    vector<double> switchProbability ;
+    vector<int32_t> switchMode ;
+    vector<double> timeToSource ;
+    vector<double> timeInSource ;
+
+    void Resize (int nBacteria, int nNodes) ;
+};
+
+//Single producer, single consumer ring. Push and Pop never lock, each index is only written by one side
+template <class T>
+class SpscQueue
+{
+public:
+    void Resize (size_t capacity)
+    {
+        slots.resize(capacity + 1) ;
+        head = 0 ;
+        tail = 0 ;
+    }
+    bool Push (const T & value)
+    {
+        size_t tmpTail = tail.load(memory_order_relaxed) ;
+        size_t next = (tmpTail + 1) % slots.size() ;
+        if (next == head.load(memory_order_acquire) )
+        {
+            return false ;
+        }
+        slots[tmpTail] = value ;
+        tail.store(next, memory_order_release) ;
+        return true ;
+    }
+    bool Pop (T & value)
+    {
+        size_t tmpHead = head.load(memory_order_relaxed) ;
+        if (tmpHead == tail.load(memory_order_acquire) )
+        {
+            return false ;
+        }
+        value = slots[tmpHead] ;
+        head.store( (tmpHead + 1) % slots.size(), memory_order_release) ;
+        return true ;
+    }
+    size_t Size () const
+    {
+        size_t tmpHead = head.load(memory_order_acquire) ;
+        size_t tmpTail = tail.load(memory_order_acquire) ;
+        return (tmpTail + slots.size() - tmpHead) % slots.size() ;
+    }
+
+private:
+    vector<T> slots ;
+    atomic<size_t> head {0} ;
+    atomic<size_t> tail {0} ;
+};
+
+enum Backpressure_Mode
+{
+    backpressure_block = 0 ,        //the simulation waits for a free buffer
+    backpressure_drop = 1           //the frame is skipped
+};
+
+//Writer thread of the output frames. The snapshot buffers are allocated once. A free buffer is taken with Acquire,
+//filled by the simulation and handed over with Submit. The writer thread writes it and puts it back in the free queue.
+class SnapshotWriter
+{
+public:
+    //---------------------------- Parameters and sub-classes ------------------------------
+    SnapshotWriter () ;
+    ~SnapshotWriter () ;
+    Backpressure_Mode backpressure = backpressure_block ;
+    long framesWritten = 0 ;
+    long framesDropped = 0 ;
+    long framesSubmitted = 0 ;
+    size_t maxQueueDepth = 0 ;
+    size_t sumQueueDepth = 0 ;      //queue depth seen by every Submit, for the mean
+
+    //---------------------------- Functions --------------------------------------------
+    void Start (int nBuffers, Backpressure_Mode tmpBackpressure, int nBacteria, int nNodes,
+                function<void(const BacteriaSnapshot &)> tmpWrite) ;
+    bool IsRunning () const { return writer.joinable() ; }
+    //nullptr if every buffer is in use and frames are dropped
+    BacteriaSnapshot * Acquire () ;
+    void Submit (BacteriaSnapshot * snapshot) ;
+    //Frames waiting to be written
+    size_t QueueDepth () const { return full.Size() ; }
+    //Write the queued frames, stop the thread and print the queue report
+    void Stop () ;
+
+private:
+    void Run () ;
+    vector<BacteriaSnapshot> buffers ;
+    SpscQueue<int> full ;
+    SpscQueue<int> available ;
+    function<void(const BacteriaSnapshot &)> write ;
+    atomic<bool> stopping {false} ;
+    thread writer ;
+};
+
+#endif /* SnapshotWriter_hpp */
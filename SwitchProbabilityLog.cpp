@@ -0,0 +1,141 @@
+#include "SwitchProbabilityLog.hpp"
+#include <charconv>
+#include <cstring>
+#include <iostream>
+
+static const char switchLogMagic[8] = {'S','W','I','T','C','H','L','G'} ;
+static const uint32_t switchLogVersion = 1 ;
+
+//A text line is at most 2 integers and 9 shortest round-trip doubles ( 24 characters each) with separators
+static const size_t maxLineBytes = 512 ;
+
+SwitchProbabilityLog::SwitchProbabilityLog ()
+{
+}
+
+//---------------------------------------------------------------------------------------------
+
+SwitchProbabilityLog::~SwitchProbabilityLog ()
+{
+    Close() ;
+}
+
+//---------------------------------------------------------------------------------------------
+
+void SwitchProbabilityLog::Open(const string & fileName, SwitchLog_Mode tmpMode)
+{
+    Close() ;
+    mode = tmpMode ;
+    file = fopen(fileName.c_str(), "wb") ;
+    if (file == nullptr)
+    {
+        cout<<"Could not open switch probability log "<<fileName<<endl ;
+        return ;
+    }
+    buffer.resize(bufferBytes) ;
+    used = 0 ;
+    if (mode == switchLog_binary)
+    {
+        SwitchLogHeader header ;
+        memcpy(header.magic, switchLogMagic, sizeof(switchLogMagic) ) ;
+        header.version = switchLogVersion ;
+        header.recordBytes = sizeof(SwitchLogRecord) ;
+        fwrite(&header, sizeof(header), 1, file) ;
+    }
+    else
+    {
+        const char * names = "record\tbacterium\tmaxRunDurat\treceptAct\tlegand\tmethylation\tchangeRate\tLegandEnergy\t"
+                             "MethylEnergy\tswitchProb\tswitchMode\n" ;
+        fwrite(names, 1, strlen(names), file) ;
+    }
+}
+
+//---------------------------------------------------------------------------------------------
+
+void SwitchProbabilityLog::Append(double value, char separator)
+{
+    char * end = to_chars(&buffer[used], &buffer[used] + maxLineBytes / 2, value).ptr ;
+    *end = separator ;
+    used = end + 1 - buffer.data() ;
+}
+
+//---------------------------------------------------------------------------------------------
+
+void SwitchProbabilityLog::Append(long value, char separator)
+{
+    char * end = to_chars(&buffer[used], &buffer[used] + maxLineBytes / 2, value).ptr ;
+    *end = separator ;
+    used = end + 1 - buffer.data() ;
+}
+
+//---------------------------------------------------------------------------------------------
+
+void SwitchProbabilityLog::Drain()
+{
+    fwrite(buffer.data(), 1, used, file) ;
+    used = 0 ;
+}
+
+//---------------------------------------------------------------------------------------------
+
+void SwitchProbabilityLog::Write(const BacteriaSnapshot & snapshot)
+{
+    if (IsOpen() == false)
+    {
+        return ;
+    }
+    size_t nBacteria = snapshot.switchProbability.size() ;
+    for (size_t i = 0; i < nBacteria; i++)
+    {
+        if (mode == switchLog_binary)
+        {
+            if (used + sizeof(SwitchLogRecord) > buffer.size() )
+            {
+                Drain() ;
+            }
+            SwitchLogRecord record ;
+            record.record = snapshot.switchRecord ;
+            record.bacterium = static_cast<int32_t>(i) ;
+            record.switchMode = snapshot.switchMode[i] ;
+            record.maxRunDuration = snapshot.maxRunDuration[i] ;
+            record.receptorActivity = snapshot.receptorActivity[i] ;
+            record.legand = snapshot.legand[i] ;
+            record.methylation = snapshot.methylation[i] ;
+            record.changeRate = snapshot.changeRate[i] ;
+            record.legandEnergy = snapshot.legandEnergy[i] ;
+            record.methylEnergy = snapshot.methylEnergy[i] ;
+            record.switchProbability = snapshot.switchProbability[i] ;
+            memcpy(&buffer[used], &record, sizeof(record) ) ;
+            used += sizeof(record) ;
+            continue ;
+        }
+        if (used + maxLineBytes > buffer.size() )
+        {
+            Drain() ;
+        }
+        Append(snapshot.switchRecord, '\t') ;
+        Append(static_cast<long>(i), '\t') ;
+        Append(snapshot.maxRunDuration[i], '\t') ;
+        Append(snapshot.receptorActivity[i], '\t') ;
+        Append(snapshot.legand[i], '\t') ;
+        Append(snapshot.methylation[i], '\t') ;
+        Append(snapshot.changeRate[i], '\t') ;
+        Append(snapshot.legandEnergy[i], '\t') ;
+        Append(snapshot.methylEnergy[i], '\t') ;
+        Append(snapshot.switchProbability[i], '\t') ;
+        Append(static_cast<long>(snapshot.switchMode[i]), '\n') ;
+    }
+}
+
+//---------------------------------------------------------------------------------------------
+
+void SwitchProbabilityLog::Close()
+{
+    if (file == nullptr)
+    {
+        return ;
+    }
+    Drain() ;
+    fclose(file) ;
+    file = nullptr ;
+}
@@ -0,0 +1,67 @@
+#ifndef SwitchProbabilityLog_hpp
+#define SwitchProbabilityLog_hpp
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include "SnapshotWriter.hpp"
+
+using namespace std ;
+
+enum SwitchLog_Mode
+{
+    switchLog_perBacteria = 0 ,     //one text file per bacterium, WriteSwitchProbabilities_Bacteria<i>.txt
+    switchLog_text = 1 ,            //one tab separated file, a line per ( record, bacterium)
+    switchLog_binary = 2            //one file of SwitchLogRecord after a SwitchLogHeader
+};
+
+struct SwitchLogHeader
+{
+    char magic[8] ;                 //"SWITCHLG"
+    uint32_t version ;
+    uint32_t recordBytes ;
+};
+
+struct SwitchLogRecord
+{
+    int64_t record ;                //one per call, every step of the relaxation phase and every frame after it
+    int32_t bacterium ;
+    int32_t switchMode ;
+    double maxRunDuration ;
+    double receptorActivity ;
+    double legand ;
+    double methylation ;
+    double changeRate ;
+    double legandEnergy ;
+    double methylEnergy ;
+    double switchProbability ;
+};
+
+//Switch probabilities of every bacterium in a single stream. Records are formatted with to_chars into a large buffer
+//that is written when it is full, so a call costs no file open and no iostream formatting
+class SwitchProbabilityLog
+{
+public:
+    //---------------------------- Parameters and sub-classes ------------------------------
+    SwitchProbabilityLog () ;
+    ~SwitchProbabilityLog () ;
+    static const size_t bufferBytes = 1 << 20 ;
+
+    //---------------------------- Functions --------------------------------------------
+    void Open (const string & fileName, SwitchLog_Mode tmpMode) ;
+    bool IsOpen () const { return file != nullptr ; }
+    void Write (const BacteriaSnapshot & snapshot) ;
+    void Close () ;
+
+private:
+    void Append (double value, char separator) ;
+    void Append (long value, char separator) ;
+    void Drain () ;
+    SwitchLog_Mode mode = switchLog_text ;
+    FILE * file = nullptr ;
+    vector<char> buffer ;
+    size_t used = 0 ;
+};
+
+#endif /* SwitchProbabilityLog_hpp */
@@ -7,7 +7,7 @@
 //
 
 #include "TissueBacteria.hpp"
-# include "log_normal_truncated_ab.hpp"
+#include <sstream>
 
 using constants::pi;
 
@@ -38,6 +38,64 @@ void TissueBacteria::UpdateTissue_FromConfigFile()
     folderName = globalConfigVars.getConfigValue("AnimationFolder").toString() ;
     statsFolder = globalConfigVars.getConfigValue("StatFolderName").toString() ;
     animationName = globalConfigVars.getConfigValue("AnimationName").toString() ;
+    vtkFormat = globalConfigVars.getConfigValue("Output_VTKFormat").toInt() ;
+    vtkCompress = static_cast<bool>(globalConfigVars.getConfigValue("Output_VTKCompress").toInt() ) ;
+    bacteriaPvd.fileName = folderName + animationName + ".pvd" ;
+    frameStoreOutput = static_cast<bool>(globalConfigVars.getConfigValue("Output_FrameStore").toInt() ) ;
+    frameStoreChunk = globalConfigVars.getConfigValue("Output_FrameStoreChunk").toInt() ;
+    textStats = static_cast<bool>(globalConfigVars.getConfigValue("Output_TextStats").toInt() ) ;
+    asyncOutput = static_cast<bool>(globalConfigVars.getConfigValue("Output_Async").toInt() ) ;
+    outputBuffers = globalConfigVars.getConfigValue("Output_AsyncBuffers").toInt() ;
+    outputBackpressure = static_cast<Backpressure_Mode>(globalConfigVars.getConfigValue("Output_AsyncBackpressure").toInt() ) ;
+    switchLogMode = static_cast<SwitchLog_Mode>(globalConfigVars.getConfigValue("Output_SwitchLog").toInt() ) ;
+    trajectoryCodec = static_cast<bool>(globalConfigVars.getConfigValue("Output_TrajectoryCodec").toInt() ) ;
+    trajectoryQuantum = globalConfigVars.getConfigValue("Output_TrajectoryQuantum").toDouble() ;
+    trajectoryKeyframes = globalConfigVars.getConfigValue("Output_TrajectoryKeyframes").toInt() ;
+    vtkEvery = max(globalConfigVars.getConfigValue("Output_VTKEvery").toInt(), 1) ;
+    statsEvery = max(globalConfigVars.getConfigValue("Output_StatsEvery").toInt(), 1) ;
+    frameStoreEvery = max(globalConfigVars.getConfigValue("Output_FrameStoreEvery").toInt(), 1) ;
+    trajectoryEvery = max(globalConfigVars.getConfigValue("Output_TrajectoryEvery").toInt(), 1) ;
+    switchEvery = max(globalConfigVars.getConfigValue("Output_SwitchEvery").toInt(), 1) ;
+    outputRegionRadius = globalConfigVars.getConfigValue("Output_ROIRadius").toDouble() ;
+    outputRegionX = globalConfigVars.getConfigValue("Output_ROICenterX").toDouble() ;
+    outputRegionY = globalConfigVars.getConfigValue("Output_ROICenterY").toDouble() ;
+    //A negative center is the center of the fungal network
+    if (outputRegionX < 0.0)
+    {
+        outputRegionX = globalConfigVars.getConfigValue("hyphae_InitPosX").toDouble() ;
+    }
+    if (outputRegionY < 0.0)
+    {
+        outputRegionY = globalConfigVars.getConfigValue("hyphae_InitPosY").toDouble() ;
+    }
+    trackedEvery = max(globalConfigVars.getConfigValue("Output_TrackedEvery").toInt(), 1) ;
+    motilityLogOutput = static_cast<bool>(globalConfigVars.getConfigValue("Output_MotilityLog").toInt() ) ;
+    motilityLogRing = globalConfigVars.getConfigValue("Output_MotilityLogRing").toInt() ;
+    analyticsOutput = static_cast<bool>(globalConfigVars.getConfigValue("Output_Analytics").toInt() ) ;
+    analyticsEvery = max(globalConfigVars.getConfigValue("Output_AnalyticsEvery").toInt(), 1) ;
+    analyticsLevels = max(globalConfigVars.getConfigValue("Output_AnalyticsLevels").toInt(), 1) ;
+    analyticsPoints = max(globalConfigVars.getConfigValue("Output_AnalyticsPoints").toInt(), 2) ;
+    coarseFieldOutput = static_cast<bool>(globalConfigVars.getConfigValue("Output_CoarseField").toInt() ) ;
+    coarseFieldNx = max(globalConfigVars.getConfigValue("Output_CoarseFieldNX").toInt(), 1) ;
+    coarseFieldNy = max(globalConfigVars.getConfigValue("Output_CoarseFieldNY").toInt(), 1) ;
+    coarseFieldEvery = max(globalConfigVars.getConfigValue("Output_CoarseFieldEvery").toInt(), 1) ;
+    {
+        //ids separated by commas or spaces, anything else ( "none") is skipped
+        string tmpIds = globalConfigVars.getConfigValue("Output_TrackedIds").toString() ;
+        replace(tmpIds.begin(), tmpIds.end(), ',', ' ') ;
+        istringstream idStream (tmpIds) ;
+        string token ;
+        trackedIds.clear() ;
+        while (idStream >> token)
+        {
+            char * end ;
+            long id = strtol(token.c_str(), &end, 10) ;
+            if (*end == '\0' && id >= 0 && id < nbacteria)
+            {
+                trackedIds.push_back(static_cast<int>(id) ) ;
+            }
+        }
+    }
     
     //Timimg control parametes
     initialTime = globalConfigVars.getConfigValue("InitTimeStage").toDouble() ;
@@ -92,6 +150,21 @@ void TissueBacteria::UpdateTissue_FromConfigFile()
     inLiquid = globalConfigVars.getConfigValue("Bacteria_inLiquid").toInt() ;
     PBC = globalConfigVars.getConfigValue("Bacteria_PBC").toInt() ;
     chemotacticMechanism = static_cast<ChemotacticMechanism>( globalConfigVars.getConfigValue("Bacteria_chemotacticModel").toInt() ) ;
+    thermalNoise = static_cast<bool>(globalConfigVars.getConfigValue("Bacteria_thermalNoise").toInt() ) ;
+    thermalEnergy = globalConfigVars.getConfigValue("Bacteria_thermalEnergy").toDouble() ;
+    rng.SetSeed(globalConfigVars.getConfigValue("RandomSeed").toInt() ) ;
+    runDuration_mu = globalConfigVars.getConfigValue("Bacteria_runDuration_mu").toDouble() ;
+    runDuration_sigma = globalConfigVars.getConfigValue("Bacteria_runDuration_sigma").toDouble() ;
+    runDuration_min = globalConfigVars.getConfigValue("Bacteria_runDuration_min").toDouble() ;
+    runDuration_max = globalConfigVars.getConfigValue("Bacteria_runDuration_max").toDouble() ;
+    wrapDuration_mu = globalConfigVars.getConfigValue("Bacteria_wrapDuration_mu").toDouble() ;
+    wrapDuration_sigma = globalConfigVars.getConfigValue("Bacteria_wrapDuration_sigma").toDouble() ;
+    wrapDuration_min = globalConfigVars.getConfigValue("Bacteria_wrapDuration_min").toDouble() ;
+    wrapDuration_max = globalConfigVars.getConfigValue("Bacteria_wrapDuration_max").toDouble() ;
+    turnAngle_rate = globalConfigVars.getConfigValue("Bacteria_turnAngle_rate").toDouble() ;
+    turnAngle_norm = globalConfigVars.getConfigValue("Bacteria_turnAngle_norm").toDouble() ;
+    samplerTableSize = max(globalConfigVars.getConfigValue("Bacteria_samplerTableSize").toInt(), 1) ;
+    metabolismUpdateSteps = max(globalConfigVars.getConfigValue("Bacteria_metabolismUpdateSteps").toInt(), 1) ;
     initialCondition =static_cast<InitialCondition>( globalConfigVars.getConfigValue("Bacteria_InitialCondition").toInt() ) ;
     run_calibrated = static_cast<bool>( globalConfigVars.getConfigValue("Run_Calibrated").toInt() ) ;
     normal_turnAngle_SDV = globalConfigVars.getConfigValue("Bacteria_TurnSDV").toDouble() ;
@@ -103,6 +176,7 @@ void TissueBacteria::UpdateTissue_FromConfigFile()
         bacteria[i].UpdateBacteria_FromConfigFile() ;
     }
     tGrids.UpdateTGrid_FromConfigFile() ;
+    speciesGrids.UpdateSpecies_FromConfigFile(tGrids) ;
     
 }
 //-----------------------------------------------------------------------------------------------------
@@ -147,8 +221,9 @@ void TissueBacteria::Initialization ()
         }
         else   { bacteria[i].nodes[j].x = lx * coloum + lx /2 ; }
        bacteria[i].nodes[j].y=  ly * row /2 ;
-        a= gasdev(&idum) ;
-        b=gasdev(&idum) ;
+        RandomStream tmpRandom = rng.Stream(i, eventStep, random_initialization) ;
+        a = tmpRandom.Gaussian() ;
+        b = tmpRandom.Gaussian() ;
         a= a/ sqrt(a*a+b*b) ;
         b = b/ sqrt(a*a+b*b) ;
         for (int n=1; n<=(nnode-1)/2; n++)
@@ -192,8 +267,9 @@ void TissueBacteria::Initialization2 ()
         }
         else   { bacteria[i].nodes[j].x = domainx/2.0 + lx * coloum + lx /2.0 ; }
        bacteria[i].nodes[j].y =  domainy/2.0 + ly * row /2.0 ;
-        a= gasdev(&idum) ;
-        b=gasdev(&idum) ;
+        RandomStream tmpRandom = rng.Stream(i, eventStep, random_initialization) ;
+        a = tmpRandom.Gaussian() ;
+        b = tmpRandom.Gaussian() ;
         a= a/ sqrt(a*a+b*b) ;
         b = b/ sqrt(a*a+b*b) ;
         for (int n=1; n<=(nnode-1)/2; n++)
@@ -225,8 +301,9 @@ void TissueBacteria::Initialization2 ()
     {
         bacteria[i].nodes[j].x = domainx/2.0 ;
         bacteria[i].nodes[j].y = domainy*0.2 + lx*i;
-        a= gasdev(&idum) ;
-        b=gasdev(&idum) ;
+        RandomStream tmpRandom = rng.Stream(i, eventStep, random_initialization) ;
+        a = tmpRandom.Gaussian() ;
+        b = tmpRandom.Gaussian() ;
         double norm = sqrt(a*a+b*b) ;
         a = a/norm ;
         b = b/norm ;
@@ -290,8 +367,9 @@ void TissueBacteria::CircularInitialization ()
 */
         
         //Random
-        a = gasdev(&idum) ;
-        b =gasdev(&idum) ;
+        RandomStream tmpRandom = rng.Stream(i, eventStep, random_initialization) ;
+        a = tmpRandom.Gaussian() ;
+        b = tmpRandom.Gaussian() ;
         double norm = sqrt(a*a+b*b) ;
         a = a/norm ;
         b = b/norm ;
@@ -328,8 +406,9 @@ void TissueBacteria::SwarmingInitialization ()
        bacteria[i].nodes[j].x = minX + a ;
        bacteria[i].nodes[j].y = minY + b ;
         
-        a= gasdev(&idum) ;
-        b=gasdev(&idum) ;
+        RandomStream tmpRandom = rng.Stream(i, eventStep, random_initialization) ;
+        a = tmpRandom.Gaussian() ;
+        b = tmpRandom.Gaussian() ;
         a= a/ sqrt(a*a+b*b) ;
         b = b/ sqrt(a*a+b*b) ;
         for (int n=1; n<=(nnode-1)/2; n++)
@@ -354,11 +433,12 @@ void TissueBacteria::CenterInitialization()
     double b ;
     for (int i=0 , j=(nnode-1)/2 ; i<nbacteria; i++)
     {
-        bacteria[i].nodes[j].x = cntrX + raduis * (2.0 * rand() / (RAND_MAX + 1.0) - 1.0 )  ;
-        bacteria[i].nodes[j].y = cntrY + raduis * (2.0 * rand() / (RAND_MAX + 1.0) - 1.0 ) ;
+        RandomStream tmpRandom = rng.Stream(i, eventStep, random_initialization) ;
+        bacteria[i].nodes[j].x = cntrX + raduis * (2.0 * tmpRandom.Uniform() - 1.0 )  ;
+        bacteria[i].nodes[j].y = cntrY + raduis * (2.0 * tmpRandom.Uniform() - 1.0 ) ;
         
-        a= gasdev(&idum) ;
-        b=gasdev(&idum) ;
+        a = tmpRandom.Gaussian() ;
+        b = tmpRandom.Gaussian() ;
         a= a/ sqrt(a*a+b*b) ;
         b = b/ sqrt(a*a+b*b) ;
         for (int n=1; n<=(nnode-1)/2; n++)
@@ -378,27 +458,31 @@ void TissueBacteria::AlongNetworkInitialization()
 
     double tmpX ;
     double tmpY ;
-    int m_x ;
-    int n_y ;
     double a ;
     double b ;
+    vector<int> found ;
+    //The network has to be traced first ( Find_FungalNetworkTrace2)
+    if (hyphaeIndex.empty() )
+    {
+        throw SceException("Bacteria can not start along the fungal network before it is loaded", ConfigValueException) ;
+    }
     
     for (int i=0 , j=(nnode-1)/2 ; i<nbacteria; i++)
     {
+        RandomStream tmpRandom = rng.Stream(i, eventStep, random_initialization) ;
+        //in the liquid layer around the hyphae, from the segments near the point instead of the liquid grids
         do {
-            tmpX = (rand() / (RAND_MAX + 1.0) ) * domainx ;
-            tmpY = (rand() / (RAND_MAX + 1.0) ) * domainy ;
-            m_x = (static_cast<int> (round ( fmod (tmpX + domainx , domainx) / dx ) ) ) % nx ;
-            n_y = (static_cast<int> (round ( fmod (tmpY + domainy , domainy) / dy ) ) ) % ny ;
-        } while (slime[m_x][n_y] != liqLayer  );
+            tmpX = tmpRandom.Uniform() * domainx ;
+            tmpY = tmpRandom.Uniform() * domainy ;
+        } while (HyphaeMark_AtPoint(tmpX, tmpY, found) != hyphaeLayerMark );
         
         bacteria[i].nodes[j].x = tmpX ;
         bacteria[i].nodes[j].y = tmpY ;
         
         //cout<< tmpX<<'\t'<<tmpY<< '\t'<< m_x<< '\t'<< n_y<<endl ;
         
-        a= gasdev(&idum) ;
-        b=gasdev(&idum) ;
+        a = tmpRandom.Gaussian() ;
+        b = tmpRandom.Gaussian() ;
         a= a/ sqrt(a*a+b*b) ;
         b = b/ sqrt(a*a+b*b) ;
         for (int n=1; n<=(nnode-1)/2; n++)
@@ -418,16 +502,17 @@ void TissueBacteria::Initialize_Pili ()
 {
     for (int i=0 ; i<nbacteria ; i++)
     {
+        RandomStream tmpRandom = rng.Stream(i, eventStep, random_piliInitialization) ;
         for ( int j=0 ; j<nPili ; j++)
         {
-           bacteria[i].pili[j].lFree = rand() / (RAND_MAX + 1.0) * bacteria[i].pili[j].piliMaxLength ;
+           bacteria[i].pili[j].lFree = tmpRandom.Uniform() * bacteria[i].pili[j].piliMaxLength ;
            bacteria[i].pili[j].attachment = false ;
            bacteria[i].pili[j].retraction = false ;
            bacteria[i].pili[j].pili_Fx = 0.0 ;
            bacteria[i].pili[j].pili_Fy = 0.0 ;
            bacteria[i].pili[j].piliForce = 0.0 ;
             
-            if(rand() / (RAND_MAX + 1.0) < 0.5 )
+            if(tmpRandom.Uniform() < 0.5 )
             {
                bacteria[i].pili[j].retraction = true ;
             }
@@ -435,7 +520,7 @@ void TissueBacteria::Initialize_Pili ()
             {
                bacteria[i].pili[j].retraction = false ;
             }
-            if (rand() / (RAND_MAX + 1.0) < 0.5 )
+            if (tmpRandom.Uniform() < 0.5 )
             {
                bacteria[i].pili[j].attachment = true ;
                bacteria[i].pili[j].retraction = true ;
@@ -543,7 +628,7 @@ void TissueBacteria::PositionUpdating (double t)
           cout<<"positionUpdating, index out of range "<<tmpXIndex<<'\t'<<tmpYIndex<<endl ;
        }
        // oldChem is now updated in Cal_Chemical2
-       //tissueBacteria.bacteria[i].oldChem = tissueBacteria.chemoProfile.at(tmpYIndex).at(tmpXIndex) ;
+       //tissueBacteria.bacteria[i].oldChem = tissueBacteria.chemoProfile.at(tmpYIndex, tmpXIndex) ;
         for(int j=0 ; j<nnode; j++)
         {
             localFrictionCoeff = Update_LocalFriction(bacteria[i].nodes[j].x , bacteria[i].nodes[j].y) ;
@@ -590,12 +675,19 @@ void TissueBacteria::PositionUpdating (double t)
 //-----------------------------------------------------------------------------------------------------
 void TissueBacteria::Initialize_ReversalTimes ()
 {
+    eventStep = -1 ;
+    motilityEvents.Initialize(nbacteria) ;
+    turnEvents.Initialize(nbacteria) ;
     for( int i=0 ; i<nbacteria ; i++)
     {
+       RandomStream tmpRandom = rng.Stream(i, eventStep, random_reversalTimer) ;
        bacteria[i].reversalPeriod =  bacteria[i].maxRunDuration ;
-       bacteria[i].internalReversalTimer = (rand() / (RAND_MAX + 1.0)) * bacteria[i].maxRunDuration ;
+       bacteria[i].internalReversalTimer = tmpRandom.Uniform() * bacteria[i].maxRunDuration ;
        bacteria[i].internalReversalTimer -= fmod(bacteria[i].internalReversalTimer , dt ) ;
-        if (rand() / (RAND_MAX + 1.0) < 0.5)
+       //the first run started that many steps before the first step
+       bacteria[i].runStartStep = - lround(bacteria[i].internalReversalTimer / dt) ;
+       Schedule_RunEnd(i) ;
+        if (tmpRandom.Uniform() < 0.5)
         {
             //bacteria[i].directionOfMotion = false ;
            bacteria[i].directionOfMotion = true ;
@@ -614,23 +706,21 @@ void TissueBacteria::Initialize_ReversalTimes ()
 }
 
 //-----------------------------------------------------------------------------------------------------
-vector<vector<double> > TissueBacteria::TB_Cal_ChemoDiffusion2D(double xMin, double xMax, double yMin, double yMax,int nGridX , int nGridY,vector<vector<double> > sources, vector<double> pSource, Chemo_Profile_Type profileType)
+//The solver writes into tGrids and the bacteria sample the same storage through the returned view
+ChemoField TissueBacteria::TB_Cal_ChemoDiffusion2D(double xMin, double xMax, double yMin, double yMax,int nGridX , int nGridY,const vector<vector<double> > & sources, const vector<double> & pSource, Chemo_Profile_Type profileType)
 {
-    tGrids = Diffusion2D(xMin, xMax, yMin, yMax,nGridX , nGridY ,sources, pSource, tGrids, profileType) ;
-    vector<vector<double> > tmpGrid ;
-    
-    for (unsigned int i=0; i< tGrids.grids.size() ; i++)
+    if (profileType == production_profile && speciesGrids.nSpecies > 1)
     {
-        vector<double> tmp ;
-        for (unsigned int j=0; j< tGrids.grids.at(i).size(); j++)
-        {
-            tmp.push_back(tGrids.grids.at(i).at(j).value ) ;
-        }
-        tmpGrid.push_back(tmp) ;
-        tmp.clear() ;
-        
+        Diffusion2D_Species(xMin, xMax, yMin, yMax,nGridX , nGridY ,sources, pSource, tGrids, speciesGrids) ;
+        return speciesGrids.Profile(0) ;
     }
-    return tmpGrid ;
+    if (profileType == production_profile && tGrids.amrRefinement)
+    {
+        Diffusion2D_AMR(xMin, xMax, yMin, yMax,nGridX , nGridY ,sources, pSource, tGrids, amrGrids) ;
+        return amrGrids.Profile() ;
+    }
+    Diffusion2D(xMin, xMax, yMin, yMax,nGridX , nGridY ,sources, pSource, tGrids, profileType) ;
+    return tGrids.Profile() ;
     
 }
 //-----------------------------------------------------------------------------------------------------
@@ -893,12 +983,13 @@ void TissueBacteria:: PiliForce ()
     {
         
         orientationBacteria = AngleOfVector(bacteria[i].nodes[1].x , bacteria[i].nodes[1].y , bacteria[i].nodes[0].x, bacteria[i].nodes[0].y);        //degree
+        RandomStream tmpRandom = rng.Stream(i, eventStep, random_pili) ;
         for ( int j=0 ; j<nPili ; j++)
         {
             if( bacteria[i].pili[j].attachment== false)     //if the pili is detached
             {
                 //lambda substrate attachment
-                if (rand() / (RAND_MAX + 1.0) < bacteria[i].pili[j].subAttachmentRate* dt)
+                if (tmpRandom.Uniform() < bacteria[i].pili[j].subAttachmentRate* dt)
                 {
                     bacteria[i].pili[j].attachment = true ;
                     bacteria[i].pili[j].retraction = true ;
@@ -922,7 +1013,7 @@ void TissueBacteria:: PiliForce ()
             else                    //if the pili is attached
             {
                 //lambda detachment
-                if ( rand() / (RAND_MAX + 1.0) < bacteria[i].pili[j].subDetachmentRate* dt )
+                if ( tmpRandom.Uniform() < bacteria[i].pili[j].subDetachmentRate* dt )
                 {
                     bacteria[i].pili[j].attachment = false ;
                     bacteria[i].pili[j].pili_Fx = 0.0 ;
@@ -960,6 +1051,7 @@ void TissueBacteria:: PiliForce ()
     averageLengthFree = 0 ;
     for (int i=0 ; i<nbacteria ; i++)
     {
+        RandomStream tmpRandom = rng.Stream(i, eventStep, random_piliRetraction) ;
         for ( int j=0 ; j<nPili ; j++)
         {
             if(bacteria[i].pili[j].attachment)
@@ -967,7 +1059,7 @@ void TissueBacteria:: PiliForce ()
                 bacteria[i].pili[j].retraction = true ;
             }
             //if the bacteria is not attached, switch state between Protrusion and Retraction
-            else if (rand() / (RAND_MAX + 1.0) < bacteria[i].pili[j].retractionRate * dt)
+            else if (tmpRandom.Uniform() < bacteria[i].pili[j].retractionRate * dt)
             {
                 bacteria[i].pili[j].retraction = ! bacteria[i].pili[j].retraction ;
             }
@@ -1003,18 +1095,30 @@ void TissueBacteria:: PiliForce ()
     }
 }
 //-----------------------------------------------------------------------------------------------------
+//Uniforms from the stream of every bacterium, then one vectorized Box-Muller pass for all nodes.
+//Same numbers as drawing tmpRandom.Gaussian() for xdev and then ydev of every node
 void TissueBacteria:: TermalFluctiation_Forces()
 {
-    double sig ;
-    double vis ;
+    long nNodes = static_cast<long>(nbacteria) * nnode ;
+    noiseU1.resize(nNodes) ;
+    noiseU2.resize(nNodes) ;
+    noiseX.resize(nNodes) ;
+    noiseY.resize(nNodes) ;
+    #pragma omp parallel for
+    for(int i=0; i<nbacteria ; i++)
+    {
+        RandomStream tmpRandom = rng.Stream(i, eventStep, random_thermal) ;
+        tmpRandom.UniformPairs(&noiseU1[i * nnode], &noiseU2[i * nnode], nnode) ;
+    }
+    RandomGenerator::BoxMuller(noiseU1.data(), noiseU2.data(), noiseX.data(), noiseY.data(), nNodes) ;
+    #pragma omp parallel for
     for(int i=0; i<nbacteria ; i++)
     {
         for(int j=0 ; j<nnode; j++)
         {
-            vis = Update_LocalFriction(bacteria[i].nodes[j].x, bacteria[i].nodes[j].y) ;
-            sig = sqrt(2.0*dt/vis) ;
-            bacteria[i].nodes[j].xdev =gasdev(&idum)*sig;
-            bacteria[i].nodes[j].ydev =gasdev(&idum)*sig;
+            double sig = sqrt(2.0*thermalEnergy*dt/Update_LocalFriction(bacteria[i].nodes[j].x, bacteria[i].nodes[j].y) ) ;
+            bacteria[i].nodes[j].xdev = noiseX[i * nnode + j] * sig ;
+            bacteria[i].nodes[j].ydev = noiseY[i * nnode + j] * sig ;
         }
     }
 }
@@ -1068,26 +1172,27 @@ void TissueBacteria::Update_ViscousDampingCoeff()
     {
         for (int n=0 ; n < ny ; n++)
         {
-            if (inLiquid == true)
-            {
-                viscousDamp[m][n] = eta_background * (1.0 / liqLayer ) ;
-                if ( (m*dx < agarThicknessX || m*dx > domainx - agarThicknessX /* || n*dy< agarThicknessY || n*dy > domainy - agarThicknessY */ ) && PBC == false )
-                {
-                    viscousDamp[m][n] = eta_Barrier ;
-                }
-            }
-            else
-            {
-                viscousDamp[m][n] = eta_background* (1.0 / slime[m][n])  ;
-                if ( (m*dx < agarThicknessX || m*dx > domainx - agarThicknessX /* || n*dy< agarThicknessY || n*dy > domainy - agarThicknessY */ ) && PBC == false )
-                {
-                    viscousDamp[m][n] = eta_Barrier ;
-                }
-            }
+            Update_ViscousDampingCoeff(m, n) ;
         }
     }
 }
 
+void TissueBacteria::Update_ViscousDampingCoeff(int m, int n)
+{
+    if (inLiquid == true)
+    {
+        viscousDamp[m][n] = eta_background * (1.0 / liqLayer ) ;
+    }
+    else
+    {
+        viscousDamp[m][n] = eta_background* (1.0 / slime[m][n])  ;
+    }
+    if ( (m*dx < agarThicknessX || m*dx > domainx - agarThicknessX /* || n*dy< agarThicknessY || n*dy > domainy - agarThicknessY */ ) && PBC == false )
+    {
+        viscousDamp[m][n] = eta_Barrier ;
+    }
+}
+
 //-----------------------------------------------------------------------------------------------------
 
 void TissueBacteria:: Cal_MotorForce()
@@ -1387,36 +1492,36 @@ double TissueBacteria:: Bacterial_HighwayFollowing (int i, double R)        // i
 //-----------------------------------------------------------------------------------------------------
 void TissueBacteria:: Reverse_IndividualBacteriaa (int i)
 {
-    //WriteReversalDataByBacteria(i);
    // bacteria[i].directionOfMotion = ! bacteria[i].directionOfMotion ;
     bacteria[i].turnStatus = true ;
     bacteria[i].turnTimer = 0.0 ;
+    bacteria[i].turnStartStep = eventStep ;
+    //the turn lasts while the timer, one dt after this step, has not passed turnPeriod
+    turnEvents.Schedule(i, turn_end_event, eventStep + max(StepsToPeriod(turnPeriod, true) - 1, 0L) ) ;
    
   //  bacteria[i].turnAngle =(2.0*(rand() / (RAND_MAX + 1.0))-1.0 ) *  bacteria[i].maxTurnAngle ;    //uniform distribution
     if (bacteria[i].attachedToFungi == false || inLiquid == true)
     {
-        
-        double random_number = unif_distribution(reversal_rng);
-        bacteria[i].turnAngle = (std::log((random_number-1.0017) / (-1.0017)))/ (-18.11);
+        RandomStream tmpRandom = rng.Stream(i, eventStep, random_turn) ;
+        //inverse of the CDF 1.0017 * (1 - exp(-18.11 * angle))
+        bacteria[i].turnAngle = turnAngleSamples.Next(i, rng) ;
         
         /*
         //Reselects to Limit distribution
         double random_number;
         do {
-            random_number = unif_distribution(reversal_rng);
+            random_number = tmpRandom.Uniform() ;
             bacteria[i].turnAngle = (std::log((random_number-1.0017) / (-1.0017)))/ (-18.11);
         } while (bacteria[i].turnAngle > bacteria[i].maxTurnAngle);
         */
         
         // Calculate a Random value which is either +1 or -1
-        int Random_Multiplier = unif_int_distribution(multiplier_rng);
+        int Random_Multiplier = tmpRandom.Uniform() < 0.5 ? 0 : 1 ;
         int Random_Multiplier_Value = Random_Multiplier == 0 ? -1 : 1;
         //bacteria[i].turnAngle =(2.0*(rand() / (RAND_MAX + 1.0))-1.0 ) *  bacteria[i].maxTurnAngle ;    //Reversals with a uniformly chosen angle in a small range
         //bacteria[i].turnAngle = 0; //180 degree Reversals
         
-        //WriteReversalForce(i);
         bacteria[i].turnAngle = bacteria[i].turnAngle * Random_Multiplier_Value;
-        //WriteReversalForce2(i);
     }
     else
     {
@@ -1447,13 +1552,20 @@ void TissueBacteria:: Reverse_IndividualBacteriaa (int i)
         bacteria[i].ljnodes[j].y = (bacteria[i].nodes[j].y + bacteria[i].nodes[j+1].y)/2 ;
     }
     Cal_BacteriaOrientation (i) ;
-    //WriteReversalDataByBacteria(i);
+    Log_MotilityEvent(i, motilityLog_reversal, bacteria[i].turnAngle, bacteria[i].maxRunDuration) ;
 }
 //-----------------------------------------------------------------------------------------------------
+//Only the bacteria with an event due at this step are visited. The events are handled in the order of the bacteria
 void TissueBacteria:: Check_Perform_AllReversing_andWrapping()
 {
-    for (int i=0; i<nbacteria; i++)
+    eventStep++ ;
+    motilityEvents.PopDue(eventStep, dueEvents) ;
+    for (uint k=0; k<dueEvents.size(); k++)
     {
+        int i = dueEvents[k].bacterium ;
+        int eventType = dueEvents[k].type ;
+        //a bacterium can have more than one event in a step
+        RandomStream tmpRandom = rng.Stream(i * numberEventTypes + eventType, eventStep, random_reversal) ;
         if (chemotacticMechanism == observational)
         {
             /*
@@ -1467,31 +1579,35 @@ void TissueBacteria:: Check_Perform_AllReversing_andWrapping()
                 bacteria[i].timeInSource += dt ;
             }
             */
-            if (bacteria[i].internalReversalTimer >= bacteria[i].reversalPeriod && bacteria[i].wrapMode == false )
+            if (eventType == run_end_event && bacteria[i].wrapMode == false )
             {
                 bacteria[i].internalReversalTimer  = 0.0 ;
-                if ( rand() / (RAND_MAX + 1.0) < bacteria[i].wrapProbability )
+                bacteria[i].runStartStep = eventStep ;
+                if ( tmpRandom.Uniform() < bacteria[i].wrapProbability )
                 {
                     bacteria[i].turnStatus = false ;
                     bacteria[i].turnTimer = 0.0 ;
+                    turnEvents.Cancel(i, turn_end_event) ;
                     
                     bacteria[i].wrapMode = true ;
-                    bacteria[i].maxRunDuration = log_normal_truncated_ab_sample ( -.3662, .9178, 0, 4, seed );
+                    bacteria[i].wrapStartStep = eventStep ;
+                    bacteria[i].maxRunDuration = wrapDurationSamples.Next(i, rng) ;
                     //bacteria[i].maxRunDuration = .5; //Used for Wrap Calibration
                     bacteria[i].wrapPeriod = bacteria[i].maxRunDuration;
+                    Schedule_WrapEnd(i) ;
                     
-                    //bacteria[i].maxRunDuration = bacteria[i].LogNormalMaxRunDuration(wrapDuration_distribution,wrapDuration_seed, lognormal_wrap_a, run_calibrated, 1.0/bacteria[i].wrapRate ) ;
+                    //bacteria[i].maxRunDuration = bacteria[i].LogNormalMaxRunDuration(wrapDuration_distribution,tmpRandom, lognormal_wrap_a, run_calibrated, 1.0/bacteria[i].wrapRate ) ;
                   //  bacteria[i].wrapAngle = (2.0*(rand() / (RAND_MAX + 1.0))-1.0 ) * bacteria[i].maxWrapAngle ;
                   //  bacteria[i].wrapAngle = (2.0*(rand() / (RAND_MAX + 1.0))-1.0 ) * bacteria[i].maxTurnAngle ; // Used for Wrap Angle Calibration
                     bacteria[i].wrapAngle = 180 - (51.08*exp(-1.439*bacteria[i].maxRunDuration)+87.02);
                     //bacteria[i].wrapAngle = bacteria[i].maxWrapAngle;
                     bacteria[i].wrapAngle = bacteria[i].wrapAngle/(398.67*bacteria[i].maxRunDuration);
-                    //bacteria[i].wrapAngle = wrapAngle_distribution(wrapAngle_seed);
-                    if ( rand() / (RAND_MAX + 1.0) < 0.5)
+                    //bacteria[i].wrapAngle = wrapAngle_distribution.mean() + wrapAngle_distribution.stddev() * tmpRandom.Gaussian();
+                    if ( tmpRandom.Uniform() < 0.5)
                     {
                         bacteria[i].wrapAngle *= -1.0 ;
                     }
-                    //WriteWrapDataByBacteria(i);
+                    Log_MotilityEvent(i, motilityLog_wrapStart, bacteria[i].wrapAngle, bacteria[i].maxRunDuration) ;
                 }
                 else
                 {
@@ -1500,29 +1616,30 @@ void TissueBacteria:: Check_Perform_AllReversing_andWrapping()
                     bacteria[i].wrapTimer = 0.0 ;
                     bacteria[i].wrapAngle = 0.0 ;
                      */
-                    //bacteria[i].maxRunDuration = bacteria[i].LogNormalMaxRunDuration(runDuration_distribution, runDuration_seed, lognormal_run_a, run_calibrated, 1.0/reversalRate) ;
-                    bacteria[i].maxRunDuration = log_normal_truncated_ab_sample( .7144, .7440, 0, 9.6, seed );
+                    //bacteria[i].maxRunDuration = bacteria[i].LogNormalMaxRunDuration(runDuration_distribution, tmpRandom, lognormal_run_a, run_calibrated, 1.0/reversalRate) ;
+                    bacteria[i].maxRunDuration = runDurationSamples.Next(i, rng) ;
                     bacteria[i].reversalPeriod = bacteria[i].maxRunDuration;
+                    Schedule_RunEnd(i) ;
                     Reverse_IndividualBacteriaa(i) ;
                 }
             }
-            if (bacteria[i].wrapTimer > bacteria[i].wrapPeriod)
+            if (eventType == wrap_end_event)
             {
-                //WriteWrapDataByBacteria(i);
-                //WriteWrapDataByBacteria2(i);
+                Log_MotilityEvent(i, motilityLog_wrapEnd, bacteria[i].wrapAngle, (eventStep - bacteria[i].wrapStartStep + 1) * dt) ;
                 
                 bacteria[i].wrapMode = false ;
                 bacteria[i].wrapTimer = 0.0 ;
                 bacteria[i].wrapAngle = 0.0 ;
                 
                 bacteria[i].internalReversalTimer  = 0.0 ;
-                //bacteria[i].maxRunDuration = bacteria[i].LogNormalMaxRunDuration(runDuration_distribution, runDuration_seed, lognormal_run_a, run_calibrated, 1.0/reversalRate) ;
-                bacteria[i].maxRunDuration = log_normal_truncated_ab_sample( .7144, .7440, 0, 9.6, seed );
+                bacteria[i].runStartStep = eventStep ;
+                //bacteria[i].maxRunDuration = bacteria[i].LogNormalMaxRunDuration(runDuration_distribution, tmpRandom, lognormal_run_a, run_calibrated, 1.0/reversalRate) ;
+                bacteria[i].maxRunDuration = runDurationSamples.Next(i, rng) ;
                 bacteria[i].reversalPeriod = bacteria[i].maxRunDuration;
+                Schedule_RunEnd(i) ;
                 Reverse_IndividualBacteriaa(i) ;
                 
             }
-            bacteria[i].internalReversalTimer += dt ;
         }
         else        // chemotacticMechanism==true
         {
@@ -1538,30 +1655,36 @@ void TissueBacteria:: Check_Perform_AllReversing_andWrapping()
             }
             */
             
-            if (bacteria[i].wrapMode == false && bacteria[i].motilityMetabolism.switchMode == true )
+            if (eventType == switch_event && bacteria[i].wrapMode == false && bacteria[i].motilityMetabolism.switchMode == true )
             {
                 bacteria[i].internalReversalTimer  = 0.0 ;
-                if ( rand() / (RAND_MAX + 1.0) < bacteria[i].wrapProbability )
+                bacteria[i].runStartStep = eventStep ;
+                if ( tmpRandom.Uniform() < bacteria[i].wrapProbability )
                 {
                     bacteria[i].turnStatus = false ;
                     bacteria[i].turnTimer = 0.0 ;
+                    turnEvents.Cancel(i, turn_end_event) ;
                     
                     bacteria[i].wrapMode = true ;
-                    bacteria[i].maxRunDuration = log_normal_truncated_ab_sample ( -.3662, .9178, 0, 4, seed );
+                    bacteria[i].wrapStartStep = eventStep ;
+                    Schedule_WrapEnd(i) ;
+                    bacteria[i].maxRunDuration = wrapDurationSamples.Next(i, rng) ;
                     // bacteria[i].maxRunDuration = .5; // Used for Wrap Angle Calibration
                     //bacteria[i].wrapPeriod = bacteria[i].maxRunDuration;
-                    //bacteria[i].maxRunDuration = bacteria[i].LogNormalMaxRunDuration(wrapDuration_distribution,wrapDuration_seed, lognormal_wrap_a, run_calibrated, 1.0/bacteria[i].wrapRate) ;
+                    //bacteria[i].maxRunDuration = bacteria[i].LogNormalMaxRunDuration(wrapDuration_distribution,tmpRandom, lognormal_wrap_a, run_calibrated, 1.0/bacteria[i].wrapRate) ;
                   //  bacteria[i].wrapAngle = (2.0*(rand() / (RAND_MAX + 1.0))-1.0 ) * bacteria[i].maxWrapAngle ;
                   //  bacteria[i].wrapAngle = (2.0*(rand() / (RAND_MAX + 1.0))-1.0 ) * bacteria[i].maxTurnAngle ; // Used for Wrap Angle Calibration
                     bacteria[i].wrapAngle = 180 - (51.08*exp(-1.439*bacteria[i].maxRunDuration)+87.02);
                     //bacteria[i].wrapAngle = bacteria[i].maxWrapAngle;
                     bacteria[i].wrapAngle = bacteria[i].wrapAngle/(398.67*bacteria[i].maxRunDuration);
-                    //bacteria[i].wrapAngle = wrapAngle_distribution(wrapAngle_seed);
-                    if ( rand() / (RAND_MAX + 1.0) < 0.5)
+                    //bacteria[i].wrapAngle = wrapAngle_distribution.mean() + wrapAngle_distribution.stddev() * tmpRandom.Gaussian();
+                    if ( tmpRandom.Uniform() < 0.5)
                     {
                         bacteria[i].wrapAngle *= -1.0 ;
                     }
-                    //WriteWrapDataByBacteria(i);
+                    Log_MotilityEvent(i, motilityLog_wrapStart, bacteria[i].wrapAngle, bacteria[i].maxRunDuration) ;
+                    //switchMode is still set, so the wrap ends at the next step as when every bacterium was checked every step
+                    motilityEvents.Schedule(i, switch_event, eventStep + 1) ;
                 }
                 else
                 {
@@ -1570,32 +1693,77 @@ void TissueBacteria:: Check_Perform_AllReversing_andWrapping()
                     bacteria[i].wrapTimer = 0.0 ;
                     bacteria[i].wrapAngle = 0.0 ;
                      */
-                    //bacteria[i].maxRunDuration = bacteria[i].LogNormalMaxRunDuration(runDuration_distribution, runDuration_seed, lognormal_run_a, run_calibrated, 1.0/reversalRate) ;
-                    bacteria[i].maxRunDuration = log_normal_truncated_ab_sample( .7144, .7440, 0, 9.6, seed );
+                    //bacteria[i].maxRunDuration = bacteria[i].LogNormalMaxRunDuration(runDuration_distribution, tmpRandom, lognormal_run_a, run_calibrated, 1.0/reversalRate) ;
+                    bacteria[i].maxRunDuration = runDurationSamples.Next(i, rng) ;
                     Reverse_IndividualBacteriaa(i) ;
                     bacteria[i].motilityMetabolism.switchMode = false ;
                 }
             }
-            else if (( bacteria[i].wrapMode == true) && ((bacteria[i].motilityMetabolism.switchMode == true) || (bacteria[i].wrapTimer > bacteria[i].wrapPeriod)))
+            else if (( bacteria[i].wrapMode == true) && ((eventType == switch_event && bacteria[i].motilityMetabolism.switchMode == true) || eventType == wrap_end_event))
             {
-                //WriteWrapDataByBacteria(i);
+                Log_MotilityEvent(i, motilityLog_wrapEnd, bacteria[i].wrapAngle, (eventStep - bacteria[i].wrapStartStep + 1) * dt) ;
 
                 bacteria[i].wrapMode = false ;
                 bacteria[i].wrapTimer = 0.0 ;
                 bacteria[i].wrapAngle = 0.0 ;
+                motilityEvents.Cancel(i, wrap_end_event) ;
                 
                 bacteria[i].internalReversalTimer  = 0.0 ;
-                //bacteria[i].maxRunDuration = bacteria[i].LogNormalMaxRunDuration(runDuration_distribution, runDuration_seed, lognormal_run_a, run_calibrated, 1.0/reversalRate) ;
-                bacteria[i].maxRunDuration = log_normal_truncated_ab_sample( .7144, .7440, 0, 9.6, seed );
+                bacteria[i].runStartStep = eventStep ;
+                //bacteria[i].maxRunDuration = bacteria[i].LogNormalMaxRunDuration(runDuration_distribution, tmpRandom, lognormal_run_a, run_calibrated, 1.0/reversalRate) ;
+                bacteria[i].maxRunDuration = runDurationSamples.Next(i, rng) ;
                 Reverse_IndividualBacteriaa(i) ;
                 bacteria[i].motilityMetabolism.switchMode = false ;
                 
             }
-            bacteria[i].internalReversalTimer += dt ;
             
         }
     }
 }
+//-----------------------------------------------------------------------------------------------------
+
+long TissueBacteria::StepsToPeriod(double period, bool strict) const
+{
+    long k = max(static_cast<long>(ceil(period / dt) ), 0L) ;
+    //the division may round either way
+    while (k > 0 && (k - 1) * dt >= period)
+    {
+        k-- ;
+    }
+    while (k * dt < period || (strict && k * dt <= period) )
+    {
+        k++ ;
+    }
+    return k ;
+}
+//-----------------------------------------------------------------------------------------------------
+
+//Due at the first step the timer reaches reversalPeriod, and never before the next check
+void TissueBacteria::Schedule_RunEnd(int i)
+{
+    if (chemotacticMechanism != observational)
+    {
+        return ;
+    }
+    long tmpStep = bacteria[i].runStartStep + StepsToPeriod(bacteria[i].reversalPeriod, false) ;
+    motilityEvents.Schedule(i, run_end_event, max(tmpStep, eventStep + 1) ) ;
+}
+//-----------------------------------------------------------------------------------------------------
+
+//Due at the first step the timer passes wrapPeriod
+void TissueBacteria::Schedule_WrapEnd(int i)
+{
+    long tmpStep = bacteria[i].wrapStartStep + StepsToPeriod(bacteria[i].wrapPeriod, true) ;
+    motilityEvents.Schedule(i, wrap_end_event, max(tmpStep, eventStep + 1) ) ;
+}
+//-----------------------------------------------------------------------------------------------------
+
+void TissueBacteria::Update_EventTimers(int i)
+{
+    bacteria[i].internalReversalTimer = (eventStep - bacteria[i].runStartStep) * dt ;
+    bacteria[i].wrapTimer = bacteria[i].wrapMode ? (eventStep - bacteria[i].wrapStartStep + 1) * dt : 0.0 ;
+    bacteria[i].turnTimer = bacteria[i].turnStatus ? (eventStep - bacteria[i].turnStartStep + 1) * dt : 0.0 ;
+}
 
 //-----------------------------------------------------------------------------------------------------
 
@@ -1622,7 +1790,7 @@ void TissueBacteria:: Initialize_BacteriaProteinLevel ()
     double allProtein = 0.0 ;
     for (int i=0; i<nbacteria; i++)
     {
-        bacteria[i].protein = rand() / (RAND_MAX + 1.0);
+        bacteria[i].protein = rng.Stream(i, eventStep, random_protein).Uniform() ;
         allProtein += bacteria[i].protein ;
         
     }
@@ -1685,12 +1853,64 @@ void TissueBacteria:: Update_NodeLevel_ProteinConcentraion ()
     }
 }
 //-----------------------------------------------------------------------------------------------------
-void TissueBacteria:: BacterialVisualization_ParaView ()
+void TissueBacteria:: Write_SnapshotVTK (const BacteriaSnapshot & snapshot)
 {
-    Update_NodeLevel_ProteinConcentraion() ;
-    Bacteria_CreateDuplicate() ;
-    Bacteria_MergeWithDuplicate() ;
-    int index = index1 ;
+    int index = snapshot.vtkIndex ;
+    //Nodes of the bacteria in the region of interest, every node without one
+    vtkNodes.clear() ;
+    for (uint i = 0; i < nbacteria; i++)
+    {
+        if (InOutputRegion(snapshot.x[i], snapshot.y[i]) )
+        {
+            for (uint j = 0; j < nnode; j++)
+            {
+                vtkNodes.push_back(i * nnode + j) ;
+            }
+        }
+    }
+    uint nPoints = static_cast<uint>(vtkNodes.size() ) ;
+    uint nCells = nPoints > 0 ? nPoints - 1 : 0 ;
+    if (vtkFormat == 1)
+    {
+        //Binary XML unstructured grid, one write per frame
+        vector<float> tmpPoints(3 * nPoints) ;
+        vector<float> tmpProtein(nPoints) ;
+        vector<int32_t> tmpId(nPoints) ;
+        for (uint k = 0; k < nPoints; k++)
+        {
+            tmpPoints[3 * k] = snapshot.nodeX[vtkNodes[k]] ;
+            tmpPoints[3 * k + 1] = snapshot.nodeY[vtkNodes[k]] ;
+            tmpPoints[3 * k + 2] = 0.0f ;
+            tmpProtein[k] = snapshot.protein[vtkNodes[k]] ;
+            tmpId[k] = vtkNodes[k] / nnode ;
+        }
+        vector<int32_t> connectivity(2 * nCells) ;
+        vector<int32_t> offsets(nCells) ;
+        vector<uint8_t> types(nCells, 3) ;
+        for (uint i = 0; i < nCells; i++)
+        {
+            connectivity[2 * i] = i ;
+            connectivity[2 * i + 1] = i + 1 ;
+            offsets[i] = 2 * (i + 1) ;
+        }
+        VtkXmlFile vtu (vtkCompress) ;
+        ostringstream body ;
+        body << "<Piece NumberOfPoints=\"" << nPoints << "\" NumberOfCells=\"" << nCells << "\">\n" ;
+        body << "<PointData Scalars=\"Protein_rate\">\n" ;
+        body << vtu.DataArray("Float32", "Protein_rate", 1, tmpProtein.data(), tmpProtein.size() * sizeof(float) ) ;
+        body << vtu.DataArray("Int32", "id", 1, tmpId.data(), tmpId.size() * sizeof(int32_t) ) ;
+        body << "</PointData>\n<Points>\n" ;
+        body << vtu.DataArray("Float32", "", 3, tmpPoints.data(), tmpPoints.size() * sizeof(float) ) ;
+        body << "</Points>\n<Cells>\n" ;
+        body << vtu.DataArray("Int32", "connectivity", 1, connectivity.data(), connectivity.size() * sizeof(int32_t) ) ;
+        body << vtu.DataArray("Int32", "offsets", 1, offsets.data(), offsets.size() * sizeof(int32_t) ) ;
+        body << vtu.DataArray("UInt8", "types", 1, types.data(), types.size() ) ;
+        body << "</Cells>\n</Piece>\n" ;
+        string vtuFileName = folderName + animationName + to_string(index) + ".vtu" ;
+        vtu.Write(vtuFileName, "UnstructuredGrid", "", body.str() ) ;
+        bacteriaPvd.Add(index, vtuFileName) ;
+        return ;
+    }
     string vtkFileName = folderName + animationName + to_string(index)+ ".vtk" ;
     ofstream ECMOut;
     ECMOut.open(vtkFileName.c_str());
@@ -1698,20 +1918,16 @@ void TissueBacteria:: BacterialVisualization_ParaView ()
     ECMOut<< "Result for paraview 2d code" << endl;
     ECMOut << "ASCII" << endl;
     ECMOut << "DATASET UNSTRUCTURED_GRID" << endl;
-    ECMOut << "POINTS " << points << " float" << endl;
-    for (uint i = 0; i < nbacteria; i++)
+    ECMOut << "POINTS " << nPoints << " float" << endl;
+    for (uint k = 0; k < nPoints; k++)
     {
-        for (uint j=0; j<nnode ; j++)
-        {
-            ECMOut << bacteria[i].duplicate[j].x << " " << bacteria[i].duplicate[j].y << " "
-            << 0.0 << endl;
-            
-        }
+        ECMOut << snapshot.nodeX[vtkNodes[k]] << " " << snapshot.nodeY[vtkNodes[k]] << " "
+        << 0.0 << endl;
     }
     ECMOut<< endl;
-    ECMOut<< "CELLS " << points-1<< " " << 3 *(points-1)<< endl;
+    ECMOut<< "CELLS " << nCells<< " " << 3 *nCells<< endl;
     
-    for (uint i = 0; i < (points-1); i++)           //number of connections per node
+    for (uint i = 0; i < nCells; i++)           //number of connections per node
     {
         
         ECMOut << 2 << " " << i << " "
@@ -1719,21 +1935,18 @@ void TissueBacteria:: BacterialVisualization_ParaView ()
         
     }
     
-    ECMOut << "CELL_TYPES " << points-1<< endl;             //connection type
-    for (uint i = 0; i < points-1; i++) {
+    ECMOut << "CELL_TYPES " << nCells<< endl;             //connection type
+    for (uint i = 0; i < nCells; i++) {
         ECMOut << "3" << endl;
     }
-    ECMOut << "POINT_DATA "<<points <<endl ;
+    ECMOut << "POINT_DATA "<<nPoints <<endl ;
     ECMOut << "SCALARS Protein_rate " << "float"<< endl;
     ECMOut << "LOOKUP_TABLE " << "default"<< endl;
-    for (uint i = 0; i < nbacteria ; i++)
-    {   for ( uint j=0; j<nnode ; j++)
+    for (uint k = 0; k < nPoints; k++)
     {
-        ECMOut<< bacteria[i].nodes[j].protein <<endl ;
-    }
+        ECMOut<< snapshot.protein[vtkNodes[k]] <<endl ;
     }
     ECMOut.close();
-    index1++ ;
 }
 
 //-----------------------------------------------------------------------------------------------------
@@ -1745,6 +1958,33 @@ void TissueBacteria:: ParaView_Liquid ()
      {
        return ;
      }
+     if (vtkFormat == 1)
+     {
+         vector<float> tmpX(X.begin(), X.begin() + nx) ;
+         vector<float> tmpY(Y.begin(), Y.begin() + ny) ;
+         vector<float> tmpZ(nz, 0.0f) ;
+         vector<float> tmpLiquid(static_cast<size_t>(nx) * ny * nz) ;
+         size_t m = 0 ;
+         for (int k = 0; k < nz ; k++) {
+             for (int j = 0; j < ny; j++) {
+                 for (int i = 0; i < nx; i++) {
+                     tmpLiquid[m++] = slime[i][j] ;
+                 }
+             }
+         }
+         string extent = "0 " + to_string(nx - 1) + " 0 " + to_string(ny - 1) + " 0 " + to_string(nz - 1) ;
+         VtkXmlFile vtr (vtkCompress) ;
+         ostringstream body ;
+         body << "<Piece Extent=\"" << extent << "\">\n<PointData Scalars=\"liquid\">\n" ;
+         body << vtr.DataArray("Float32", "liquid", 1, tmpLiquid.data(), tmpLiquid.size() * sizeof(float) ) ;
+         body << "</PointData>\n<Coordinates>\n" ;
+         body << vtr.DataArray("Float32", "X", 1, tmpX.data(), tmpX.size() * sizeof(float) ) ;
+         body << vtr.DataArray("Float32", "Y", 1, tmpY.data(), tmpY.size() * sizeof(float) ) ;
+         body << vtr.DataArray("Float32", "Z", 1, tmpZ.data(), tmpZ.size() * sizeof(float) ) ;
+         body << "</Coordinates>\n</Piece>\n" ;
+         vtr.Write(folderName + "Grid" + to_string(index) + ".vtr", "RectilinearGrid", "WholeExtent=\"" + extent + "\"", body.str() ) ;
+         return ;
+     }
      string vtkFileName2 = folderName + "Grid"+ to_string(index)+ ".vtk" ;
      ofstream SignalOut;
      SignalOut.open(vtkFileName2.c_str());
@@ -2002,15 +2242,6 @@ void TissueBacteria:: Handle_BacteriaTurnOrientation ()
             double orientation = Cal_BacteriaOrientation(i) ;
             bacteria[i].nodes[0].fMotorx = fTotal * cos(bacteria[i].turnAngle + orientation ) ;
             bacteria[i].nodes[0].fMotory = fTotal * sin(bacteria[i].turnAngle + orientation ) ;
-            bacteria[i].turnTimer += dt ;
-            
-            if (bacteria[i].turnTimer > turnPeriod)
-            {
-                //WriteReversalDataByBacteria(i);
-                bacteria[i].turnStatus = false ;
-                bacteria[i].turnTimer = 0.0 ;
-                bacteria[i].turnAngle = 0.0 ;
-            }
             
         }
         
@@ -2021,14 +2252,24 @@ void TissueBacteria:: Handle_BacteriaTurnOrientation ()
             double orientation = Cal_BacteriaOrientation(i) ;
             bacteria[i].nodes[0].fMotorx = fTotal * cos(bacteria[i].wrapAngle + orientation ) ;
             bacteria[i].nodes[0].fMotory = fTotal * sin(bacteria[i].wrapAngle + orientation ) ;
-            bacteria[i].wrapTimer += dt ;
             
         }
         if (bacteria[i].turnStatus && bacteria[i].wrapMode )
         {
+            Update_EventTimers(i) ;
             cout<< i <<'\t'<<bacteria[i].turnTimer<<'\t'<< bacteria[i].wrapTimer<<endl ;
         }
     }
+    //The turns that are over after this step
+    turnEvents.PopDue(eventStep, dueEvents) ;
+    for (uint k=0; k<dueEvents.size(); k++)
+    {
+        int i = dueEvents[k].bacterium ;
+        Log_MotilityEvent(i, motilityLog_turnEnd, bacteria[i].turnAngle, (eventStep - bacteria[i].turnStartStep + 1) * dt) ;
+        bacteria[i].turnStatus = false ;
+        bacteria[i].turnTimer = 0.0 ;
+        bacteria[i].turnAngle = 0.0 ;
+    }
 }
 //-----------------------------------------------------------------------------------------------------
 
@@ -2091,11 +2332,13 @@ void TissueBacteria:: UpdateReversalFrequency ()
                 {
                     bacteria[i].reversalPeriod = bacteria[i].maxRunDuration;
                     //bacteria[i].reversalPeriod = max(bacteria[i].maxRunDuration, minimumRunTime) ;
+                    Schedule_RunEnd(i) ;
                 }
                 else
                 {
                     bacteria[i].wrapPeriod = bacteria[i].maxRunDuration ;
                     //bacteria[i].wrapPeriod = max(bacteria[i].maxRunDuration, minimumRunTime) ;
+                    Schedule_WrapEnd(i) ;
                 }
                 
             }
@@ -2112,10 +2355,12 @@ void TissueBacteria:: UpdateReversalFrequency ()
                 {
                     bacteria[i].reversalPeriod = tmpPeriod;
                     //bacteria[i].reversalPeriod = max(tmpPeriod, minimumRunTime ) ;
+                    Schedule_RunEnd(i) ;
                 }
                 else
                 {
                     bacteria[i].wrapPeriod = tmpPeriod ;
+                    Schedule_WrapEnd(i) ;
                     //bacteria[i].wrapPeriod = bacteria[i].maxRunDuration ;
                     //bacteria[i].wrapPeriod = max(tmpPeriod, minimumRunTime ) ;
                 }
@@ -2149,19 +2394,19 @@ double TissueBacteria:: Cal_ChemoGradient2 (int i)
     {
         cout <<"Cal_ChemoGradient, index out of range "<<tmpXIndex<<'\t'<<tmpYIndex<<endl ;
     }
-    double ds = chemoProfile.at(tmpYIndex).at(tmpXIndex) - bacteria[i].oldChem ;
+    double ds = chemoProfile.at(tmpYIndex, tmpXIndex) - bacteria[i].oldChem ;
    // cout<<ds<<endl ;
-    bacteria[i].oldChem = chemoProfile.at(tmpYIndex).at(tmpXIndex) ;
+    bacteria[i].oldChem = chemoProfile.at(tmpYIndex, tmpXIndex) ;
     return ds;
 }
 //-----------------------------------------------------------------------------------------------------
 
-void TissueBacteria:: WriteTrajectoryFile ()
+void TissueBacteria:: Write_SnapshotTrajectory (const BacteriaSnapshot & snapshot)
 {
     ofstream trajectories (statsFolder +"trajectories.txt", ofstream::app) ;
     for (uint i = 0; i< nbacteria; i++)
     {
-        trajectories << bacteria[i].nodes.at((nnode-1)/2).x <<'\t'<<bacteria[i].nodes.at((nnode-1)/2).y <<endl ;
+        trajectories << snapshot.x[i] <<'\t'<<snapshot.y[i] <<endl ;
     }
     trajectories<< endl ;
 }
@@ -2261,18 +2506,7 @@ void TissueBacteria:: Find_FungalNetworkTrace (Fungi tmpFng)
                      }
                      */
                 }
-                //detect the grids close to the hyphae to make them a source of chemoattractant if we want secretion along the whole network
-                if (tmpH < dx * tmpFng.hyphaeWidth * tmpFng.hyphaeOverLiq && tmpAngle1 < pi/2.0 && tmpAngle2 < pi/2.0 && sourceAlongHyphae== true )
-                {
-                    sourceChemo.at(0).push_back(m*dx) ;
-                    sourceChemo.at(1).push_back(n*dy) ;
-                    double tmpXtoX1 = Dist2D(tmpFng.hyphaeSegments.at(i).x1, tmpFng.hyphaeSegments.at(i).y1, m*dx, n*dy ) ;
-                    
-                    //linear secretion change along the hyphae segment. ( constant if p2==p1)
-                    double pSource = tmpFng.hyphaeSegments.at(i).p1 + (tmpFng.hyphaeSegments.at(i).p2 - tmpFng.hyphaeSegments.at(i).p1)*(tmpXtoX1/tmpL) ;
-                    sourceProduction.push_back(pSource) ;
-                    
-                }
+                //the grids close to the hyphae are found by Find_secretion_Coord_Rate if we want secretion along the whole network
     
                 
             }
@@ -2286,217 +2520,263 @@ void TissueBacteria:: Find_FungalNetworkTrace (Fungi tmpFng)
 //Update the liquid concentration based on relative location with respect to fungi network
 void TissueBacteria:: Find_FungalNetworkTrace2 (Fungi tmpFng)
 {
-    int m = 0 ;
-    int n = 0 ;
-    double xMin;
-    double xMax ;
-    double yMin ;
-    double yMax ;
-    int mMin = 0 ;
-    int mMax= nx ;
-    int nMin = 0 ;
-    int nMax = ny ;
-    double tmpH ;
-    double tmpS ;
-    double tmpL ;
-    double vec1x , vec1y, vec2x , vec2y ;
-    vector<vector<pair<bool, double>> > tmpHyphaeEdge ;
-    //false when the grid is on top of at least one hyphae segment
-    tmpHyphaeEdge.resize(nx, vector<pair<bool, double> > (ny, make_pair(true, liqBackground) ) ) ;
-    
+    //0 for the background, hyphaeLayerMark for the liquid layer around hyphae and onHyphaeMark when the grid is on top of at
+    //least one hyphae segment. Only the highest mark of a grid matters.
+    hyphaeMark.assign(static_cast<size_t>(nx) * ny, 0) ;
+    hyphaeBandWidth = dx * tmpFng.hyphaeWidth ;
+    hyphaeInnerWidth = dx * tmpFng.hyphaeWidth * tmpFng.hyphaeOverLiq ;
+    hyphaeCapRadius = tmpFng.hyphaeWidth * tmpFng.hyphaeOverLiq ;
+    hyphaeIndex.Build(tmpFng.hyphaeSegments, 0.0) ;
     
+    vector<int> found ;
     for (uint i=0; i< tmpFng.hyphaeSegments.size(); i++)
     {
-        xMin = min(tmpFng.hyphaeSegments.at(i).x1,tmpFng.hyphaeSegments.at(i).x2) ;
-        xMax = max(tmpFng.hyphaeSegments.at(i).x1,tmpFng.hyphaeSegments.at(i).x2) ;
-        yMin = min(tmpFng.hyphaeSegments.at(i).y1,tmpFng.hyphaeSegments.at(i).y2) ;
-        yMax = max(tmpFng.hyphaeSegments.at(i).y1,tmpFng.hyphaeSegments.at(i).y2) ;
-        mMin = (static_cast<int> (floor ( fmod (xMin + domainx , domainx) / dx ) ) ) % nx  ;
-        mMax = (static_cast<int> (ceil ( fmod (xMax + domainx , domainx) / dx ) ) ) % nx  ;
-        nMin = (static_cast<int> (floor ( fmod (yMin + domainy , domainy) / dy ) ) ) % ny  ;
-        nMax = (static_cast<int> (ceil ( fmod (yMax + domainy , domainy) / dy ) ) ) % ny  ;
-        int tmpNghbrhood = static_cast<int>( 1.5 * tmpFng.hyphaeWidth / dx) ;
-        mMin -= tmpNghbrhood ; mMax += tmpNghbrhood ; nMin -= tmpNghbrhood ; nMax += tmpNghbrhood;
-        
-        tmpL = Dist2D(tmpFng.hyphaeSegments.at(i).x1, tmpFng.hyphaeSegments.at(i).y1, tmpFng.hyphaeSegments.at(i).x2, tmpFng.hyphaeSegments.at(i).y2) ;
-        //going through nearby grids
-        for (int m = mMin ; m <= mMax ; m++)
+        Rasterize_HyphaeSegment(i, found, nullptr) ;
+    }
+    //Update values for the grids based on where with respect to the fungi network
+    for (int i=0 ; i< nx; i++)
+    {
+        for (int j=0 ; j< ny ; j++)
+        {
+            Update_SlimeFromMark(i, j) ;
+        }
+    }
             
+}
+//-----------------------------------------------------------------------------------------------------
+
+void TissueBacteria::Mark_HyphaeGrid(int m, int n, uint8_t mark, vector<size_t> * touched)
+{
+    if (m >= 0 && m < nx && n >= 0 && n < ny)
+    {
+        size_t k = static_cast<size_t>(m) * ny + n ;
+        if (hyphaeMark[k] < mark)
         {
-            for (int n = nMin; n <= nMax; n++)
+            if (touched != nullptr)
             {
-                vec1x = tmpFng.hyphaeSegments.at(i).x1 - m * dx ;
-                vec1y = tmpFng.hyphaeSegments.at(i).y1 - n * dy ;
-                vec2x = tmpFng.hyphaeSegments.at(i).x2 - m * dx ;
-                vec2y = tmpFng.hyphaeSegments.at(i).y2 - n * dy ;
-                tmpS = TriangleArea(vec1x, vec1y, vec2x, vec2y) ;
-                // 0.5 * h * l  = S
-                tmpH = 2.0 * tmpS / tmpL ;
-                
-                vec2x= tmpFng.hyphaeSegments.at(i).x1 - tmpFng.hyphaeSegments.at(i).x2 ;
-                vec2y= tmpFng.hyphaeSegments.at(i).y1 - tmpFng.hyphaeSegments.at(i).y2 ;
-                double tmpAngle1 = AngleOfTwoVectors(vec1x, vec1y, vec2x, vec2y) ;
-                
-                vec1x = tmpFng.hyphaeSegments.at(i).x2 - m * dx ;
-                vec1y = tmpFng.hyphaeSegments.at(i).y2 - n * dy;
-                vec2x *= -1.0 ;
-                vec2y *= -1.0 ;
-                
-                double tmpAngle2 = AngleOfTwoVectors(vec1x, vec1y, vec2x, vec2y) ;
-                //angles are used to define the rectangle as a hyphae segment
-                if (tmpH < dx * tmpFng.hyphaeWidth && tmpAngle1 < pi/2.0 && tmpAngle2 < pi/2.0 )
-                {
-                    //the grid is inside of the hyphae segment
-                    if (tmpH < dx * tmpFng.hyphaeWidth * tmpFng.hyphaeOverLiq)
-                    {
-                        tmpHyphaeEdge[m][n].first = false ;
-                    }
-                    else
-                    {
-                        /* concentration exponetially decays with distance from hyphae ( but there is a cut off
-                        tmpHyphaeEdge[m][n].second = max(5.0*liqBackground + 5.0 *liqBackground * exp(-tmpH/tmpFng.hyphaeWidth ),slime[m][n]) ;
-                        slime[m][n] = max(5.0*liqBackground + 5.0 *liqBackground * exp(-tmpH/tmpFng.hyphaeWidth ),slime[m][n]) ;
-                         */
-                        tmpHyphaeEdge[m][n].second = liqLayer ;
-                        slime[m][n] = liqLayer ;
-                    }
-                    
-                }
-                //detect the grids close to the hyphae to make them a source of chemoattractant if we want secretion along the whole network
-                if (tmpH < dx * tmpFng.hyphaeWidth * tmpFng.hyphaeOverLiq && tmpAngle1 < pi/2.0 && tmpAngle2 < pi/2.0 && sourceAlongHyphae== true )
-                {
-                    sourceChemo.at(0).push_back(m*dx) ;
-                    sourceChemo.at(1).push_back(n*dy) ;
-                    double tmpXtoX1 = Dist2D(tmpFng.hyphaeSegments.at(i).x1, tmpFng.hyphaeSegments.at(i).y1, m*dx, n*dy ) ;
-                    //linear secretion change along the hyphae segment. ( constant if p2==p1)
-                    double pSource = tmpFng.hyphaeSegments.at(i).p1 + (tmpFng.hyphaeSegments.at(i).p2 - tmpFng.hyphaeSegments.at(i).p1)*(tmpXtoX1/tmpL) ;
-                    sourceProduction.push_back(pSource) ;
-                    
-                }
-    
-                
+                touched->push_back(k) ;
             }
-            
+            hyphaeMark[k] = mark ;
         }
     }
-    //Add semi-circle at the endpoint of each hyphae segment
-    for (uint i=0; i<tmpFng.hyphaeSegments.size(); i++ )
+}
+//-----------------------------------------------------------------------------------------------------
+
+void TissueBacteria::Update_SlimeFromMark(int m, int n)
+{
+    uint8_t tmpMark = hyphaeMark[static_cast<size_t>(m) * ny + n] ;
+    if (tmpMark == onHyphaeMark)
     {
-        xMin = tmpFng.hyphaeSegments.at(i).x2 ;
-        yMin = tmpFng.hyphaeSegments.at(i).y2 ;
-        
-        mMin = (static_cast<int> (floor ( fmod (xMin - tmpFng.hyphaeWidth * tmpFng.hyphaeOverLiq  + domainx , domainx) / dx ) ) ) % nx  ;
-        mMax = (static_cast<int> (ceil ( fmod (xMin + tmpFng.hyphaeWidth * tmpFng.hyphaeOverLiq + domainx , domainx) / dx ) ) ) % nx  ;
-        nMin = (static_cast<int> (floor ( fmod (yMin - tmpFng.hyphaeWidth * tmpFng.hyphaeOverLiq + domainy , domainy) / dy ) ) ) % ny  ;
-        nMax = (static_cast<int> (ceil ( fmod (yMin + tmpFng.hyphaeWidth * tmpFng.hyphaeOverLiq + domainy , domainy) / dy ) ) ) % ny  ;
-        for (int m = mMin ; m <= mMax ; m++)
-        {
-            for (int n = nMin; n <= nMax; n++)
+        slime[m][n] = liqHyphae ;
+    }
+    else if (tmpMark == hyphaeLayerMark)
+    {
+        slime[m][n] = liqLayer ;
+    }
+    else
+    {
+        slime[m][n] = liqBackground ;
+    }
+}
+//-----------------------------------------------------------------------------------------------------
+
+//A segment is the rectangle of half width hyphaeBandWidth along it, with the circle of radius hyphaeCapRadius at its end
+//( and at its start for the first segments). Inside of hyphaeInnerWidth, or of half the radius, the grid is on top of the
+//hyphae. Only the segments of hyphaeIndex near the point are looked at
+uint8_t TissueBacteria::HyphaeMark_AtPoint(double x, double y, vector<int> & found) const
+{
+    uint8_t mark = 0 ;
+    //The index only gathers the candidates, with a margin for the round-off of the band test below
+    hyphaeIndex.WithinRadius(x, y, max(hyphaeBandWidth, hyphaeCapRadius) + 0.5 * dx, found) ;
+    for (size_t s = 0; s < found.size() && mark < onHyphaeMark; s++)
+    {
+        int k = found[s] ;
+        double x1 = hyphaeIndex.x1[k] ;
+        double y1 = hyphaeIndex.y1[k] ;
+        double x2 = hyphaeIndex.x2[k] ;
+        double y2 = hyphaeIndex.y2[k] ;
+        double tmpL = Dist2D(x1, y1, x2, y2) ;
+        if (tmpL > 0.0)
+        {
+            double vec1x = x1 - x ;
+            double vec1y = y1 - y ;
+            double tmpVec2x = x2 - x ;
+            double tmpVec2y = y2 - y ;
+            double vec2x = x1 - x2 ;
+            double vec2y = y1 - y2 ;
+            // 0.5 * h * l  = S
+            double tmpH = 2.0 * TriangleArea(vec1x, vec1y, tmpVec2x, tmpVec2y) / tmpL ;
+            if (tmpH < hyphaeBandWidth)
             {
-                tmpH = Dist2D(xMin, yMin, m * dx, n * dy) ;
-                if ( tmpH < 0.5 * tmpFng.hyphaeWidth * tmpFng.hyphaeOverLiq  )
+                //angles are used to define the rectangle as a hyphae segment. The sign of the dot product decides
+                //unless the angle is too close to 90 degrees, then the angle itself is compared
+                double segLength2 = vec2x * vec2x + vec2y * vec2y ;
+                double dot1 = vec1x * vec2x + vec1y * vec2y ;
+                double dot2 = - (tmpVec2x * vec2x + tmpVec2y * vec2y) ;
+                double tolerance1 = 1e-20 * (vec1x * vec1x + vec1y * vec1y) * segLength2 ;
+                double tolerance2 = 1e-20 * (tmpVec2x * tmpVec2x + tmpVec2y * tmpVec2y) * segLength2 ;
+                bool inside1 = (dot1 * dot1 > tolerance1) ? dot1 > 0.0 : AngleOfTwoVectors(vec1x, vec1y, vec2x, vec2y) < pi/2.0 ;
+                bool inside2 = (dot2 * dot2 > tolerance2) ? dot2 > 0.0 : AngleOfTwoVectors(tmpVec2x, tmpVec2y, -vec2x, -vec2y) < pi/2.0 ;
+                if (inside1 && inside2 && tmpH < hyphaeInnerWidth)
                 {
-                    tmpHyphaeEdge[m][n].first = false ;
+                    mark = onHyphaeMark ;
                 }
-                else if ( tmpH < tmpFng.hyphaeWidth * tmpFng.hyphaeOverLiq )
+                else if (inside1 && inside2 && mark < hyphaeLayerMark)
                 {
-                    /* concentration exponetially decays with distance from hyphae ( but there is a cut off
-                    tmpHyphaeEdge[m][n].second = max(5.0*liqBackground + 5.0 *liqBackground * exp(-tmpH/tmpFng.hyphaeWidth ),slime[m][n]) ;
-                    slime [m][n] = max(5.0*liqBackground + 5.0 *liqBackground * exp(-tmpH/tmpFng.hyphaeWidth ),slime[m][n]) ;
-                     */
-                    tmpHyphaeEdge[m][n].second = liqLayer ;
-                    slime[m][n] = liqLayer ;
+                    mark = hyphaeLayerMark ;
                 }
             }
         }
-        //Add the semi-circle for the very first segments
-        if (tmpFng.hyphaeSegments.at(i).from_who == -1)
-            {
-                xMin = tmpFng.hyphaeSegments.at(i).x1 ;
-                yMin = tmpFng.hyphaeSegments.at(i).y1 ;
-        
-                //xMin = tmpFng.hyphaeSegments.at(i).x2 ;
-                //yMin = tmpFng.hyphaeSegments.at(i).y2 ;
-        
-                mMin = (static_cast<int> (floor ( fmod (xMin - tmpFng.hyphaeWidth * tmpFng.hyphaeOverLiq  + domainx , domainx) / dx ) ) ) % nx  ;
-                mMax = (static_cast<int> (ceil ( fmod (xMin + tmpFng.hyphaeWidth * tmpFng.hyphaeOverLiq + domainx , domainx) / dx ) ) ) % nx  ;
-                nMin = (static_cast<int> (floor ( fmod (yMin - tmpFng.hyphaeWidth * tmpFng.hyphaeOverLiq + domainy , domainy) / dy ) ) ) % ny  ;
-                nMax = (static_cast<int> (ceil ( fmod (yMin + tmpFng.hyphaeWidth * tmpFng.hyphaeOverLiq + domainy , domainy) / dy ) ) ) % ny  ;
-                for (int m = mMin ; m <= mMax ; m++)
-                {
-                for (int n = nMin; n <= nMax; n++)
-                    {
-                        tmpH = Dist2D(xMin, yMin, m * dx, n * dy) ;
-                        if ( tmpH < 0.5 * tmpFng.hyphaeWidth * tmpFng.hyphaeOverLiq  )
-                        {
-                            tmpHyphaeEdge[m][n].first = false ;
-                        }
-                        else if ( tmpH < tmpFng.hyphaeWidth * tmpFng.hyphaeOverLiq )
-                        {
-                            /* concentration exponetially decays with distance from hyphae ( but there is a cut off
-                            tmpHyphaeEdge[m][n].second = max(5.0*liqBackground + 5.0 *liqBackground * exp(-tmpH/tmpFng.hyphaeWidth ),slime[m][n]) ;
-                            slime [m][n] = max(5.0*liqBackground + 5.0 *liqBackground * exp(-tmpH/tmpFng.hyphaeWidth ),slime[m][n]) ;
-                             */
-                            tmpHyphaeEdge[m][n].second = liqLayer ;
-                            slime[m][n] = liqLayer ;
-                        }
-                    }
-                 }
-            }
+        double tmpCap = Dist2D(x2, y2, x, y) ;
+        if (hyphaeIndex.root[k])
+        {
+            tmpCap = min(tmpCap, Dist2D(x1, y1, x, y) ) ;
+        }
+        if (tmpCap < 0.5 * hyphaeCapRadius)
+        {
+            mark = onHyphaeMark ;
+        }
+        else if (tmpCap < hyphaeCapRadius && mark < hyphaeLayerMark)
+        {
+            mark = hyphaeLayerMark ;
+        }
     }
-    //Update values for the grids based on where with respect to the fungi network
-    for (int i=0 ; i< tmpHyphaeEdge.size(); i++)
+    return mark ;
+}
+//-----------------------------------------------------------------------------------------------------
+
+//Every grid that segment k can reach takes the mark of all the segments near it
+void TissueBacteria::Rasterize_HyphaeSegment(int k, vector<int> & found, vector<size_t> * touched)
+{
+    double radius = max(hyphaeBandWidth, hyphaeCapRadius) ;
+    double x1 = hyphaeIndex.x1[k] ;
+    double y1 = hyphaeIndex.y1[k] ;
+    double x2 = hyphaeIndex.x2[k] ;
+    double y2 = hyphaeIndex.y2[k] ;
+    int mMin = max(static_cast<int>(floor( (min(x1, x2) - radius) / dx) ), 0) ;
+    int mMax = min(static_cast<int>(ceil( (max(x1, x2) + radius) / dx) ), nx - 1) ;
+    int nMin = max(static_cast<int>(floor( (min(y1, y2) - radius) / dy) ), 0) ;
+    int nMax = min(static_cast<int>(ceil( (max(y1, y2) + radius) / dy) ), ny - 1) ;
+    for (int m = mMin ; m <= mMax ; m++)
     {
-        for (int j=0 ; j< tmpHyphaeEdge.at(i).size() ; j++)
+        for (int n = nMin; n <= nMax; n++)
         {
-            if (tmpHyphaeEdge.at(i).at(j).first == true)
-            {
-                slime[i][j] = tmpHyphaeEdge.at(i).at(j).second ;
-            }
-            else
+            if (hyphaeMark[static_cast<size_t>(m) * ny + n] < onHyphaeMark)
             {
-                slime[i][j] = liqHyphae ;
+                Mark_HyphaeGrid(m, n, HyphaeMark_AtPoint(m * dx, n * dy, found), touched) ;
             }
         }
     }
-            
 }
 //-----------------------------------------------------------------------------------------------------
 
-void TissueBacteria::Update_MotilityMetabolism_Only(double tmpDt)
+//Marks only go up when segments are added, so the grids whose mark changed are the only ones to update.
+//Tip sources are moved on the solved chemo profile. Production along the hyphae is left as it was found at the start.
+void TissueBacteria::Add_FungalSegments(const Fungi & tmpFng, const vector<int> & newSegments, const vector<int> & gainedTips, const vector<int> & lostTips)
 {
-    Update_MM_Legand() ;
-    for (int i=0 ; i< nbacteria ; i++)
+    if (newSegments.empty() )
+    {
+        return ;
+    }
+    //New segments are appended to the network, so they are inserted in the same order
+    bool inserted = true ;
+    for (uint i = 0; i < newSegments.size() && inserted; i++)
+    {
+        inserted = (static_cast<size_t>(newSegments.at(i) ) == hyphaeIndex.x1.size() ) && hyphaeIndex.Insert(tmpFng.hyphaeSegments.at(newSegments.at(i) ) ) ;
+    }
+    if (inserted == false)
+    {
+        hyphaeIndex.Build(tmpFng.hyphaeSegments, 0.0) ;
+    }
+    vector<size_t> touched ;
+    vector<int> found ;
+    for (uint i = 0; i < newSegments.size(); i++)
+    {
+        Rasterize_HyphaeSegment(newSegments.at(i), found, &touched) ;
+    }
+    for (uint k = 0; k < touched.size(); k++)
     {
-        bacteria[i].motilityMetabolism.Cal_SwitchProbability(tmpDt) ;
+        int m = static_cast<int>(touched.at(k) / ny) ;
+        int n = static_cast<int>(touched.at(k) % ny) ;
+        Update_SlimeFromMark(m, n) ;
+        Update_ViscousDampingCoeff(m, n) ;
     }
+    
+    if (sourceAlongHyphae || tGrids.chemo_profile_type != production_profile)
+    {
+        return ;
+    }
+    sourceChemo = tmpFng.tips_Coord ;
+    sourceProduction.assign(sourceChemo.at(0).size(), tmpFng.production) ;
+    for (uint i = 0; i < lostTips.size(); i++)
+    {
+        const HyphaeSegment & hy = tmpFng.hyphaeSegments.at(lostTips.at(i) ) ;
+        Add_ChemoSource(hy.x2, hy.y2, -tmpFng.production) ;
+    }
+    for (uint i = 0; i < gainedTips.size(); i++)
+    {
+        const HyphaeSegment & hy = tmpFng.hyphaeSegments.at(gainedTips.at(i) ) ;
+        Add_ChemoSource(hy.x2, hy.y2, tmpFng.production) ;
+    }
+    cout<<"Fungal network grew by "<<newSegments.size()<<" segments, "<<touched.size()<<" liquid grids updated"<<endl ;
 }
 //-----------------------------------------------------------------------------------------------------
 
-void TissueBacteria::Update_MotilityMetabolism_Only2(double tmpDt)
+//Same choice of solver as TB_Cal_ChemoDiffusion2D
+void TissueBacteria::Add_ChemoSource(double x, double y, double pSrc)
 {
-    Update_MM_Legand() ;
-    for (int j=0; j < 10; j++)
+    if (speciesGrids.nSpecies > 1)
     {
-        for (int i=0 ; i< nbacteria ; i++)
-        {
-            bacteria[i].motilityMetabolism.Cal_SwitchProbability(tmpDt) ;
-        }
+        speciesGrids.AddProduction(x, y, pSrc) ;
+    }
+    else if (tGrids.amrRefinement)
+    {
+        amrGrids.AddProduction(x, y, pSrc) ;
+        //new patches can move the refined values
+        chemoProfile = amrGrids.Profile() ;
+    }
+    else
+    {
+        tGrids.AddProduction(x, y, pSrc) ;
     }
 }
 //-----------------------------------------------------------------------------------------------------
 
-void TissueBacteria::Update_MotilityMetabolism(double tmpDt)
+void TissueBacteria::Cal_AllSwitchProbabilities(double tmpDt, int nRepeat)
 {
     Update_MM_Legand() ;
+    metabolismBatch.Gather(bacteria, nbacteria) ;
+    metabolismBatch.Cal_SwitchProbability(tmpDt, nRepeat) ;
+    metabolismBatch.Scatter(bacteria) ;
+}
+//-----------------------------------------------------------------------------------------------------
+
+void TissueBacteria::Update_MotilityMetabolism_Only(double tmpDt)
+{
+    Cal_AllSwitchProbabilities(tmpDt, 1) ;
+}
+//-----------------------------------------------------------------------------------------------------
+
+void TissueBacteria::Update_MotilityMetabolism_Only2(double tmpDt)
+{
+    Cal_AllSwitchProbabilities(tmpDt, 10) ;
+}
+//-----------------------------------------------------------------------------------------------------
+
+void TissueBacteria::Update_MotilityMetabolism(double tmpDt)
+{
+    Cal_AllSwitchProbabilities(tmpDt, 1) ;
     
     for (int i=0 ; i< nbacteria ; i++)
     {
-        bacteria[i].motilityMetabolism.Cal_SwitchProbability(tmpDt) ;
         if ( bacteria[i].motilityMetabolism.switchMode == false &&
-            rand() / (RAND_MAX + 1.0) < bacteria[i].motilityMetabolism.switchProbability)
+            rng.Stream(i, eventStep, random_switch).Uniform() < bacteria[i].motilityMetabolism.switchProbability)
         {
             bacteria[i].motilityMetabolism.switchMode = true ;
+            if (chemotacticMechanism == metabolism)
+            {
+                motilityEvents.Schedule(i, switch_event, eventStep + 1) ;
+            }
         }
     }
     WriteSwitchProbabilities() ;
@@ -2522,21 +2802,36 @@ void TissueBacteria:: WriteSwitchProbabilities()
 //-----------------------------------------------------------------------------------------------------
 
 void TissueBacteria:: WriteSwitchProbabilitiesByBacteria()
-{   for (int i=0; i<nbacteria; i++)
+{
+    //The snapshot of the frames is not in use between frames when the output is synchronous
+    BacteriaSnapshot & snapshot = snapshotWriter.IsRunning() ? metabolismSnapshot : frameSnapshot ;
+    Capture_Snapshot(snapshot, false) ;
+    Write_SnapshotSwitchProbabilities(snapshot) ;
+}
+//-----------------------------------------------------------------------------------------------------
+
+void TissueBacteria:: Write_SnapshotSwitchProbabilities(const BacteriaSnapshot & snapshot)
+{
+    if (switchLogMode != switchLog_perBacteria)
+    {
+        switchLog.Write(snapshot) ;
+        return ;
+    }
+    for (int i=0; i<nbacteria; i++)
     {
     ofstream strSwitchP2;
     strSwitchP2.open(statsFolder + "WriteSwitchProbabilities_Bacteria" + to_string(i) + ".txt", ios::app);
     {
        // strSwitchP << bacteria[i].motilityMetabolism.switchProbability << '\t'  ;
-        strSwitchP2 << setw(10) << bacteria[i].maxRunDuration << '\t' 
-                    << setw(10) << bacteria[i].motilityMetabolism.receptorActivity << '\t'
-                    << setw(10) << bacteria[i].motilityMetabolism.legand << '\t'
-                    << setw(10) << bacteria[i].motilityMetabolism.methylation << '\t'
-                    << setw(10) << bacteria[i].motilityMetabolism.changeRate << '\t'
-                    << setw(10) << bacteria[i].motilityMetabolism.LegandEnergy << '\t'
-                    << setw(10) << bacteria[i].motilityMetabolism.MethylEnergy << '\t'
-                    << setw(10) << bacteria[i].motilityMetabolism.switchProbability  << '\t'
-                    << setw(10) << bacteria[i].motilityMetabolism.switchMode  << '\t';
+        strSwitchP2 << setw(10) << snapshot.maxRunDuration[i] << '\t' 
+                    << setw(10) << snapshot.receptorActivity[i] << '\t'
+                    << setw(10) << snapshot.legand[i] << '\t'
+                    << setw(10) << snapshot.methylation[i] << '\t'
+                    << setw(10) << snapshot.changeRate[i] << '\t'
+                    << setw(10) << snapshot.legandEnergy[i] << '\t'
+                    << setw(10) << snapshot.methylEnergy[i] << '\t'
+                    << setw(10) << snapshot.switchProbability[i]  << '\t'
+                    << setw(10) << snapshot.switchMode[i]  << '\t';
                     
     }
     strSwitchP2<< endl ;
@@ -2597,6 +2892,7 @@ void TissueBacteria:: WriteWrapDataByBacteria(int i)
 
 void TissueBacteria:: WriteWrapDataByBacteria2(int i)
 {
+        Update_EventTimers(i) ;
         ofstream strReversal1;
         strReversal1.open(statsFolder + "WriteWrapData_Bacteria2_" + to_string(i) + ".txt", ios::app);
         {
@@ -2618,18 +2914,23 @@ void TissueBacteria::Update_MM_Legand()
         {
             cout <<"Cal_ChemoGradient, index out of range "<<tmpXIndex<<'\t'<<tmpYIndex<<endl<<flush ;
         }
-        double s = chemoProfile.at(tmpYIndex).at(tmpXIndex) ;
+        if (speciesGrids.nSpecies > 1)
+        {
+            const double * cell = speciesGrids.Cell(tmpYIndex, tmpXIndex) ;
+            copy(cell, cell + speciesGrids.nSpecies, bacteria[i].motilityMetabolism.speciesLegand) ;
+        }
+        double s = chemoProfile.at(tmpYIndex, tmpXIndex) ;
         bacteria[i].motilityMetabolism.legand = 1.0 * s ;
     }
     
 }
 //-----------------------------------------------------------------------------------------------------
 
-void TissueBacteria::Pass_PointSources_To_Bacteria(vector<vector<double> > sourceP)
+void TissueBacteria::Pass_PointSources_To_Bacteria(const vector<vector<double> > & sourceP)
 {
     for (int i=0; i< nbacteria; i++)
     {
-        bacteria[i].chemoPointSources = sourceP ;
+        bacteria[i].chemoPointSources = &sourceP ;
     }
 }
 //-----------------------------------------------------------------------------------------------------
@@ -2640,8 +2941,9 @@ void TissueBacteria::Update_BacteriaMaxDuration()
     {
         for (int i=0; i<nbacteria; i++)
         {
-            //bacteria[i].maxRunDuration = bacteria[i].LogNormalMaxRunDuration(runDuration_distribution, runDuration_seed, lognormal_run_a, run_calibrated, 1.0/reversalRate ) ;
-            bacteria[i].maxRunDuration = log_normal_truncated_ab_sample( .7144, .7440, 0, 9.6, seed );
+            //RandomStream tmpRandom = rng.Stream(i, eventStep, random_runDuration) ;
+            //bacteria[i].maxRunDuration = bacteria[i].LogNormalMaxRunDuration(runDuration_distribution, tmpRandom, lognormal_run_a, run_calibrated, 1.0/reversalRate ) ;
+            bacteria[i].maxRunDuration = runDurationSamples.Next(i, rng) ;
         }
     }
     else
@@ -2654,16 +2956,16 @@ void TissueBacteria::Update_BacteriaMaxDuration()
 }
 //-----------------------------------------------------------------------------------------------------
 
-void TissueBacteria::WriteBacteria_AllStats()
+void TissueBacteria::Write_SnapshotStats(const BacteriaSnapshot & snapshot)
 {
-    int index = index1 ;
+    int index = snapshot.statsIndex ;
     string statFileName = statsFolder + animationName + to_string(index)+ ".txt" ;
     ofstream stat;
     stat.open(statFileName.c_str());
     for (uint i = 0 ; i< nbacteria; i++)
     {
-        stat<< bacteria[i].nodes[(nnode-1)/2].x <<'\t'<< bacteria[i].nodes[(nnode-1)/2].y<<'\t'
-        <<bacteria[i].locVelocity << '\t' << bacteria[i].locFriction << '\t' << Cal_BacteriaOrientation(i) << '\t' << bacteria[i].oldChem  ;
+        stat<< snapshot.x[i] <<'\t'<< snapshot.y[i]<<'\t'
+        <<snapshot.velocity[i] << '\t' << snapshot.friction[i] << '\t' << snapshot.orientation[i] << '\t' << snapshot.oldChem[i]  ;
         
         stat<<endl ;
     }
@@ -2671,6 +2973,368 @@ void TissueBacteria::WriteBacteria_AllStats()
 }
 //-----------------------------------------------------------------------------------------------------
 
+void TissueBacteria::Open_FrameStore()
+{
+    for (int c = 0; c < numberStatsColumns; c++)
+    {
+        frameStore.AddColumn(statsColumns[c].name, statsColumns[c].type, statsColumns[c].perNode ? nnode : 1) ;
+    }
+    frameStore.Open(statsFolder + animationName + "Stats.frames", nbacteria, frameStoreChunk) ;
+}
+//-----------------------------------------------------------------------------------------------------
+
+void TissueBacteria::Write_SnapshotFrameStore(const BacteriaSnapshot & snapshot)
+{
+    if (frameStore.IsOpen() == false)
+    {
+        return ;
+    }
+    copy(snapshot.x.begin(), snapshot.x.end(), frameStore.Float64(stats_x) ) ;
+    copy(snapshot.y.begin(), snapshot.y.end(), frameStore.Float64(stats_y) ) ;
+    copy(snapshot.velocity.begin(), snapshot.velocity.end(), frameStore.Float64(stats_velocity) ) ;
+    copy(snapshot.friction.begin(), snapshot.friction.end(), frameStore.Float64(stats_friction) ) ;
+    copy(snapshot.orientation.begin(), snapshot.orientation.end(), frameStore.Float64(stats_orientation) ) ;
+    copy(snapshot.oldChem.begin(), snapshot.oldChem.end(), frameStore.Float64(stats_oldChem) ) ;
+    copy(snapshot.numberReverse.begin(), snapshot.numberReverse.end(), frameStore.Int32(stats_numberReverse) ) ;
+    copy(snapshot.mode.begin(), snapshot.mode.end(), frameStore.Int32(stats_mode) ) ;
+    copy(snapshot.maxRunDuration.begin(), snapshot.maxRunDuration.end(), frameStore.Float64(stats_maxRunDuration) ) ;
+    copy(snapshot.receptorActivity.begin(), snapshot.receptorActivity.end(), frameStore.Float64(stats_receptorActivity) ) ;
+    copy(snapshot.methylation.begin(), snapshot.methylation.end(), frameStore.Float64(stats_methylation) ) ;
+    copy(snapshot.switchProbability.begin(), snapshot.switchProbability.end(), frameStore.Float64(stats_switchProbability) ) ;
+    copy(snapshot.timeToSource.begin(), snapshot.timeToSource.end(), frameStore.Float64(stats_timeToSource) ) ;
+    copy(snapshot.timeInSource.begin(), snapshot.timeInSource.end(), frameStore.Float64(stats_timeInSource) ) ;
+    frameStore.EndFrame(snapshot.statsIndex, snapshot.time) ;
+}
+//-----------------------------------------------------------------------------------------------------
+
+void TissueBacteria::Capture_Snapshot(BacteriaSnapshot & snapshot, bool withNodes)
+{
+    snapshot.hasNodes = withNodes ;
+    snapshot.switchRecord = switchRecords++ ;
+    for (uint i = 0 ; i< nbacteria; i++)
+    {
+        const MotilityMetabolism & tmpMetabolism = bacteria[i].motilityMetabolism ;
+        snapshot.maxRunDuration[i] = bacteria[i].maxRunDuration ;
+        snapshot.receptorActivity[i] = tmpMetabolism.receptorActivity ;
+        snapshot.legand[i] = tmpMetabolism.legand ;
+        snapshot.methylation[i] = tmpMetabolism.methylation ;
+        snapshot.changeRate[i] = tmpMetabolism.changeRate ;
+        snapshot.legandEnergy[i] = tmpMetabolism.LegandEnergy ;
+        snapshot.methylEnergy[i] = tmpMetabolism.MethylEnergy ;
+        snapshot.switchProbability[i] = tmpMetabolism.switchProbability ;
+        snapshot.switchMode[i] = tmpMetabolism.switchMode ;
+    }
+    if (withNodes == false)
+    {
+        return ;
+    }
+    Update_NodeLevel_ProteinConcentraion() ;
+    Bacteria_CreateDuplicate() ;
+    Bacteria_MergeWithDuplicate() ;
+    snapshot.vtkIndex = index1 ;
+    index1++ ;
+    snapshot.outputFrame = outputFrames++ ;
+    snapshot.statsIndex = index1 ;
+    snapshot.time = max(eventStep, 0L) * dt ;
+    for (uint i = 0 ; i< nbacteria; i++)
+    {
+        for (uint j = 0; j < nnode; j++)
+        {
+            snapshot.nodeX[i * nnode + j] = bacteria[i].duplicate[j].x ;
+            snapshot.nodeY[i * nnode + j] = bacteria[i].duplicate[j].y ;
+            snapshot.protein[i * nnode + j] = bacteria[i].nodes[j].protein ;
+        }
+        snapshot.x[i] = bacteria[i].nodes[(nnode-1)/2].x ;
+        snapshot.y[i] = bacteria[i].nodes[(nnode-1)/2].y ;
+        snapshot.velocity[i] = bacteria[i].locVelocity ;
+        snapshot.friction[i] = bacteria[i].locFriction ;
+        snapshot.orientation[i] = Cal_BacteriaOrientation(i) ;
+        snapshot.oldChem[i] = bacteria[i].oldChem ;
+        snapshot.numberReverse[i] = bacteria[i].numberReverse ;
+        snapshot.mode[i] = (bacteria[i].directionOfMotion ? 1 : 0) | (bacteria[i].wrapMode ? 2 : 0) | (bacteria[i].turnStatus ? 4 : 0) ;
+        snapshot.timeToSource[i] = bacteria[i].timeToSource ;
+        snapshot.timeInSource[i] = bacteria[i].timeInSource ;
+    }
+}
+//-----------------------------------------------------------------------------------------------------
+
+void TissueBacteria::Write_Snapshot(const BacteriaSnapshot & snapshot)
+{
+    long frame = snapshot.outputFrame ;
+    if (frame % vtkEvery == 0)
+    {
+        Write_SnapshotVTK(snapshot) ;
+    }
+    if (textStats && frame % statsEvery == 0)
+    {
+        Write_SnapshotTrajectory(snapshot) ;
+        Write_SnapshotStats(snapshot) ;
+    }
+    if (frame % frameStoreEvery == 0)
+    {
+        Write_SnapshotFrameStore(snapshot) ;
+    }
+    if (frame % trajectoryEvery == 0)
+    {
+        Write_SnapshotTrajectoryCodec(snapshot) ;
+    }
+    if (frame % switchEvery == 0)
+    {
+        Write_SnapshotSwitchProbabilities(snapshot) ;
+    }
+}
+//-----------------------------------------------------------------------------------------------------
+
+bool TissueBacteria::InOutputRegion(double x, double y) const
+{
+    if (outputRegionRadius <= 0.0)
+    {
+        return true ;
+    }
+    double tmpDx = x - outputRegionX ;
+    double tmpDy = y - outputRegionY ;
+    //the positions are not wrapped, so the difference can be several domains
+    if (PBC)
+    {
+        tmpDx -= domainx * round(tmpDx / domainx) ;
+        tmpDy -= domainy * round(tmpDy / domainy) ;
+    }
+    return tmpDx * tmpDx + tmpDy * tmpDy <= outputRegionRadius * outputRegionRadius ;
+}
+//-----------------------------------------------------------------------------------------------------
+
+void TissueBacteria::Log_MotilityEvent(int i, MotilityLog_Event type, double angle, double duration)
+{
+    analytics.Event(i, type, eventStep * dt, angle, duration) ;
+    if (motilityLog.IsOpen() == false)
+    {
+        return ;
+    }
+    MotilityLogRecord record ;
+    record.time = eventStep * dt ;
+    record.step = eventStep ;
+    record.bacterium = i ;
+    record.type = static_cast<uint8_t>(type) ;
+    record.thread = 0 ;
+    record.reserved = 0 ;
+    record.angle = angle ;
+    record.duration = duration ;
+    record.x = bacteria[i].nodes[(nnode-1)/2].x ;
+    record.y = bacteria[i].nodes[(nnode-1)/2].y ;
+    //same angle as Cal_BacteriaOrientation, without storing it in the bacterium
+    record.orientation = atan2(bacteria[i].nodes[0].y - bacteria[i].nodes[1].y, bacteria[i].nodes[0].x - bacteria[i].nodes[1].x) ;
+    motilityLog.Record(record) ;
+}
+//-----------------------------------------------------------------------------------------------------
+
+void TissueBacteria::Update_Analytics()
+{
+    if (analytics.IsActive() == false || eventStep % analyticsEvery != 0)
+    {
+        return ;
+    }
+    for (int i = 0; i < nbacteria; i++)
+    {
+        analyticsX[i] = bacteria[i].nodes[(nnode-1)/2].x ;
+        analyticsY[i] = bacteria[i].nodes[(nnode-1)/2].y ;
+    }
+    analytics.Sample(analyticsX.data(), analyticsY.data() ) ;
+}
+//-----------------------------------------------------------------------------------------------------
+
+void TissueBacteria::Update_CoarseField()
+{
+    if (coarseField.IsActive() == false || eventStep % coarseFieldEvery != 0)
+    {
+        return ;
+    }
+    #pragma omp parallel for
+    for (int i = 0; i < nbacteria; i++)
+    {
+        fieldX[i] = bacteria[i].nodes[(nnode-1)/2].x ;
+        fieldY[i] = bacteria[i].nodes[(nnode-1)/2].y ;
+        double ax = bacteria[i].nodes[0].x - bacteria[i].nodes[1].x ;
+        double ay = bacteria[i].nodes[0].y - bacteria[i].nodes[1].y ;
+        double length = sqrt(ax * ax + ay * ay) ;
+        fieldOrientationX[i] = length > 0.0 ? ax / length : 0.0 ;
+        fieldOrientationY[i] = length > 0.0 ? ay / length : 0.0 ;
+    }
+    coarseField.Sample(fieldX.data(), fieldY.data(), fieldOrientationX.data(), fieldOrientationY.data() ) ;
+}
+//-----------------------------------------------------------------------------------------------------
+
+void TissueBacteria::Write_Analytics()
+{
+    analytics.Write(statsFolder + animationName + "MSD.txt", statsFolder + animationName + "MotilityHistograms.txt") ;
+}
+//-----------------------------------------------------------------------------------------------------
+
+void TissueBacteria::Output_TrackedStep()
+{
+    if (trackedStore.IsOpen() == false || eventStep % trackedEvery != 0)
+    {
+        return ;
+    }
+    int32_t * id = trackedStore.Int32(tracked_id) ;
+    double * nodeX = trackedStore.Float64(tracked_nodeX) ;
+    double * nodeY = trackedStore.Float64(tracked_nodeY) ;
+    double * velocity = trackedStore.Float64(tracked_velocity) ;
+    double * friction = trackedStore.Float64(tracked_friction) ;
+    double * orientation = trackedStore.Float64(tracked_orientation) ;
+    double * oldChem = trackedStore.Float64(tracked_oldChem) ;
+    int32_t * mode = trackedStore.Int32(tracked_mode) ;
+    double * switchProbability = trackedStore.Float64(tracked_switchProbability) ;
+    for (uint m = 0; m < trackedIds.size(); m++)
+    {
+        int i = trackedIds[m] ;
+        id[m] = i ;
+        for (uint j = 0; j < nnode; j++)
+        {
+            nodeX[m * nnode + j] = bacteria[i].nodes[j].x ;
+            nodeY[m * nnode + j] = bacteria[i].nodes[j].y ;
+        }
+        velocity[m] = bacteria[i].locVelocity ;
+        friction[m] = bacteria[i].locFriction ;
+        orientation[m] = Cal_BacteriaOrientation(i) ;
+        oldChem[m] = bacteria[i].oldChem ;
+        mode[m] = (bacteria[i].directionOfMotion ? 1 : 0) | (bacteria[i].wrapMode ? 2 : 0) | (bacteria[i].turnStatus ? 4 : 0) ;
+        switchProbability[m] = bacteria[i].motilityMetabolism.switchProbability ;
+    }
+    trackedStore.EndFrame(eventStep, (eventStep + 1) * dt) ;
+}
+//-----------------------------------------------------------------------------------------------------
+
+void TissueBacteria::Write_SnapshotTrajectoryCodec(const BacteriaSnapshot & snapshot)
+{
+    if (trajectoryEncoder.IsOpen() )
+    {
+        for (uint i = 0 ; i< nbacteria; i++)
+        {
+            codecValues[2 * i] = snapshot.x[i] ;
+            codecValues[2 * i + 1] = snapshot.y[i] ;
+        }
+        trajectoryEncoder.Write(snapshot.statsIndex, snapshot.time, codecValues.data() ) ;
+    }
+    if (nodeEncoder.IsOpen() )
+    {
+        for (uint k = 0 ; k< points; k++)
+        {
+            codecValues[2 * k] = snapshot.nodeX[k] ;
+            codecValues[2 * k + 1] = snapshot.nodeY[k] ;
+        }
+        nodeEncoder.Write(snapshot.vtkIndex, snapshot.time, codecValues.data() ) ;
+    }
+}
+//-----------------------------------------------------------------------------------------------------
+
+void TissueBacteria::Start_Output()
+{
+    frameSnapshot.Resize(nbacteria, nnode) ;
+    metabolismSnapshot.Resize(nbacteria, nnode) ;
+    if (frameStoreOutput)
+    {
+        Open_FrameStore() ;
+    }
+    if (switchLogMode == switchLog_text)
+    {
+        switchLog.Open(statsFolder + "SwitchProbabilities_AllBacteria.txt", switchLogMode) ;
+    }
+    else if (switchLogMode == switchLog_binary)
+    {
+        switchLog.Open(statsFolder + "SwitchProbabilities_AllBacteria.bin", switchLogMode) ;
+    }
+    if (trackedIds.empty() == false)
+    {
+        for (int c = 0; c < numberTrackedColumns; c++)
+        {
+            trackedStore.AddColumn(trackedColumns[c].name, trackedColumns[c].type, trackedColumns[c].perNode ? nnode : 1) ;
+        }
+        trackedStore.Open(statsFolder + animationName + "Tracked.frames", static_cast<int>(trackedIds.size() ), 256) ;
+    }
+    if (motilityLogOutput)
+    {
+        motilityLog.Open(statsFolder + animationName + "MotilityEvents.bin", motilityLogRing) ;
+    }
+    if (analyticsOutput)
+    {
+        //block averages of 2 samples from one level to the next
+        analytics.Initialize(nbacteria, analyticsEvery * dt, analyticsLevels, analyticsPoints, 2) ;
+        analyticsX.resize(nbacteria) ;
+        analyticsY.resize(nbacteria) ;
+    }
+    if (coarseFieldOutput)
+    {
+        coarseField.Initialize(coarseFieldNx, coarseFieldNy, domainx, domainy, nbacteria, coarseFieldEvery * dt) ;
+        fieldX.resize(nbacteria) ;
+        fieldY.resize(nbacteria) ;
+        fieldOrientationX.resize(nbacteria) ;
+        fieldOrientationY.resize(nbacteria) ;
+    }
+    if (trajectoryCodec)
+    {
+        trajectoryEncoder.Open(statsFolder + animationName + "Trajectory.traj", nbacteria, 2, trajectoryQuantum, trajectoryKeyframes) ;
+        nodeEncoder.Open(folderName + animationName + "Nodes.traj", points, 2, trajectoryQuantum, trajectoryKeyframes) ;
+        codecValues.resize(2 * points) ;
+    }
+    if (asyncOutput)
+    {
+        snapshotWriter.Start(outputBuffers, outputBackpressure, nbacteria, nnode,
+                             [this](const BacteriaSnapshot & snapshot) { Write_Snapshot(snapshot) ; }) ;
+    }
+}
+//-----------------------------------------------------------------------------------------------------
+
+void TissueBacteria::Output_Frame()
+{
+    //the summaries are small, they are replaced at every frame so a run that stops early still has them
+    Write_Analytics() ;
+    coarseField.Write(folderName + animationName + "Field" + to_string(coarseField.framesWritten) + ".bin", max(eventStep, 0L) * dt) ;
+    BacteriaSnapshot * snapshot = &frameSnapshot ;
+    if (snapshotWriter.IsRunning() )
+    {
+        snapshot = snapshotWriter.Acquire() ;
+        if (snapshot == nullptr)
+        {
+            //dropped, the frame numbers keep counting so the files and the output cadences still match the time
+            index1++ ;
+            outputFrames++ ;
+            return ;
+        }
+    }
+    Capture_Snapshot(*snapshot, true) ;
+    if (snapshotWriter.IsRunning() )
+    {
+        snapshotWriter.Submit(snapshot) ;
+    }
+    else
+    {
+        Write_Snapshot(*snapshot) ;
+    }
+}
+//-----------------------------------------------------------------------------------------------------
+
+void TissueBacteria::Stop_Output()
+{
+    snapshotWriter.Stop() ;
+    frameStore.Close() ;
+    switchLog.Close() ;
+    if (trajectoryEncoder.IsOpen() )
+    {
+        cout<<"Trajectory files: "<<trajectoryEncoder.codedBytes + nodeEncoder.codedBytes<<" bytes for "
+            <<trajectoryEncoder.rawBytes + nodeEncoder.rawBytes<<" bytes of float64 positions"<<endl ;
+    }
+    trajectoryEncoder.Close() ;
+    nodeEncoder.Close() ;
+    trackedStore.Close() ;
+    Write_Analytics() ;
+    if (motilityLog.IsOpen() )
+    {
+        motilityLog.Close() ;
+        cout<<"Motility events: "<<motilityLog.recordsWritten<<" records in "<<motilityLog.ringFlushes<<" writes"<<endl ;
+    }
+}
+//-----------------------------------------------------------------------------------------------------
+
 void TissueBacteria::Initialize_Distributions_RNG()
 {
     std::lognormal_distribution<double> distribution(lognormal_run_m , lognormal_run_s ) ;
@@ -2682,6 +3346,20 @@ void TissueBacteria::Initialize_Distributions_RNG()
     wrapDuration_distribution = distribution2 ;
     turnAngle_distribution = distribution3 ;
     wrapAngle_distribution = distribution4 ;
+    
+    //Calibrated durations and turn angles are drawn from tables
+    runDurationTable.nIntervals = samplerTableSize ;
+    wrapDurationTable.nIntervals = samplerTableSize ;
+    turnAngleTable.nIntervals = samplerTableSize ;
+    runDurationTable.Build_TruncatedLogNormal(runDuration_mu, runDuration_sigma, runDuration_min, runDuration_max) ;
+    wrapDurationTable.Build_TruncatedLogNormal(wrapDuration_mu, wrapDuration_sigma, wrapDuration_min, wrapDuration_max) ;
+    turnAngleTable.Build_TruncatedExponential(turnAngle_rate, turnAngle_norm) ;
+    runDurationSamples.Initialize(&runDurationTable, random_runDuration, nbacteria) ;
+    wrapDurationSamples.Initialize(&wrapDurationTable, random_wrapDuration, nbacteria) ;
+    turnAngleSamples.Initialize(&turnAngleTable, random_turnAngle, nbacteria) ;
+    runDurationSamples.Refill_All(rng) ;
+    wrapDurationSamples.Refill_All(rng) ;
+    turnAngleSamples.Refill_All(rng) ;
 }
 //-----------------------------------------------------------------------------------------------------
 
@@ -2691,9 +3369,41 @@ vector<vector<double> > TissueBacteria::Find_secretion_Coord_Rate(Fungi tmpFng)
     double equiv_prodRate = 0.0 ;
     if (sourceAlongHyphae)
     {
+        //A chemo grid is a source when the hyphae pass within half a grid of it. Its rate is the one of the closest
+        //point of the closest segment ( linear along the segment, constant if p2==p1)
+        double chemoDx = domainx / tGrids.numberGridsX ;
+        double chemoDy = domainy / tGrids.numberGridsY ;
+        double searchRadius = hyphaeInnerWidth + 0.5 * sqrt(chemoDx * chemoDx + chemoDy * chemoDy) ;
+        double tmpDistance ;
+        double t ;
+        sourceChemo.assign(2, vector<double>() ) ;
+        sourceProduction.clear() ;
+        for (int i = 0; i < tGrids.numberGridsY; i++)
+        {
+            for (int j = 0; j < tGrids.numberGridsX; j++)
+            {
+                int k = hyphaeIndex.Nearest(j * chemoDx, i * chemoDy, searchRadius, tmpDistance) ;
+                if (k < 0)
+                {
+                    continue ;
+                }
+                hyphaeIndex.DistanceToSegment(k, j * chemoDx, i * chemoDy, t) ;
+                const HyphaeSegment & hy = tmpFng.hyphaeSegments.at(k) ;
+                sourceChemo.at(0).push_back(j * chemoDx) ;
+                sourceChemo.at(1).push_back(i * chemoDy) ;
+                sourceProduction.push_back(hy.p1 + (hy.p2 - hy.p1) * t) ;
+            }
+        }
+        // Total production is kept the same as spreading it over every source grid
+        if (sourceProduction.size() > 0)
+        {
+            equiv_prodRate = tmpFng.production * tmpFng.tips_Coord.at(0).size() / sourceProduction.size() ;
+        }
+        for (uint k = 0; k < sourceProduction.size(); k++)
+        {
+            sourceProduction.at(k) *= equiv_prodRate ;
+        }
         pointSources = sourceChemo ;
-        equiv_prodRate = tmpFng.production * tmpFng.tips_Coord.at(0).size() / sourceChemo.at(0).size() ;
-        transform(sourceProduction.begin(), sourceProduction.end(), sourceProduction.begin(), productNum(equiv_prodRate) ) ;
         
     }
     else
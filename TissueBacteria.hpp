@@ -5,7 +5,20 @@
 #include <stdio.h>
 #include "Bacteria.hpp"
 #include "Diffusion2D.hpp"
-#include "ranum2.h"
+#include "HyphaeSegmentIndex.hpp"
+#include "BacteriaEventQueue.hpp"
+#include "MotilityMetabolismBatch.hpp"
+#include "RandomStreams.hpp"
+#include "InverseCdfSampler.hpp"
+#include "VtkXmlFile.hpp"
+#include "FrameStore.hpp"
+#include "BacteriaOutputColumns.hpp"
+#include "SnapshotWriter.hpp"
+#include "SwitchProbabilityLog.hpp"
+#include "TrajectoryCodec.hpp"
+#include "MotilityEventLog.hpp"
+#include "MotilityAnalytics.hpp"
+#include "CoarseField.hpp"
 
 #endif /* TissueBacteria_hpp */
 
@@ -33,15 +46,88 @@ public:
     //---------------------------- Parameters and sub-classes ------------------------------
     bacterium bacteria[nbacteria];
     TissueGrid tGrids ;
+    ChemoSpeciesGrid speciesGrids ;            //used instead of the tGrids values when there are several species
+    AMRChemoGrid amrGrids ;                    //used instead of the tGrids values when tGrids.amrRefinement is on
 
     int machineID = 3 ;
     string folderName = "./animation/machine" + to_string(machineID) + "/" ;
     string statsFolder = "./dataStats/machine" + to_string(machineID) + "/" ;
     string animationName = "Bacteria_" ;
+    int vtkFormat = 1 ;                         //0: legacy ASCII .vtk, 1: XML .vtu/.vtr with binary appended data
+    bool vtkCompress = false ;
+    PvdIndex bacteriaPvd ;                      //time series of the .vtu frames
+    bool frameStoreOutput = true ;              //per-frame statistics in one columnar binary file
+    int frameStoreChunk = 16 ;                  //frames per chunk of the store
+    bool textStats = true ;                     //trajectories.txt and one stats text file per frame
+    FrameStoreWriter frameStore ;
+    //The frames are copied to snapshots and written by a writer thread. Only the writer thread touches the output files,
+    //bacteriaPvd and frameStore while it runs
+    bool asyncOutput = true ;
+    int outputBuffers = 2 ;
+    Backpressure_Mode outputBackpressure = backpressure_block ;
+    SnapshotWriter snapshotWriter ;
+    BacteriaSnapshot frameSnapshot ;            //used when the output is synchronous
+    BacteriaSnapshot metabolismSnapshot ;       //switch probabilities of the relaxation phase
+    SwitchLog_Mode switchLogMode = switchLog_text ;
+    SwitchProbabilityLog switchLog ;
+    long switchRecords = 0 ;
+    //Quantized, delta and Rice coded center and node positions ( TrajectoryCodec.hpp)
+    bool trajectoryCodec = true ;
+    double trajectoryQuantum = 0.0001 ;
+    int trajectoryKeyframes = 50 ;             //a keyframe every this many frames
+    TrajectoryEncoder trajectoryEncoder ;
+    TrajectoryEncoder nodeEncoder ;
+    vector<double> codecValues ;                //x, y interleaved, used by the writer
+    //Cadence of every output in frames, and the region of interest of the bacteria frames ( off for a radius <= 0)
+    int vtkEvery = 1 ;
+    int statsEvery = 1 ;
+    int frameStoreEvery = 1 ;
+    int trajectoryEvery = 1 ;
+    int switchEvery = 1 ;
+    long outputFrames = 0 ;
+    double outputRegionX = 500.0 ;
+    double outputRegionY = 500.0 ;
+    double outputRegionRadius = 0.0 ;
+    vector<uint> vtkNodes ;                     //nodes in the region, used by the writer
+    //Tracked bacteria, every node and state every trackedEvery steps in their own frame store
+    vector<int> trackedIds ;
+    int trackedEvery = 100 ;
+    FrameStoreWriter trackedStore ;
+    //Reversal, wrap and turn events of every bacterium ( MotilityEventLog.hpp)
+    bool motilityLogOutput = true ;
+    int motilityLogRing = 4096 ;                //records per thread before they are written
+    MotilityEventLog motilityLog ;
+    //MSD, velocity autocorrelation and event histograms of the population, sampled every analyticsEvery steps
+    bool analyticsOutput = true ;
+    int analyticsEvery = 100 ;
+    int analyticsLevels = 16 ;
+    int analyticsPoints = 16 ;
+    MotilityAnalytics analytics ;
+    vector<double> analyticsX ;
+    vector<double> analyticsY ;
+    //Density, mean velocity and polar order on a coarse grid, sampled every coarseFieldEvery steps and averaged
+    //over every frame, one binary file per frame ( CoarseField.hpp)
+    bool coarseFieldOutput = true ;
+    int coarseFieldNx = 50 ;
+    int coarseFieldNy = 50 ;
+    int coarseFieldEvery = 100 ;
+    CoarseFieldBinner coarseField ;
+    vector<double> fieldX ;
+    vector<double> fieldY ;
+    vector<double> fieldOrientationX ;
+    vector<double> fieldOrientationY ;
     
     bool inLiquid = true ;
     bool PBC = true ;
     ChemotacticMechanism chemotacticMechanism = observational ;
+    int metabolismUpdateSteps = 1000 ;      //main time steps between updates of the metabolism model
+    bool thermalNoise = true ;
+    double thermalEnergy = 0.001 ;          //kT, in the units of lj_Energy
+    vector<double> noiseU1 ;                //per node, bacterium i at i * nnode ...
+    vector<double> noiseU2 ;
+    vector<double> noiseX ;
+    vector<double> noiseY ;
+    MotilityMetabolismBatch metabolismBatch ;
     InitialCondition initialCondition = circular ;
     //Used to calibrate durations with experimental data
     bool run_calibrated = 1 ;
@@ -51,24 +137,35 @@ public:
     double lognormal_wrap_m = -0.4 ;
     double lognormal_wrap_s = 0.9 ;
     double lognormal_wrap_a = 1.0 ;
-    std::default_random_engine runDuration_seed ;
-    std::default_random_engine wrapDuration_seed ;
-    int seed = 123456789;
     std::lognormal_distribution<double> runDuration_distribution ;
     std::lognormal_distribution<double> wrapDuration_distribution ;
-    
-    std::mt19937 reversal_rng{std::random_device{}()};
-    std::uniform_real_distribution<double> unif_distribution{0.0, 1.0};
-    std::mt19937 multiplier_rng{std::random_device{}()};
-    std::uniform_int_distribution<int> unif_int_distribution{0, 1};
+    //Every random number comes from a stream of ( bacterium, eventStep, purpose)
+    RandomGenerator rng ;
+    //Calibrated run and wrap durations, truncated log-normal, and turn angles, truncated exponential.
+    //Drawn from inverse CDF tables through a small buffer of samples per bacterium
+    double runDuration_mu = .7144 ;
+    double runDuration_sigma = .7440 ;
+    double runDuration_min = 0.0 ;
+    double runDuration_max = 9.6 ;
+    double wrapDuration_mu = -.3662 ;
+    double wrapDuration_sigma = .9178 ;
+    double wrapDuration_min = 0.0 ;
+    double wrapDuration_max = 4.0 ;
+    double turnAngle_rate = 18.11 ;
+    double turnAngle_norm = 1.0017 ;
+    int samplerTableSize = 4096 ;
+    InverseCdfSampler runDurationTable ;
+    InverseCdfSampler wrapDurationTable ;
+    InverseCdfSampler turnAngleTable ;
+    SampleBuffers runDurationSamples ;
+    SampleBuffers wrapDurationSamples ;
+    SampleBuffers turnAngleSamples ;
     
     //Needed to calibrate angle distributions with experimental data.( Not calibrated)
     double normal_turnAngle_mean = 0.0 ;
     double normal_turnAngle_SDV = 3.1415/6.0 * (1.0/3.0) / ( (10.0 * 1.0) * 0.3 )  ;
     double normal_wrapAngle_mean = (3.1415/2.0)/ ( (10.0 * 1.0 ) * 0.3 ) ;
     double normal_wrapAngle_SDV = (3.1415/2.0) * (1.0/3.0) / ( (10.0 * 1.0) * 0.3 ) ; //0.3 is motorForce_Amplitude ;
-    std::default_random_engine turnAngle_seed ;
-    std::default_random_engine wrapAngle_seed ;
     std::normal_distribution<double> turnAngle_distribution ;
     std::normal_distribution<double> wrapAngle_distribution ;
 
@@ -92,7 +189,6 @@ public:
     double motorEfficiency_Agar = 0.4 ;
     
     double proteinExchangeRate = 0.3 ;       // protein exchange rate, used for Myxo study( Abu's paper)
-    long  idum = (-799);    // used for random generator in Gaussian distribution( ranum2 file)
     
     int shiftx = 0 ;        //this value changes in the MinDistance function, call MinDistance before using this value
     int shifty = 0 ;        //this value changes in the MinDistance function, call MinDistance before using this value
@@ -126,12 +222,29 @@ public:
     double Slime_CutOff = 1.3 ;                 //Threshold to decide bacteria is attached to fungi or not
     vector<vector<double> > slime ;
     vector<vector<double> > viscousDamp ;       //2D grid storing damping coefficient based on slime value
-    vector<vector<double> > chemoProfile ;      //Store chemoattractant concentration after diffusion
+    ChemoField chemoProfile ;                   //View of chemoattractant concentration after diffusion (owned by tGrids, speciesGrids or amrGrids)
     vector<vector<double> > sourceChemo ;       //store the source locations in TissueBacteria class
     vector<double> sourceProduction ;           //store the source production rate in TissueBacteria class
     bool sourceAlongHyphae = true ;
+    //Segments of the fungal network binned for point queries, built with the liquid layer. The liquid grids, the
+    //sources along the hyphae and the initial positions along the network are found from it
+    HyphaeSegmentIndex hyphaeIndex ;
+    double hyphaeBandWidth = 2.5 ;              //liquid layer around a segment
+    double hyphaeInnerWidth = 1.25 ;            //on top of the hyphae
+    double hyphaeCapRadius = 1.25 ;             //circle at the end of a segment, the inner half is on top of the hyphae
+    //Highest mark of every liquid grid ( index m * ny + n) from the rasterized network, kept so new segments only
+    //update the grids they touch
+    static const uint8_t hyphaeLayerMark = 1 ;
+    static const uint8_t onHyphaeMark = 2 ;
+    vector<uint8_t> hyphaeMark ;
 
     double turnPeriod = 0.1 ;       //duration that bacteria keep changing direction after reversal events
+    //Run end, unwrap and switch events are handled in Check_Perform_AllReversing_andWrapping and turn ends in
+    //Handle_BacteriaTurnOrientation, only for the bacteria that have an event due. eventStep counts the main time steps
+    BacteriaEventQueue motilityEvents ;
+    BacteriaEventQueue turnEvents ;
+    vector<BacteriaEvent> dueEvents ;
+    long eventStep = -1 ;
     
     double reversalRate = 1.0/ 5.0 ;    // reversal frequency, needed for uncalibrated durations
     // Bacteria won't reverse or enter to wrap mode until it stays "minimumRunTime" in the run mode
@@ -193,7 +306,7 @@ public:
     
     void Update_LJ_NodePositions () ;
     void Initialize_ReversalTimes () ;
-    vector<vector<double> > TB_Cal_ChemoDiffusion2D (double xMin, double xMax, double yMin, double yMax,int nGridX, int nGridY ,vector<vector<double> > sources, vector<double> pSource, Chemo_Profile_Type profileType) ;
+    ChemoField TB_Cal_ChemoDiffusion2D (double xMin, double xMax, double yMin, double yMax,int nGridX, int nGridY ,const vector<vector<double> > & sources, const vector<double> & pSource, Chemo_Profile_Type profileType) ;
     void Cal_AllLinearSpring_Forces() ;
     
     //Does not consider periodic boundary effect.
@@ -210,9 +323,10 @@ public:
     void Update_BacterialConnection () ;
     double Cal_AllBacteriaLJ_Forces() ;
     void PiliForce () ;
-    void TermalFluctiation_Forces() ;
+    void TermalFluctiation_Forces() ;       //random displacements xdev and ydev of all nodes
     double Update_LocalFriction (double, double ) ;
     void Update_ViscousDampingCoeff ();
+    void Update_ViscousDampingCoeff (int m, int n) ;
     
     //Apply equal force to each nodes. Direction is toward the next node.
     void Cal_MotorForce () ;
@@ -222,12 +336,19 @@ public:
     
     void Reverse_IndividualBacteriaa (int i) ;
     void Check_Perform_AllReversing_andWrapping() ;
+    //Number of steps for a timer growing by dt to reach the period ( or pass it if strict)
+    long StepsToPeriod (double period, bool strict) const ;
+    //(Re)schedule the end of the current run ( observational model) or wrap, after reversalPeriod or wrapPeriod changed
+    void Schedule_RunEnd (int i) ;
+    void Schedule_WrapEnd (int i) ;
+    //internalReversalTimer, wrapTimer and turnTimer of bacteria i at the current step, for outputs
+    void Update_EventTimers (int i) ;
     void Update_Bacteria_AllNodes () ;          //Update allNodes with nodes and ljNodes
     void Initialize_BacteriaProteinLevel () ;
     
     void Bacterial_ProteinExchange () ; //Exchange protein between bacteria in Myxo study
     void Update_NodeLevel_ProteinConcentraion () ;
-    void BacterialVisualization_ParaView () ;
+    void Write_SnapshotVTK (const BacteriaSnapshot & snapshot) ;
     void ParaView_Liquid () ;
     
     // Make a duplicate of the bacteria that are leaving the domain
@@ -254,7 +375,7 @@ public:
     double Cal_ChemoGradient2 (int i) ;     //Current working version
     
     
-    void WriteTrajectoryFile () ;
+    void Write_SnapshotTrajectory (const BacteriaSnapshot & snapshot) ;
     void WriteNumberReverse () ;
     
     //The entire hyphae width is filled with liquid. Liquid decreass with distance from hyphae
@@ -263,14 +384,45 @@ public:
     //Update the liquid concentration based on relative location with respect to fungi network
     // This function "determine" the highway for bacterial motion near fungi
     void Find_FungalNetworkTrace2 (Fungi tmpFng) ;         // bacteria follows the surrounding.
+    //Mark of any point from the segments around it ( 0, hyphaeLayerMark or onHyphaeMark), found is only a buffer
+    uint8_t HyphaeMark_AtPoint (double x, double y, vector<int> & found) const ;
+    //Mark the grids around segment k of hyphaeIndex. Grids whose mark goes up are added to touched if it is given
+    void Rasterize_HyphaeSegment (int k, vector<int> & found, vector<size_t> * touched) ;
+    void Mark_HyphaeGrid (int m, int n, uint8_t mark, vector<size_t> * touched) ;
+    //Liquid value of grid (m, n) from its mark
+    void Update_SlimeFromMark (int m, int n) ;
+    //Rasterize the grown segments and move the tip sources, without going over the whole lattice or solving again
+    void Add_FungalSegments (const Fungi & tmpFng, const vector<int> & newSegments, const vector<int> & gainedTips, const vector<int> & lostTips) ;
+    //Add a source to the solved chemo profile, only around the source
+    void Add_ChemoSource (double x, double y, double pSrc) ;
     
     //Find the coordinates and secretion rates of chemoattractant sources based on our assumption( tips vs unirform along fungi)
     vector<vector<double> > Find_secretion_Coord_Rate (Fungi tmpFng) ;
     
-    void Pass_PointSources_To_Bacteria (vector<vector<double> > sourceP) ;
+    //sourceP is shared, not copied. It has to outlive the bacteria
+    void Pass_PointSources_To_Bacteria (const vector<vector<double> > & sourceP) ;
     
     //write information of the baceria art the current time including its physical and chemical environment
-    void WriteBacteria_AllStats () ;
+    void Write_SnapshotStats (const BacteriaSnapshot & snapshot) ;
+    //Columns of the store are StatsColumn
+    void Open_FrameStore () ;
+    void Write_SnapshotFrameStore (const BacteriaSnapshot & snapshot) ;
+    void Write_SnapshotTrajectoryCodec (const BacteriaSnapshot & snapshot) ;
+    //Periodic distance to the center of the region of interest
+    bool InOutputRegion (double x, double y) const ;
+    void Output_TrackedStep () ;
+    void Log_MotilityEvent (int i, MotilityLog_Event type, double angle, double duration) ;
+    void Update_Analytics () ;
+    void Write_Analytics () ;
+    void Update_CoarseField () ;
+    //Copy the state written at a frame. withNodes false copies only the metabolism, for the switch probabilities
+    void Capture_Snapshot (BacteriaSnapshot & snapshot, bool withNodes) ;
+    //Every frame output of a snapshot, called by the writer thread when the output is asynchronous
+    void Write_Snapshot (const BacteriaSnapshot & snapshot) ;
+    //Start_Output is called once the output folders exist, Stop_Output writes the queued frames
+    void Start_Output () ;
+    void Output_Frame () ;
+    void Stop_Output () ;
     void WriteReversalDataByBacteria(int i);
     void WriteWrapDataByBacteria(int i);
     void WriteWrapDataByBacteria2(int i);
@@ -283,8 +435,11 @@ public:
     void Update_MotilityMetabolism (double tmpDt) ;
     void Update_MotilityMetabolism_Only (double tmpDt) ;
     void Update_MotilityMetabolism_Only2 (double tmpDt) ;
+    //Switch probabilities of all bacteria, nRepeat updates of tmpDt with the current legand
+    void Cal_AllSwitchProbabilities (double tmpDt, int nRepeat) ;
     void WriteSwitchProbabilities () ;
     void WriteSwitchProbabilitiesByBacteria();
+    void Write_SnapshotSwitchProbabilities (const BacteriaSnapshot & snapshot) ;
     void Update_MM_Legand () ;
 
     
@@ -1,5 +1,69 @@
 
 #include "TissueGrid.hpp"
+#include <sstream>
+
+//The explicit scheme spreads the source by one grid per step, so after nSteps steps nothing is farther than nSteps grids.
+//Beyond that the response is cut at supportLengths diffusion lengths, where it is small next to the source.
+//The quadrant is stepped on its own, the grids at -1 are the mirrors of the grids at 1
+void UnitSourceResponse::Build(double coeffX, double coeffY, double degDt, double dt, int nSteps, double supportLengths, int maxRadius)
+{
+    double diffusionLength = sqrt(4.0 * max(coeffX, coeffY) * nSteps) ;
+    radius = min(min(nSteps, maxRadius), static_cast<int>(ceil(supportLengths * diffusionLength) ) ) ;
+    radius = max(radius, min(nSteps, 1) ) ;
+    int n = radius + 1 ;
+    vector<double> tmpValue (static_cast<size_t>(n) * n, 0.0) ;
+    vector<double> tmpNext (tmpValue.size(), 0.0) ;
+    for (int l = 0; l < nSteps; l++)
+    {
+        //grids farther than l are still zero
+        int active = min(l, radius) ;
+        #pragma omp parallel for
+        for (int i = 0; i <= active; i++)
+        {
+            const double * row = &tmpValue[static_cast<size_t>(i) * n] ;
+            const double * rowUp = (i < radius) ? row + n : nullptr ;
+            const double * rowDown = &tmpValue[static_cast<size_t>(abs(i - 1) ) * n] ;
+            double * next = &tmpNext[static_cast<size_t>(i) * n] ;
+            for (int j = 0; j <= active; j++)
+            {
+                double c = row[j] ;
+                double left = row[abs(j - 1)] ;
+                double right = (j < radius) ? row[j + 1] : 0.0 ;
+                double up = (rowUp != nullptr) ? rowUp[j] : 0.0 ;
+                next[j] = c + coeffX * (left + right - 2.0 * c) + coeffY * (up + rowDown[j] - 2.0 * c) - degDt * c ;
+            }
+        }
+        tmpNext[0] += dt ;
+        tmpValue.swap(tmpNext) ;
+    }
+    value.swap(tmpValue) ;
+}
+
+void UnitSourceResponse::Clear()
+{
+    radius = -1 ;
+    vector<double>().swap(value) ;
+}
+
+void UnitSourceResponse::Images(int s, int nGrid, vector<int> & images) const
+{
+    images.clear() ;
+    int period = 2 * nGrid ;
+    int kMax = radius / period + 1 ;
+    for (int k = -kMax; k <= kMax; k++)
+    {
+        int tmpImage[2] = {s + k * period, -1 - s + k * period} ;
+        for (int a = 0; a < 2; a++)
+        {
+            if (tmpImage[a] >= -radius && tmpImage[a] <= nGrid - 1 + radius)
+            {
+                images.push_back(tmpImage[a]) ;
+            }
+        }
+    }
+}
+
+//---------------------------------------------------------------------------------------------
 
 TissueGrid::TissueGrid ()
 {
@@ -24,23 +88,17 @@ void TissueGrid::DomainBoundaries(double xMin, double xMax, double yMin, double
 
 void TissueGrid::InitializeAllGrids()
 {
-    vector<vector <Grid> > tmp (numberGridsY,vector<Grid> ( numberGridsX) ) ;
-    grids = tmp ;
+    size_t nGrids = static_cast<size_t>(numberGridsX) * numberGridsY ;
+    value.assign(nGrids, 0.0) ;
+    change.assign(nGrids, 0.0) ;
+    productionRate.assign(nGrids, 0.0) ;
     
     return ;
 }
 
 void TissueGrid::ClearChanges()
 {
-    for (int i =0; i < numberGridsY; i++)
-    {
-        for (int j = 0; j< numberGridsX ; j++)
-        {
-            
-            grids.at(i).at(j).change = 0.0 ;
-            
-        }
-    }
+    fill(change.begin(), change.end(), 0.0) ;
     return ;
 }
 
@@ -50,28 +108,31 @@ void TissueGrid::DiffusionChanges()
     
     for (int i =0; i < numberGridsY; i++)
     {
+        size_t row = static_cast<size_t>(i) * numberGridsX ;
         for (int j = 0; j< numberGridsX -1 ; j++)
         {
-            tmpChange = Diffusion * ( grids.at(i).at(j+1).value - grids.at(i).at(j).value) * grid_dt / (grid_dx * grid_dx) ;
-            grids.at(i).at(j).change += tmpChange ;
-            grids.at(i).at(j+1).change += -tmpChange ;
+            tmpChange = Diffusion * ( value[row + j + 1] - value[row + j] ) * grid_dt / (grid_dx * grid_dx) ;
+            change[row + j] += tmpChange ;
+            change[row + j + 1] += -tmpChange ;
 
         }
     }
     for (int i =0; i < numberGridsY -1; i++)
     {
+        size_t row = static_cast<size_t>(i) * numberGridsX ;
+        size_t nextRow = row + numberGridsX ;
         for (int j = 0; j< numberGridsX ; j++)
         {
-            tmpChange = Diffusion * (grids.at(i+1).at(j).value - grids.at(i).at(j).value) * grid_dt / (grid_dy * grid_dy) ;
-            grids.at(i).at(j).change += tmpChange ;
-            grids.at(i+1).at(j).change += -tmpChange ;
+            tmpChange = Diffusion * ( value[nextRow + j] - value[row + j] ) * grid_dt / (grid_dy * grid_dy) ;
+            change[row + j] += tmpChange ;
+            change[nextRow + j] += -tmpChange ;
             
         }
     }
     return ;
 }
 
-void TissueGrid::FindProductionPoints(vector<double> pSrc)
+void TissueGrid::FindProductionPoints(const vector<double> & pSrc)
 {
     int tmpIndexX ;
     int tmpIndexY ;
@@ -83,10 +144,7 @@ void TissueGrid::FindProductionPoints(vector<double> pSrc)
         tmpIndexY = fmod(tmpIndexY, numberGridsY ) ;
         
         //Based on relative distance in segment
-        grids.at(tmpIndexY).at(tmpIndexX).productionRate = pSrc.at(i) ;
-        
-        indexSourceX.push_back(tmpIndexX) ;
-        indexSourceY.push_back(tmpIndexY) ;
+        productionRate.at(static_cast<size_t>(tmpIndexY) * numberGridsX + tmpIndexX) += pSrc.at(i) ;
         
     }
     return ;
@@ -94,43 +152,28 @@ void TissueGrid::FindProductionPoints(vector<double> pSrc)
 
 void TissueGrid::ProductionChanges()
 {
-    double tmpChange ;
-    int tmpIdX ;
-    int tmpIdY ;
-    for (unsigned int i =0; i < indexSourceX.size() ; i++)
+    // productionRate is zero away from the sources
+    for (size_t k = 0; k < change.size() ; k++)
     {
-        tmpIdX = indexSourceX.at(i) ;
-        tmpIdY = indexSourceY.at(i) ;
-        
-        tmpChange = ( grids.at(tmpIdY).at(tmpIdX).productionRate) * grid_dt ;
-        grids.at(tmpIdY).at(tmpIdX).change += tmpChange ;
-        
+        change[k] += productionRate[k] * grid_dt ;
     }
     return ;
 }
 
 void TissueGrid::DegredationChanges()
 {
-    double tmpChange ;
-    for (int i =0; i < numberGridsY ; i++)
+    for (size_t k = 0; k < value.size() ; k++)
     {
-        for (int j = 0; j< numberGridsX ; j++)
-        {
-            tmpChange = - deg * (grids.at(i).at(j).value ) * grid_dt ;
-            grids.at(i).at(j).change += tmpChange ;
-            
-        }
+        change[k] += - deg * value[k] * grid_dt ;
     }
 }
 
 void TissueGrid::UpdateChanges()
 {
-    for (int i =0; i < numberGridsY ; i++)
+    for (size_t k = 0; k < value.size() ; k++)
     {
-        for (int j = 0; j< numberGridsX ; j++)
-        {
-            grids.at(i).at(j).UpdateValue() ;
-        }
+        value[k] += change[k] ;
+        change[k] = 0.0 ;
     }
     return ;
 }
@@ -149,16 +192,13 @@ void TissueGrid::EulerMethod()
         ProductionChanges() ;
         
         //Check for steady-state condition
-        for (int i=0; i< numberGridsY ; i++)
+        for (size_t k = 0; k < value.size() ; k++)
         {
-            for (int j = 0; j< numberGridsX ; j++)
+            if (change[k]/( (value[k] + smallValue) ) > smallValue * grid_dt  )
             {
-                if (grids.at(i).at(j).change/( (grids.at(i).at(j).value + smallValue) ) > smallValue * grid_dt  )
-                {
-                    status = false ;
-                    break ;
-                    
-                }
+                status = false ;
+                break ;
+                
             }
         }
         UpdateChanges() ;
@@ -172,8 +212,42 @@ void TissueGrid::EulerMethod()
     RoundToZero() ;
     ParaViewGrids(l/100) ;
     cout<<l<<endl ;
+    solvedIterations = l ;
+    unitResponse.Clear() ;
+    //The solver buffer is not needed once the profile is found
+    vector<double>().swap(change) ;
     return ;
 }
+
+void TissueGrid::AddProduction(double x, double y, double pSrc)
+{
+    if (value.empty() || pSrc == 0.0)
+    {
+        return ;
+    }
+    if (unitResponse.empty() )
+    {
+        double coeffX = Diffusion * grid_dt / (grid_dx * grid_dx) ;
+        double coeffY = Diffusion * grid_dt / (grid_dy * grid_dy) ;
+        unitResponse.Build(coeffX, coeffY, 0.0, grid_dt, solvedIterations, sourceSupport, 2 * max(numberGridsX, numberGridsY) ) ;
+    }
+    int tmpIndexX = static_cast<int>(round ( ( x - xDomainMin ) / grid_dx ) ) ;
+    tmpIndexX = fmod(tmpIndexX, numberGridsX ) ;
+    int tmpIndexY = static_cast<int>(round ( ( y - yDomainMin ) / grid_dy ) ) ;
+    tmpIndexY = fmod(tmpIndexY, numberGridsY ) ;
+    productionRate.at(static_cast<size_t>(tmpIndexY) * numberGridsX + tmpIndexX) += pSrc ;
+    
+    unitResponse.ForWindow(tmpIndexY, tmpIndexX, numberGridsX, numberGridsY, [&](int i, int j, double tmpResponse)
+    {
+        double & c = value[static_cast<size_t>(i) * numberGridsX + j] ;
+        c += pSrc * tmpResponse ;
+        if (c < pow(10, -30) )
+        {
+            c = 0.0 ;
+        }
+    }) ;
+}
+
 void TissueGrid::Create_Linear_Gradient()
 {
  
@@ -185,7 +259,7 @@ void TissueGrid::Create_Linear_Gradient()
         {
             //grids.at(j).at(i).value = grad_scale*(i); // 1D - Linear Function
             //grids.at(j).at(i).value = 180*exp((1500-sqrt(pow((j-cntrX),2.0)+pow((i-cntrY),2.0)))/200); // MWC Profile
-            grids.at(j).at(i).value = grad_scale*(sqrt(pow((cntrX),2.0)+pow((cntrY),2.0))-sqrt(pow((j-cntrX),2.0)+pow((i-cntrY),2.0))); // Radial Linear Function
+            value.at(static_cast<size_t>(j) * numberGridsX + i) = grad_scale*(sqrt(pow((cntrX),2.0)+pow((cntrY),2.0))-sqrt(pow((j-cntrX),2.0)+pow((i-cntrY),2.0))); // Radial Linear Function
             // grids.at(j).at(i).value = 1; // Constant Function
         }
     }
@@ -194,58 +268,61 @@ void TissueGrid::Create_Linear_Gradient()
 
 void TissueGrid::Create_Experimental_Gradient()
 {
-    //std::ifstream file("external_concentrations4_444444444444445_new.txt");
-    //std::ifstream file("external_concentrations40.888888888888886_new.txt");
-    //std::ifstream file("external_concentrations40.888888888888886_newflipupd.txt");
-    //std::ifstream file("external_concentrations40.888888888888886_newtrans.txt");
-    //std::ifstream file("external_concentrations40.888888888888886_fliptransup.txt");
-    //std::ifstream file("external_concentrations50.67_new.txt");
-    //std::ifstream file("external_concentrations50.67_newtrans.txt");
-    //std::ifstream file("external_concentrations50.67_fliptransup.txt");
-    //std::ifstream file("external_concentrations8.88888888888889_new.txt");
-    //std::ifstream file("external_concentrations120.88888888888889_new.txt");
-    //std::ifstream file("external_concentrations156.44444444444446_new.txt");
-    //std::ifstream file("external_concentrations_t=176000.00_new.txt");
-    //std::ifstream file("external_concentrations_t=176000.00_newflipupd.txt");
-    //std::ifstream file("/Users/austinhansen/Documents/Research/Bacterial Migration/Pseudomonas_Motility_SCE_Model/external_concentrations_t=160000.00_newtrans2.txt");
-    //std::ifstream file("/Users/austinhansen/Documents/Research/Bacterial Migration/Pseudomonas_Motility_SCE_Model/external_concentrations_t=36032.00_newtrans2_Penic_Everywhere.txt");
-    //std::ifstream file("/Users/austinhansen/Documents/Research/Bacterial Migration/Pseudomonas_Motility_SCE_Model/external_concentrations_t=36032.00_newtrans2_Penic_Everywhere_4000Grid2.txt");
-    //std::ifstream file("/Users/austinhansen/Documents/Research/Bacterial Migration/Pseudomonas_Motility_SCE_Model/external_concentrations_t=36032.00_newtrans2_Penic_Tips.txt");
-    //std::ifstream file("/Users/austinhansen/Documents/Research/Bacterial Migration/Pseudomonas_Motility_SCE_Model/external_concentrations_t=36032.00_newtrans2_Penic_Tips_4000Grid2.txt");
-    std::ifstream file("/rhome/ahans016/bigdata/Bacterial_Migration/Pseudomonas_Motility_SCE_Model_Redo_5DEF/Diffusion_Point_Source_2000Micron.txt");
-    //std::ifstream file("/rhome/ahans016/bigdata/Bacterial_Migration/Pseudomonas_Motility_SCE_Model/external_concentrations_t=36032.00_newtrans2_Penic_Everywhere.txt");
-    //std::ifstream file("/rhome/ahans016/bigdata/Bacterial_Migration/Pseudomonas_Motility_SCE_Model/external_concentrations_t=36032.00_newtrans2_Penic_Everywhere_4000Grid2.txt");
-    //std::ifstream file("/rhome/ahans016/bigdata/Bacterial_Migration/Pseudomonas_Motility_SCE_Model/external_concentrations_t=36032.00_newtrans2_Penic_Tips.txt");
-    //std::ifstream file("/rhome/ahans016/bigdata/Bacterial_Migration/Pseudomonas_Motility_SCE_Model/external_concentrations_t=36032.00_newtrans2_Penic_Tips_4000Grid2.txt");
-    //std::ifstream file("/rhome/ahans016/bigdata/Bacterial_Migration/Fungi_In_Liquid_Simulations/external_concentrations_t=160000.00_newtrans2.txt");
-    //std::ifstream file("external_concentrations_t=176000.00_fliptransup.txt");
-
-        std::vector<std::vector<double>> External_Concentration;
-        std::string line;
-        while (std::getline(file, line))
-        {
-            std::vector<double> row;
-            std::stringstream ss(line);
-            std::string value;
-            while (std::getline(ss, value, ','))
-            {
-                row.push_back(std::stod(value));
-            }
-            External_Concentration.push_back(row);
-        }
-
-            for (int i = 0; i<numberGridsY; i++)
-            {
-                for (int j=0; j< numberGridsX; j++)
-                {
-                    grids.at(j).at(i).value = External_Concentration[j][i];
-
-                }
-            }
+    if (experimentalProfile.Open(experimentalProfileFile) == false)
+    {
+        ConvertChemoProfile_CSVToBinary(experimentalProfileCSV, experimentalProfileFile) ;
+        experimentalProfile.Open(experimentalProfileFile) ;
+    }
+    if (experimentalProfile.NumberGridsX() != numberGridsX || experimentalProfile.NumberGridsY() != numberGridsY)
+    {
+        throw SceException("Experimental profile " + experimentalProfileFile + " is " + to_string(experimentalProfile.NumberGridsX() )
+                           + " x " + to_string(experimentalProfile.NumberGridsY() ) + " grids, the tissue grid is "
+                           + to_string(numberGridsX) + " x " + to_string(numberGridsY), ConfigValueException) ;
+    }
+    const float * tmpValues = experimentalProfile.Data32() ;
+    if (tmpValues != nullptr)
+    {
+        value.assign(tmpValues, tmpValues + static_cast<size_t>(numberGridsX) * numberGridsY) ;
+    }
 }
 
 void TissueGrid::ParaViewGrids(int index)
 {
+    if (vtkFormat == 1)
+    {
+        vector<float> tmpX(numberGridsX) ;
+        vector<float> tmpY(numberGridsY) ;
+        float tmpZ = 0.0f ;
+        vector<float> tmpValue(static_cast<size_t>(numberGridsX) * numberGridsY) ;
+        for (int i = 0; i < numberGridsX ; i++) {
+            tmpX[i] = i * grid_dx ;
+        }
+        for (int j = 0; j < numberGridsY; j++) {
+            tmpY[j] = j * grid_dy ;
+        }
+        ChemoField field = Profile() ;
+        size_t m = 0 ;
+        for (int j = 0; j < numberGridsY; j++) {
+            for (int i = 0; i < numberGridsX ; i++) {
+                tmpValue[m++] = field.at(j, i) ;
+            }
+        }
+        string extent = "0 " + to_string(numberGridsX - 1) + " 0 " + to_string(numberGridsY - 1) + " 0 0" ;
+        VtkXmlFile vtr (vtkCompress) ;
+        ostringstream body ;
+        body << "<Piece Extent=\"" << extent << "\">\n<PointData Scalars=\"trehalose\">\n" ;
+        body << vtr.DataArray("Float32", "trehalose", 1, tmpValue.data(), tmpValue.size() * sizeof(float) ) ;
+        body << "</PointData>\n<Coordinates>\n" ;
+        body << vtr.DataArray("Float32", "X", 1, tmpX.data(), tmpX.size() * sizeof(float) ) ;
+        body << vtr.DataArray("Float32", "Y", 1, tmpY.data(), tmpY.size() * sizeof(float) ) ;
+        body << vtr.DataArray("Float32", "Z", 1, &tmpZ, sizeof(float) ) ;
+        body << "</Coordinates>\n</Piece>\n" ;
+        string vtrFileName = folderName + "GridChem" + to_string(index) + ".vtr" ;
+        vtr.Write(vtrFileName, "RectilinearGrid", "WholeExtent=\"" + extent + "\"", body.str() ) ;
+        chemPvd.fileName = folderName + "GridChem.pvd" ;
+        chemPvd.Add(index, vtrFileName) ;
+        return ;
+    }
     string vtkFileName2 = folderName + "GridChem"+ to_string(index)+ ".vtk" ;
     ofstream SignalOut;
     SignalOut.open(vtkFileName2.c_str());
@@ -277,10 +354,11 @@ void TissueGrid::ParaViewGrids(int index)
     SignalOut << "SCALARS trehalose float 1" << endl;
     SignalOut << "LOOKUP_TABLE default" << endl;
     
+    ChemoField field = Profile() ;
     for (int k = 0; k < 1 ; k++) {
         for (int j = 0; j < numberGridsY; j++) {
             for (int i = 0; i < numberGridsX ; i++) {
-                SignalOut << grids.at(j).at(i).value << endl;
+                SignalOut << field.at(j, i) << endl;
             }
         }
     }
@@ -293,9 +371,9 @@ void TissueGrid::RoundToZero()
     {
         for (int j=0; j< numberGridsX; j++)
         {
-            if (grids.at(j).at(i).value < pow(10, -30) )
+            if (value.at(static_cast<size_t>(j) * numberGridsX + i) < pow(10, -30) )
             {
-                grids.at(j).at(i).value = 0.0 ;
+                value.at(static_cast<size_t>(j) * numberGridsX + i) = 0.0 ;
             }
         }
     }
@@ -316,7 +394,7 @@ void TissueGrid::RoundToZero()
         {
             for (int j = 0; j < numberGridsX; j++)
             {
-                outFile << grids.at(j).at(i).value;
+                outFile << value[static_cast<size_t>(j) * numberGridsX + i];
                 
                 // Add a comma separator if it's not the last element in the row
                 if (j < numberGridsX - 1) {
@@ -336,6 +414,8 @@ void TissueGrid::UpdateTGrid_FromConfigFile()
 {
     folderName = globalConfigVars.getConfigValue("AnimationFolder").toString() ;
     statsFolder = globalConfigVars.getConfigValue("StatFolderName").toString() ;
+    vtkFormat = globalConfigVars.getConfigValue("Output_VTKFormat").toInt() ;
+    vtkCompress = static_cast<bool>(globalConfigVars.getConfigValue("Output_VTKCompress").toInt() ) ;
     numberGridsX = globalConfigVars.getConfigValue("grid_NumberX").toDouble() ;
     numberGridsY = globalConfigVars.getConfigValue("grid_NumberY").toDouble() ;
     Diffusion = globalConfigVars.getConfigValue("grid_DiffusionCoeff").toDouble() ;
@@ -345,5 +425,22 @@ void TissueGrid::UpdateTGrid_FromConfigFile()
     grad_scale = globalConfigVars.getConfigValue("grad_scale").toDouble() ;
     maxIterator = globalConfigVars.getConfigValue("grid_maxIterator").toDouble() ;
     chemo_profile_type =static_cast<Chemo_Profile_Type>( globalConfigVars.getConfigValue("chemo_profile_type").toInt() ) ;
+    amrRefinement = static_cast<bool>( globalConfigVars.getConfigValue("grid_AMR").toInt() ) ;
+    amrBlockSize = globalConfigVars.getConfigValue("grid_AMR_BlockSize").toInt() ;
+    amrCoarsening = globalConfigVars.getConfigValue("grid_AMR_Coarsening").toInt() ;
+    amrRefineHalo = globalConfigVars.getConfigValue("grid_AMR_RefineHalo").toInt() ;
+    sourceSupport = globalConfigVars.getConfigValue("grid_SourceSupport").toDouble() ;
+    experimentalProfileFile = globalConfigVars.getConfigValue("grid_ExperimentalProfile").toString() ;
+    experimentalProfileCSV = globalConfigVars.getConfigValue("grid_ExperimentalProfileCSV").toString() ;
 
 }
+//---------------------------------------------------------------------------------------------
+
+ChemoField TissueGrid::Profile() const
+{
+    if (experimentalProfile.Data() != nullptr)
+    {
+        return ChemoField(experimentalProfile.Data(), numberGridsX, numberGridsY) ;
+    }
+    return ChemoField(value.data(), numberGridsX, numberGridsY) ;
+}
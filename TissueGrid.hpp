@@ -4,6 +4,8 @@
 #define TissueGrid_hpp
 
 #include "Grid.hpp"
+#include "ChemoProfileFile.hpp"
+#include "VtkXmlFile.hpp"
 
 enum Chemo_Profile_Type
 {
@@ -12,12 +14,75 @@ enum Chemo_Profile_Type
     experimental_profile = 2
 };
 
+//Profile of a unit source at grid (0, 0) after nSteps steps of the explicit scheme on an unbounded grid. It is cut at
+//radius grids from the source in each direction, and it is symmetric, so only the quadrant di, dj >= 0 is kept.
+//A source is added to a solved profile by summing the responses of the source and of its mirror images across the
+//no flux boundaries, only over the grids within radius of the source
+class UnitSourceResponse
+{
+public:
+    int radius = -1 ;
+    vector<double> value ;          //index is (|di| * (radius + 1) + |dj|)
+
+    //The support is supportLengths diffusion lengths of nSteps steps, but not more than maxRadius grids
+    void Build (double coeffX, double coeffY, double degDt, double dt, int nSteps, double supportLengths, int maxRadius) ;
+    bool empty () const { return radius < 0 ; }
+    void Clear () ;
+    double at (int di, int dj) const { return value[static_cast<size_t>(abs(di) ) * (radius + 1) + abs(dj)] ; }
+    //Calls add(i, j, response) for every grid (i, j) of a nGridX x nGridY domain within radius of the source at grid (sI, sJ)
+    template <class F>
+    void ForWindow (int sI, int sJ, int nGridX, int nGridY, F add) const ;
+
+private:
+    //The source at s and its mirror images across the boundaries at -1/2 and nGrid - 1/2 that are within radius of the domain
+    void Images (int s, int nGrid, vector<int> & images) const ;
+};
+
+template <class F>
+void UnitSourceResponse::ForWindow(int sI, int sJ, int nGridX, int nGridY, F add) const
+{
+    vector<int> imageI ;
+    vector<int> imageJ ;
+    Images(sI, nGridY, imageI) ;
+    Images(sJ, nGridX, imageJ) ;
+    int iFirst = max(sI - radius, 0) ;
+    int iLast = min(sI + radius, nGridY - 1) ;
+    int jFirst = max(sJ - radius, 0) ;
+    int jLast = min(sJ + radius, nGridX - 1) ;
+    #pragma omp parallel for
+    for (int i = iFirst; i <= iLast; i++)
+    {
+        for (int j = jFirst; j <= jLast; j++)
+        {
+            double tmpResponse = 0.0 ;
+            for (size_t a = 0; a < imageI.size(); a++)
+            {
+                if (abs(i - imageI[a]) > radius)
+                {
+                    continue ;
+                }
+                for (size_t b = 0; b < imageJ.size(); b++)
+                {
+                    if (abs(j - imageJ[b]) <= radius)
+                    {
+                        tmpResponse += at(i - imageI[a], j - imageJ[b]) ;
+                    }
+                }
+            }
+            add(i, j, tmpResponse) ;
+        }
+    }
+}
+
 class TissueGrid
 {
 public:
     //---------------------------- Parameters and sub-classes ------------------------------
     TissueGrid () ;
-    vector< vector<Grid> > grids ;
+    //Row-major storage of the grids, index is (i * numberGridsX + j) for row i (y) and column j (x)
+    vector<double> value ;
+    vector<double> change ;             //Only needed while solving, released after EulerMethod
+    vector<double> productionRate ;
     //Size of grif and domain for solving diffusion of the chemical
     double xDomainMin = 0 ;
     double xDomainMax = 100 ;
@@ -35,18 +100,33 @@ public:
     double grid_dt = 0.05 ;      //timeStep
     double grad_scale = 1;  //Controls steepnes of Gradient
     int maxIterator = 100 ;
+    int solvedIterations = 0 ;          //Euler steps taken by the last EulerMethod
+    double sourceSupport = 2.0 ;        //radius of the unit response in diffusion lengths ( see AddProduction)
+    //Response of a unit source after solvedIterations steps, so sources can be added to a solved profile
+    UnitSourceResponse unitResponse ;
+    
+    //Block refinement of the production profile ( see AMRChemoGrid)
+    bool amrRefinement = false ;
+    int amrBlockSize = 16 ;         //number of grids along each side of a block
+    int amrCoarsening = 4 ;         //far field grid is amrCoarsening times coarser
+    int amrRefineHalo = 1 ;         //number of blocks refined around the blocks containing a source
+    
+    //Experimental profile, memory mapped from the binary file. The CSV is converted once if the binary file is missing
+    string experimentalProfileFile ;
+    string experimentalProfileCSV ;
+    MappedChemoProfile experimentalProfile ;
     
     //List of source's coordinates
     vector<double> xSources ;
     vector<double> ySources ;
-    //List of grid index of the sources
-    vector<int> indexSourceX ;
-    vector<int> indexSourceY ;
     Chemo_Profile_Type chemo_profile_type = production_profile ;
 
     int machineID = 1  ;
     string folderName = "./animation/machine" + to_string(machineID) + "/" ;
     string statsFolder = "./dataStats/machine" + to_string(machineID) + "/" ;
+    int vtkFormat = 1 ;                         //0: legacy ASCII .vtk, 1: XML .vtr with binary appended data
+    bool vtkCompress = false ;
+    PvdIndex chemPvd ;
     
     //---------------------------- Functions --------------------------------------------
     
@@ -57,9 +137,9 @@ public:
     void ClearChanges () ;
     //Calculate the changes due to diffusion
     void DiffusionChanges () ;
-    // Find the grids that are meant to be a source
-    void FindProductionPoints (vector<double> pSrc) ;
-    //Calculate the changes due to production
+    // Find the grids that are meant to be a source. Sources sharing a grid add up their rates
+    void FindProductionPoints (const vector<double> & pSrc) ;
+    //Calculate the changes due to production (one pass over productionRate)
     void ProductionChanges () ;
     //Calculate the changes due to degradation over time( propertion to the concentration)
     void DegredationChanges () ;
@@ -67,9 +147,13 @@ public:
     void UpdateChanges () ;
     //Solve diffusion equation using Euler method.
     void EulerMethod () ;
+    //Add a source ( or remove it with a negative rate) to the solved profile without solving again.
+    //The equation is linear, so the change is the unit response of the source scaled by its rate. Only the grids
+    //within the support of the response are updated
+    void AddProduction (double x, double y, double pSrc) ;
     //Create a Linear gradient from the center based on an equation
     void Create_Linear_Gradient () ;
-    //Use Chemoattractant profile from experiment
+    //Use Chemoattractant profile from experiment. A float64 profile is used in place of value
     void Create_Experimental_Gradient () ;
     //Visualize the chemical concentration using the grids
     void ParaViewGrids (int) ;
@@ -77,6 +161,8 @@ public:
     void RoundToZero () ;
     //Update parameters based on input file
     void UpdateTGrid_FromConfigFile () ;
+    //Read-only view of the concentration, used by the bacteria without copying the grids
+    ChemoField Profile () const ;
     
     
 };
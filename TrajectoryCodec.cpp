@@ -0,0 +1,410 @@
+#include "TrajectoryCodec.hpp"
+#include <cmath>
+#include <cstring>
+#include <iostream>
+
+static const char trajectoryMagic[8] = {'T','R','A','J','C','O','D','E'} ;
+static const uint32_t trajectoryVersion = 1 ;
+//A quotient this long is replaced by the escape code and the 64 bits of the value
+static const uint32_t maxUnary = 32 ;
+
+//---------------------------------------------------------------------------------------------
+
+//Bits are packed from the least significant bit of every byte
+class BitWriter
+{
+public:
+    BitWriter (vector<uint8_t> & tmpOut) : out(tmpOut) { out.clear() ; }
+    void Put (uint64_t value, int nBits)
+    {
+        while (nBits > 0)
+        {
+            int take = min(nBits, 64 - used) ;
+            uint64_t mask = take == 64 ? ~0ull : ( (1ull << take) - 1) ;
+            accumulator |= (value & mask) << used ;
+            used += take ;
+            nBits -= take ;
+            value = take == 64 ? 0 : value >> take ;
+            if (used == 64)
+            {
+                Spill() ;
+            }
+        }
+    }
+    void Ones (uint32_t n)
+    {
+        for ( ; n >= 32; n -= 32)
+        {
+            Put(0xffffffffull, 32) ;
+        }
+        Put( (1ull << n) - 1, n) ;
+    }
+    void Finish ()
+    {
+        while (used > 0)
+        {
+            out.push_back(static_cast<uint8_t>(accumulator) ) ;
+            accumulator >>= 8 ;
+            used = max(used - 8, 0) ;
+        }
+    }
+
+private:
+    void Spill ()
+    {
+        for (int b = 0; b < 8; b++)
+        {
+            out.push_back(static_cast<uint8_t>(accumulator >> (8 * b) ) ) ;
+        }
+        accumulator = 0 ;
+        used = 0 ;
+    }
+    vector<uint8_t> & out ;
+    uint64_t accumulator = 0 ;
+    int used = 0 ;
+};
+
+//---------------------------------------------------------------------------------------------
+
+class BitReader
+{
+public:
+    BitReader (const uint8_t * tmpData, size_t tmpBytes) : data(tmpData), bytes(tmpBytes) {}
+    uint64_t Get (int nBits)
+    {
+        uint64_t value = 0 ;
+        int done = 0 ;
+        while (done < nBits)
+        {
+            if (available == 0)
+            {
+                Refill() ;
+            }
+            int take = min(nBits - done, available) ;
+            uint64_t mask = take == 64 ? ~0ull : ( (1ull << take) - 1) ;
+            value |= (accumulator & mask) << done ;
+            accumulator = take == 64 ? 0 : accumulator >> take ;
+            available -= take ;
+            done += take ;
+        }
+        return value ;
+    }
+    //Number of 1 bits before the next 0 bit, which is consumed, or limit 1 bits
+    uint32_t Unary (uint32_t limit)
+    {
+        uint32_t n = 0 ;
+        while (n < limit)
+        {
+            if (available == 0)
+            {
+                Refill() ;
+            }
+            int run = ~accumulator == 0 ? 64 : __builtin_ctzll(~accumulator) ;
+            run = static_cast<int>(min<uint64_t>(min(run, available), limit - n) ) ;
+            Skip(run) ;
+            n += run ;
+            if (n < limit && available > 0)
+            {
+                Skip(1) ;
+                return n ;
+            }
+        }
+        return n ;
+    }
+
+private:
+    void Skip (int nBits)
+    {
+        accumulator = nBits == 64 ? 0 : accumulator >> nBits ;
+        available -= nBits ;
+    }
+    void Refill ()
+    {
+        accumulator = 0 ;
+        available = 0 ;
+        for ( ; available < 64 && position < bytes; available += 8)
+        {
+            accumulator |= static_cast<uint64_t>(data[position++]) << available ;
+        }
+        if (available == 0)
+        {
+            throw SceException("Trajectory frame is shorter than its values", ConfigValueException) ;
+        }
+    }
+    const uint8_t * data ;
+    size_t bytes ;
+    size_t position = 0 ;
+    uint64_t accumulator = 0 ;
+    int available = 0 ;
+};
+
+//---------------------------------------------------------------------------------------------
+
+static uint64_t ZigZag(int64_t value)
+{
+    return (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63) ;
+}
+
+static int64_t UnZigZag(uint64_t value)
+{
+    return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1) ;
+}
+
+//---------------------------------------------------------------------------------------------
+
+TrajectoryEncoder::TrajectoryEncoder ()
+{
+}
+
+//---------------------------------------------------------------------------------------------
+
+TrajectoryEncoder::~TrajectoryEncoder ()
+{
+    Close() ;
+}
+
+//---------------------------------------------------------------------------------------------
+
+void TrajectoryEncoder::Open(const string & fileName, uint64_t nPoints, int nComponents, double quantum, int keyframeInterval)
+{
+    Close() ;
+    memset(&header, 0, sizeof(header) ) ;
+    memcpy(header.magic, trajectoryMagic, sizeof(trajectoryMagic) ) ;
+    header.version = trajectoryVersion ;
+    header.nComponents = nComponents ;
+    header.nPoints = nPoints ;
+    header.quantum = quantum ;
+    header.keyframeInterval = max(keyframeInterval, 1) ;
+    file = fopen(fileName.c_str(), "wb") ;
+    if (file == nullptr)
+    {
+        cout<<"Could not open trajectory file "<<fileName<<endl ;
+        return ;
+    }
+    fwrite(&header, sizeof(header), 1, file) ;
+    previous.assign(nPoints * nComponents, 0) ;
+    beforePrevious.assign(nPoints * nComponents, 0) ;
+    residuals.resize(nPoints * nComponents) ;
+    nFrames = 0 ;
+    rawBytes = 0 ;
+    codedBytes = sizeof(header) ;
+}
+
+//---------------------------------------------------------------------------------------------
+
+void TrajectoryEncoder::Write(long frame, double time, const double * values)
+{
+    if (IsOpen() == false)
+    {
+        return ;
+    }
+    long sinceKeyframe = nFrames % header.keyframeInterval ;
+    int predictor = static_cast<int>(min(sinceKeyframe, 2L) ) ;
+    bool keyframe = predictor == 0 ;
+    size_t nValues = residuals.size() ;
+    double inverseQuantum = 1.0 / header.quantum ;
+    uint64_t sum = 0 ;
+    for (size_t k = 0; k < nValues; k++)
+    {
+        int64_t quantized = llround(values[k] * inverseQuantum) ;
+        int64_t predicted = predictor == 0 ? 0 : (predictor == 1 ? previous[k] : 2 * previous[k] - beforePrevious[k]) ;
+        residuals[k] = ZigZag(quantized - predicted) ;
+        beforePrevious[k] = previous[k] ;
+        previous[k] = quantized ;
+        sum += min(residuals[k], static_cast<uint64_t>(1) << 40) ;
+    }
+    //The mean is pulled up by the few bacteria that cross the periodic boundary, so the parameters below the one
+    //from the mean are tried too
+    uint64_t mean = nValues > 0 ? sum / nValues : 0 ;
+    int meanParameter = 0 ;
+    while (meanParameter < 62 && (static_cast<uint64_t>(2) << meanParameter) <= mean)
+    {
+        meanParameter++ ;
+    }
+    int riceParameter = meanParameter ;
+    uint64_t fewestBits = ~0ull ;
+    for (int candidate = max(meanParameter - 6, 0); candidate <= meanParameter; candidate++)
+    {
+        uint64_t nBits = 0 ;
+        for (size_t k = 0; k < nValues; k++)
+        {
+            uint64_t quotient = residuals[k] >> candidate ;
+            nBits += quotient < maxUnary ? quotient + 1 + candidate : maxUnary + 64 ;
+        }
+        if (nBits < fewestBits)
+        {
+            fewestBits = nBits ;
+            riceParameter = candidate ;
+        }
+    }
+    BitWriter bits (payload) ;
+    for (size_t k = 0; k < nValues; k++)
+    {
+        uint64_t quotient = residuals[k] >> riceParameter ;
+        if (quotient < maxUnary)
+        {
+            bits.Ones(static_cast<uint32_t>(quotient) ) ;
+            bits.Put(0, 1) ;
+            bits.Put(residuals[k], riceParameter) ;
+        }
+        else
+        {
+            bits.Ones(maxUnary) ;
+            bits.Put(residuals[k], 64) ;
+        }
+    }
+    bits.Finish() ;
+
+    TrajectoryFrameHeader frameHeader ;
+    memset(&frameHeader, 0, sizeof(frameHeader) ) ;
+    frameHeader.payloadBytes = static_cast<uint32_t>(payload.size() ) ;
+    frameHeader.keyframe = keyframe ? 1 : 0 ;
+    frameHeader.riceParameter = static_cast<uint8_t>(riceParameter) ;
+    frameHeader.predictor = static_cast<uint8_t>(predictor) ;
+    frameHeader.frame = frame ;
+    frameHeader.time = time ;
+    fwrite(&frameHeader, sizeof(frameHeader), 1, file) ;
+    fwrite(payload.data(), 1, payload.size(), file) ;
+    nFrames++ ;
+    rawBytes += nValues * sizeof(double) ;
+    codedBytes += sizeof(frameHeader) + payload.size() ;
+}
+
+//---------------------------------------------------------------------------------------------
+
+void TrajectoryEncoder::Close()
+{
+    if (file == nullptr)
+    {
+        return ;
+    }
+    fclose(file) ;
+    file = nullptr ;
+}
+
+//---------------------------------------------------------------------------------------------
+
+TrajectoryDecoder::TrajectoryDecoder ()
+{
+}
+
+//---------------------------------------------------------------------------------------------
+
+TrajectoryDecoder::~TrajectoryDecoder ()
+{
+    Close() ;
+}
+
+//---------------------------------------------------------------------------------------------
+
+bool TrajectoryDecoder::Open(const string & fileName)
+{
+    Close() ;
+    file = fopen(fileName.c_str(), "rb") ;
+    if (file == nullptr)
+    {
+        return false ;
+    }
+    if (fread(&header, sizeof(header), 1, file) != 1 || memcmp(header.magic, trajectoryMagic, sizeof(trajectoryMagic) ) != 0
+        || header.version != trajectoryVersion)
+    {
+        Close() ;
+        throw SceException("Not a trajectory file: " + fileName, ConfigValueException) ;
+    }
+    //Only the frame headers are read, a frame cut short by the end of a run is left out
+    offsets.clear() ;
+    frames.clear() ;
+    fseeko(file, 0, SEEK_END) ;
+    uint64_t fileBytes = static_cast<uint64_t>(ftello(file) ) ;
+    uint64_t offset = sizeof(header) ;
+    TrajectoryFrameHeader frameHeader ;
+    while (offset + sizeof(frameHeader) <= fileBytes)
+    {
+        fseeko(file, static_cast<off_t>(offset), SEEK_SET) ;
+        if (fread(&frameHeader, sizeof(frameHeader), 1, file) != 1
+            || offset + sizeof(frameHeader) + frameHeader.payloadBytes > fileBytes)
+        {
+            break ;
+        }
+        offsets.push_back(offset) ;
+        frames.push_back(frameHeader) ;
+        offset += sizeof(frameHeader) + frameHeader.payloadBytes ;
+    }
+    current.assign(NumberValues(), 0) ;
+    previous.assign(NumberValues(), 0) ;
+    currentFrame = -1 ;
+    return true ;
+}
+
+//---------------------------------------------------------------------------------------------
+
+void TrajectoryDecoder::DecodeFrame(long k)
+{
+    const TrajectoryFrameHeader & frameHeader = frames[k] ;
+    payload.resize(frameHeader.payloadBytes) ;
+    fseeko(file, static_cast<off_t>(offsets[k] + sizeof(TrajectoryFrameHeader) ), SEEK_SET) ;
+    if (fread(payload.data(), 1, payload.size(), file) != payload.size() )
+    {
+        throw SceException("Could not read trajectory frame " + to_string(k), ConfigValueException) ;
+    }
+    BitReader bits (payload.data(), payload.size() ) ;
+    int riceParameter = frameHeader.riceParameter ;
+    for (size_t m = 0; m < current.size(); m++)
+    {
+        uint32_t quotient = bits.Unary(maxUnary) ;
+        uint64_t residual ;
+        if (quotient < maxUnary)
+        {
+            residual = (static_cast<uint64_t>(quotient) << riceParameter) | bits.Get(riceParameter) ;
+        }
+        else
+        {
+            residual = bits.Get(64) ;
+        }
+        int64_t predicted = frameHeader.predictor == 0 ? 0 :
+                            (frameHeader.predictor == 1 ? current[m] : 2 * current[m] - previous[m]) ;
+        previous[m] = current[m] ;
+        current[m] = predicted + UnZigZag(residual) ;
+    }
+    currentFrame = k ;
+}
+
+//---------------------------------------------------------------------------------------------
+
+void TrajectoryDecoder::Read(long k, vector<double> & values)
+{
+    if (k < 0 || k >= NumberFrames() )
+    {
+        throw SceException("Trajectory frame " + to_string(k) + " is not in the file", ConfigValueException) ;
+    }
+    long start = k ;
+    while (frames[start].keyframe == 0 && start > 0)
+    {
+        start-- ;
+    }
+    if (currentFrame >= start && currentFrame <= k)
+    {
+        start = currentFrame + 1 ;
+    }
+    for (long m = start; m <= k; m++)
+    {
+        DecodeFrame(m) ;
+    }
+    values.resize(current.size() ) ;
+    for (size_t m = 0; m < current.size(); m++)
+    {
+        values[m] = current[m] * header.quantum ;
+    }
+}
+
+//---------------------------------------------------------------------------------------------
+
+void TrajectoryDecoder::Close()
+{
+    if (file != nullptr)
+    {
+        fclose(file) ;
+        file = nullptr ;
+    }
+    currentFrame = -1 ;
+}
@@ -0,0 +1,97 @@
+#ifndef TrajectoryCodec_hpp
+#define TrajectoryCodec_hpp
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include "commonData.h"
+
+using namespace std ;
+
+//Compressed trajectories. Every value is quantized to a multiple of quantum, so decoding gives back exactly
+//round(value / quantum) * quantum. A frame stores the difference to the value predicted from the previous frames:
+//the previous value for the frame after a keyframe, then the linear extrapolation of the last two frames, since the
+//bacteria move at a nearly constant velocity between frames. A keyframe every keyframeInterval frames stores the
+//values themselves, so reading any frame starts at the keyframe before it. The zigzag mapped differences are Rice
+//coded with the parameter of the frame that gives the fewest bits.
+//
+//File: TrajectoryCodecHeader, then for every frame a TrajectoryFrameHeader and payloadBytes of coded values
+struct TrajectoryCodecHeader
+{
+    char magic[8] ;                 //"TRAJCODE"
+    uint32_t version ;
+    uint32_t nComponents ;          //values of a point, interleaved
+    uint64_t nPoints ;
+    double quantum ;
+    uint32_t keyframeInterval ;
+    uint32_t reserved ;
+};
+
+struct TrajectoryFrameHeader
+{
+    uint32_t payloadBytes ;
+    uint8_t keyframe ;
+    uint8_t riceParameter ;
+    uint8_t predictor ;             //0 none ( keyframe), 1 previous frame, 2 linear from the last two frames
+    uint8_t reserved ;
+    int64_t frame ;
+    double time ;
+};
+
+class TrajectoryEncoder
+{
+public:
+    //---------------------------- Parameters and sub-classes ------------------------------
+    TrajectoryEncoder () ;
+    ~TrajectoryEncoder () ;
+    uint64_t rawBytes = 0 ;         //bytes of the values as float64
+    uint64_t codedBytes = 0 ;       //bytes written
+
+    //---------------------------- Functions --------------------------------------------
+    void Open (const string & fileName, uint64_t nPoints, int nComponents, double quantum, int keyframeInterval) ;
+    bool IsOpen () const { return file != nullptr ; }
+    //nPoints * nComponents values
+    void Write (long frame, double time, const double * values) ;
+    void Close () ;
+
+private:
+    TrajectoryCodecHeader header ;
+    FILE * file = nullptr ;
+    long nFrames = 0 ;
+    vector<int64_t> previous ;
+    vector<int64_t> beforePrevious ;
+    vector<uint64_t> residuals ;
+    vector<uint8_t> payload ;
+};
+
+class TrajectoryDecoder
+{
+public:
+    //---------------------------- Parameters and sub-classes ------------------------------
+    TrajectoryDecoder () ;
+    ~TrajectoryDecoder () ;
+    TrajectoryCodecHeader header ;
+
+    //---------------------------- Functions --------------------------------------------
+    //Returns false if the file does not exist, throws if it is not a trajectory file
+    bool Open (const string & fileName) ;
+    long NumberFrames () const { return static_cast<long>(offsets.size() ) ; }
+    uint64_t NumberValues () const { return header.nPoints * header.nComponents ; }
+    const TrajectoryFrameHeader & Frame (long k) const { return frames[k] ; }
+    //Frame k, decoded from the keyframe before it unless k follows the last frame read
+    void Read (long k, vector<double> & values) ;
+    void Close () ;
+
+private:
+    void DecodeFrame (long k) ;
+    FILE * file = nullptr ;
+    vector<uint64_t> offsets ;      //file offset of every frame header
+    vector<TrajectoryFrameHeader> frames ;
+    vector<int64_t> current ;
+    vector<int64_t> previous ;
+    long currentFrame = -1 ;
+    vector<uint8_t> payload ;
+};
+
+#endif /* TrajectoryCodec_hpp */
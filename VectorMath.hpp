@@ -0,0 +1,127 @@
+#ifndef VectorMath_hpp
+#define VectorMath_hpp
+
+#include <cstdint>
+#include <cstring>
+
+//exp, log, sin and cos without library calls or branches, so loops over them vectorize. All are within a few ulp of the
+//library functions. The integer part is moved through the bits of a double ( 1.5 * 2^52 trick), which needs only
+//64-bit integer adds and shifts.
+namespace VectorMath
+{
+    const double roundingShift = 6755399441055744.0 ;      //1.5 * 2^52
+
+    inline double AsDouble (uint64_t bits)
+    {
+        double tmp ;
+        memcpy(&tmp, &bits, sizeof(tmp) ) ;
+        return tmp ;
+    }
+
+    inline uint64_t AsBits (double x)
+    {
+        uint64_t tmp ;
+        memcpy(&tmp, &x, sizeof(tmp) ) ;
+        return tmp ;
+    }
+
+    //exp(x) = 2^k exp(r) with |r| <= ln2 / 2. 2^k is clamped to [2^-1022, 2^1023].
+    //The clamp is on the integer k: a select on doubles does not vectorize under the default trapping math
+    inline double Exp (double x)
+    {
+        double shifted = x * 1.4426950408889634 + roundingShift ;
+        double k = shifted - roundingShift ;
+        double r = x - k * 6.93147180369123816490e-01 - k * 1.90821492927058770002e-10 ;
+        double p = 1.0 / 6227020800.0 ;
+        p = p * r + 1.0 / 479001600.0 ;
+        p = p * r + 1.0 / 39916800.0 ;
+        p = p * r + 1.0 / 3628800.0 ;
+        p = p * r + 1.0 / 362880.0 ;
+        p = p * r + 1.0 / 40320.0 ;
+        p = p * r + 1.0 / 5040.0 ;
+        p = p * r + 1.0 / 720.0 ;
+        p = p * r + 1.0 / 120.0 ;
+        p = p * r + 1.0 / 24.0 ;
+        p = p * r + 1.0 / 6.0 ;
+        p = p * r + 0.5 ;
+        p = p * r + 1.0 ;
+        p = p * r + 1.0 ;
+        int32_t intK = static_cast<int32_t>(AsBits(shifted) - AsBits(roundingShift) ) ;
+        intK = intK < -1022 ? -1022 : (intK > 1023 ? 1023 : intK) ;
+        return p * AsDouble(static_cast<uint64_t>(intK + 1023) << 52) ;
+    }
+
+    //log(x) = e ln2 + log(m) with sqrt(1/2) <= m < sqrt(2), and log(m) = 2 atanh((m - 1) / (m + 1)). x has to be positive and normal
+    inline double Log (double x)
+    {
+        uint64_t bits = AsBits(x) ;
+        uint64_t mantissa = bits & 0x000fffffffffffffULL ;
+        //1 if the mantissa is at least sqrt(2), found with an add instead of a compare
+        uint64_t large = (mantissa + ( (1ULL << 52) - 0x6a09e667f3bcdULL) ) >> 52 ;
+        uint64_t exponent = ( (bits >> 52) & 0x7ff) + large ;
+        double m = AsDouble( (mantissa | 0x3ff0000000000000ULL) - (large << 52) ) ;
+        double e = AsDouble(AsBits(roundingShift) + exponent - 1023) - roundingShift ;
+        double s = (m - 1.0) / (m + 1.0) ;
+        double s2 = s * s ;
+        double p = 1.0 / 23.0 ;
+        p = p * s2 + 1.0 / 21.0 ;
+        p = p * s2 + 1.0 / 19.0 ;
+        p = p * s2 + 1.0 / 17.0 ;
+        p = p * s2 + 1.0 / 15.0 ;
+        p = p * s2 + 1.0 / 13.0 ;
+        p = p * s2 + 1.0 / 11.0 ;
+        p = p * s2 + 1.0 / 9.0 ;
+        p = p * s2 + 1.0 / 7.0 ;
+        p = p * s2 + 1.0 / 5.0 ;
+        p = p * s2 + 1.0 / 3.0 ;
+        p = p * s2 + 1.0 ;
+        return e * 6.93147180369123816490e-01 + (2.0 * s * p + e * 1.90821492927058770002e-10) ;
+    }
+
+    //sqrt(x) = x / sqrt(x), with 1 / sqrt(x) from the bits of x and four Newton steps. x has to be positive and normal.
+    //The library sqrt keeps a call for errno, which stops vectorization
+    inline double Sqrt (double x)
+    {
+        double y = AsDouble(0x5fe6eb50c7b537a9ULL - (AsBits(x) >> 1) ) ;
+        double halfX = 0.5 * x ;
+        y = y * (1.5 - halfX * y * y) ;
+        y = y * (1.5 - halfX * y * y) ;
+        y = y * (1.5 - halfX * y * y) ;
+        y = y * (1.5 - halfX * y * y) ;
+        return x * y ;
+    }
+
+    //sin and cos of 2 pi v for v in [0, 1). With t = 2 v - 1, x = pi t / 2 is in [-pi/2, pi/2) where the series converge
+    //fast, and the double angle gives sin(pi t) and cos(pi t) = -sin(2 pi v) and -cos(2 pi v)
+    inline void SinCosTwoPi (double v, double & sinValue, double & cosValue)
+    {
+        double x = (2.0 * v - 1.0) * 1.5707963267948966 ;
+        double x2 = x * x ;
+        double s = 1.0 / 51090942171709440000.0 ;
+        s = s * x2 - 1.0 / 121645100408832000.0 ;
+        s = s * x2 + 1.0 / 355687428096000.0 ;
+        s = s * x2 - 1.0 / 1307674368000.0 ;
+        s = s * x2 + 1.0 / 6227020800.0 ;
+        s = s * x2 - 1.0 / 39916800.0 ;
+        s = s * x2 + 1.0 / 362880.0 ;
+        s = s * x2 - 1.0 / 5040.0 ;
+        s = s * x2 + 1.0 / 120.0 ;
+        s = s * x2 - 1.0 / 6.0 ;
+        s = x + x * x2 * s ;
+        double c = 1.0 / 2432902008176640000.0 ;
+        c = c * x2 - 1.0 / 6402373705728000.0 ;
+        c = c * x2 + 1.0 / 20922789888000.0 ;
+        c = c * x2 - 1.0 / 87178291200.0 ;
+        c = c * x2 + 1.0 / 479001600.0 ;
+        c = c * x2 - 1.0 / 3628800.0 ;
+        c = c * x2 + 1.0 / 40320.0 ;
+        c = c * x2 - 1.0 / 720.0 ;
+        c = c * x2 + 1.0 / 24.0 ;
+        c = c * x2 - 0.5 ;
+        c = 1.0 + x2 * c ;
+        sinValue = -2.0 * s * c ;
+        cosValue = 2.0 * s * s - 1.0 ;
+    }
+}
+
+#endif /* VectorMath_hpp */
@@ -0,0 +1,169 @@
+#include "VtkXmlFile.hpp"
+#include <iostream>
+#include <sstream>
+#include <cstring>
+#ifdef VTK_ZLIB
+#include <zlib.h>
+#endif
+
+VtkXmlFile::VtkXmlFile (bool tmpCompress)
+{
+#ifdef VTK_ZLIB
+    compress = tmpCompress ;
+#else
+    if (tmpCompress)
+    {
+        cout<<"VTK output is not compressed, the code was built without VTK_ZLIB"<<endl ;
+    }
+    compress = false ;
+#endif
+}
+
+//---------------------------------------------------------------------------------------------
+
+string VtkXmlFile::DataArray(const string & type, const string & name, int nComponents, const void * data, size_t nBytes)
+{
+    size_t offset = appended.size() ;
+    if (compress)
+    {
+        AppendCompressed(data, nBytes) ;
+    }
+    else
+    {
+        AppendRaw(data, nBytes) ;
+    }
+    ostringstream element ;
+    element << "<DataArray type=\"" << type << "\"" ;
+    if (name.empty() == false)
+    {
+        element << " Name=\"" << name << "\"" ;
+    }
+    element << " NumberOfComponents=\"" << nComponents << "\" format=\"appended\" offset=\"" << offset << "\"/>\n" ;
+    return element.str() ;
+}
+
+//---------------------------------------------------------------------------------------------
+
+//UInt64 byte count, then the data
+void VtkXmlFile::AppendRaw(const void * data, size_t nBytes)
+{
+    uint64_t header = nBytes ;
+    size_t start = appended.size() ;
+    appended.resize(start + sizeof(header) + nBytes) ;
+    memcpy(&appended[start], &header, sizeof(header) ) ;
+    if (nBytes > 0)
+    {
+        memcpy(&appended[start + sizeof(header)], data, nBytes) ;
+    }
+}
+
+//---------------------------------------------------------------------------------------------
+
+//Number of blocks, block size, size of the last block ( 0 if it is full) and the compressed size of every block,
+//all UInt64, then the compressed blocks
+void VtkXmlFile::AppendCompressed(const void * data, size_t nBytes)
+{
+#ifdef VTK_ZLIB
+    size_t nBlocks = (nBytes + blockSize - 1) / blockSize ;
+    vector<uint64_t> header(3 + nBlocks) ;
+    header[0] = nBlocks ;
+    header[1] = blockSize ;
+    header[2] = nBytes % blockSize ;
+    size_t headerStart = appended.size() ;
+    appended.resize(headerStart + header.size() * sizeof(uint64_t) ) ;
+    const Bytef * source = static_cast<const Bytef *>(data) ;
+    for (size_t b = 0; b < nBlocks; b++)
+    {
+        uLong sourceSize = static_cast<uLong>(min(header[1], static_cast<uint64_t>(nBytes - b * blockSize) ) ) ;
+        uLongf compressedSize = compressBound(sourceSize) ;
+        size_t start = appended.size() ;
+        appended.resize(start + compressedSize) ;
+        compress2(reinterpret_cast<Bytef *>(&appended[start]), &compressedSize, source + b * blockSize, sourceSize, Z_BEST_SPEED) ;
+        appended.resize(start + compressedSize) ;
+        header[3 + b] = compressedSize ;
+    }
+    memcpy(&appended[headerStart], header.data(), header.size() * sizeof(uint64_t) ) ;
+#else
+    AppendRaw(data, nBytes) ;
+#endif
+}
+
+//---------------------------------------------------------------------------------------------
+
+bool VtkXmlFile::Write(const string & fileName, const string & dataSet, const string & datasetAttributes, const string & body) const
+{
+    uint16_t one = 1 ;
+    bool littleEndian = *reinterpret_cast<const uint8_t *>(&one) == 1 ;
+    ostringstream head ;
+    head << "<?xml version=\"1.0\"?>\n" ;
+    head << "<VTKFile type=\"" << dataSet << "\" version=\"1.0\" byte_order=\"" << (littleEndian ? "LittleEndian" : "BigEndian")
+         << "\" header_type=\"UInt64\"" ;
+    if (compress)
+    {
+        head << " compressor=\"vtkZLibDataCompressor\"" ;
+    }
+    head << ">\n<" << dataSet << " " << datasetAttributes << ">\n" << body << "</" << dataSet << ">\n" ;
+    head << "<AppendedData encoding=\"raw\">\n_" ;
+    string tail = "\n</AppendedData>\n</VTKFile>\n" ;
+    string tmpHead = head.str() ;
+
+    ofstream out (fileName.c_str(), ios::binary) ;
+    if (!out)
+    {
+        cout<<"Could not open "<<fileName<<endl ;
+        return false ;
+    }
+    out.write(tmpHead.data(), tmpHead.size() ) ;
+    out.write(appended.data(), appended.size() ) ;
+    out.write(tail.data(), tail.size() ) ;
+    return out.good() ;
+}
+
+//---------------------------------------------------------------------------------------------
+
+const char PvdIndex::tail[] = "</Collection>\n</VTKFile>\n" ;
+
+PvdIndex::PvdIndex ()
+{
+}
+PvdIndex::PvdIndex (const PvdIndex & other) : fileName(other.fileName), nFrames(other.nFrames)
+{
+}
+PvdIndex & PvdIndex::operator= (const PvdIndex & other)
+{
+    if (this != &other)
+    {
+        pvd.close() ;
+        fileName = other.fileName ;
+        nFrames = other.nFrames ;
+    }
+    return *this ;
+}
+
+//---------------------------------------------------------------------------------------------
+
+void PvdIndex::Add(double time, const string & frameFile)
+{
+    size_t slash = frameFile.find_last_of('/') ;
+    if (pvd.is_open() == false && nFrames == 0)
+    {
+        pvd.open(fileName.c_str(), ios::in | ios::out | ios::trunc) ;
+        pvd << "<?xml version=\"1.0\"?>\n" ;
+        pvd << "<VTKFile type=\"Collection\" version=\"0.1\">\n<Collection>\n" ;
+    }
+    else
+    {
+        if (pvd.is_open() == false)
+        {
+            pvd.open(fileName.c_str(), ios::in | ios::out) ;
+        }
+        pvd.seekp(-static_cast<streamoff>(sizeof(tail) - 1), ios::end) ;
+    }
+    //the file is relative to the folder of the index
+    pvd << "<DataSet timestep=\"" << time << "\" part=\"0\" file=\"" ;
+    pvd << (slash == string::npos ? frameFile : frameFile.substr(slash + 1) ) << "\"/>\n" ;
+    pvd << tail ;
+    //a run that stops early still has a complete index
+    pvd.flush() ;
+    nFrames++ ;
+}
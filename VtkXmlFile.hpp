@@ -0,0 +1,55 @@
+#ifndef VtkXmlFile_hpp
+#define VtkXmlFile_hpp
+
+#include <vector>
+#include <string>
+#include <fstream>
+#include <cstdint>
+
+using namespace std ;
+
+//One VTK XML file ( .vtu, .vtr) with all arrays in a raw appended binary block, written with one write call.
+//Arrays are compressed with zlib when compress is set and the code is built with -DVTK_ZLIB ( and -lz).
+//Usage: add the arrays, build the XML body from the returned DataArray elements, then Write.
+class VtkXmlFile
+{
+public:
+    //---------------------------- Parameters and sub-classes ------------------------------
+    VtkXmlFile (bool tmpCompress) ;
+    bool compress = false ;
+    vector<char> appended ;
+    static const size_t blockSize = 65536 ;     //uncompressed bytes per zlib block
+
+    //---------------------------- Functions --------------------------------------------
+    //type is a VTK type name ( Float32, Int32, UInt8). Returns the DataArray element that points to the data
+    string DataArray (const string & type, const string & name, int nComponents, const void * data, size_t nBytes) ;
+    //dataSet is UnstructuredGrid or RectilinearGrid, datasetAttributes is e.g. WholeExtent="0 9 0 9 0 0"
+    bool Write (const string & fileName, const string & dataSet, const string & datasetAttributes, const string & body) const ;
+
+private:
+    void AppendRaw (const void * data, size_t nBytes) ;
+    void AppendCompressed (const void * data, size_t nBytes) ;
+};
+
+//ParaView time series of the frames of one output. It is rewritten after every frame, so it is valid if the run stops
+class PvdIndex
+{
+public:
+    //---------------------------- Parameters and sub-classes ------------------------------
+    PvdIndex () ;
+    //A copy has no stream of its own, it opens the file again at its first frame
+    PvdIndex (const PvdIndex & other) ;
+    PvdIndex & operator= (const PvdIndex & other) ;
+    string fileName ;
+    long nFrames = 0 ;
+
+    //---------------------------- Functions --------------------------------------------
+    //The file stays open, each frame is written over the closing tags and the tags are written again after it
+    void Add (double time, const string & frameFile) ;
+
+private:
+    fstream pvd ;
+    static const char tail[] ;
+};
+
+#endif /* VtkXmlFile_hpp */
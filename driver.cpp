@@ -3,6 +3,9 @@
 #include <fstream>
 #include <sstream>
 #include <vector>
+#include <algorithm>
+#include <cstring>
+#include <unordered_map>
 
 using namespace std;
 using constants::pi;
@@ -37,6 +40,7 @@ Fungi driver (Fungi fungi){
     }
     
     fungi.FindCenterPointConnection() ;
+    fungi.BuildAdjacency() ;
     //fungi.FindProductionNetwork() ;
 
     return fungi ;
@@ -146,88 +150,48 @@ Fungi Manual_FungalNetwork ( Fungi fungi)
 
 Fungi Load_FungalNetwork ( Fungi fungi)
 {
+    if (Read_FungalNetworkBinary(fungi, fungi.networkBinaryFile, fungi.networkFile) )
+    {
+        return fungi ;
+    }
     // open input file
-    
-    //std::ifstream inputFile("hyphal_coordinates40.888888888888886.txt");
-    std::ifstream inputFile("test2_t=36032.00_hyphal_coordinates_run0_Everywhere.txt");
-    //std::ifstream inputFile("test2_t=36032.00_hyphal_coordinates_run0_Tips.txt");
+    std::ifstream inputFile(fungi.networkFile.c_str());
+    if (!inputFile.is_open() )
+    {
+        throw SceException("Fungal network not found: " + fungi.networkFile, ConfigFileNotFound) ;
+    }
     
     // read each line of the file
     std::string line;
-    int hyphae_counter = 0;
     HyphaeSegment new_hy;
     while (std::getline(inputFile, line))
     {
-        // use stringstream to split line into doubles
-        std::stringstream ss(line);
-        std::string value;
+        double tmpCoord[4] = {0.0, 0.0, 0.0, 0.0} ;
+        const char * p = line.c_str() ;
+        char * end ;
         int token_counter = 0;
-        while (std::getline(ss, value, ','))
+        while (token_counter < 4)
         {
-            if (token_counter == 0)
-            {
-                new_hy.x1 = std::stod(value);
-                new_hy.x1 = (new_hy.x1) + fungi.initX;
-            }
-            else if (token_counter == 1)
-            {
-                new_hy.y1 = std::stod(value);
-                new_hy.y1 = (new_hy.y1) + fungi.initY ;
-            }
-            else if (token_counter == 2)
-            {
-                new_hy.x2 = std::stod(value);
-                new_hy.x2 = (new_hy.x2) + fungi.initX;
-            }
-            else if (token_counter == 3)
+            tmpCoord[token_counter] = strtod(p, &end) ;
+            if (end == p)
             {
-                new_hy.y2 = std::stod(value);
-                new_hy.y2 = (new_hy.y2) + fungi.initY;
+                break ;
             }
-            token_counter++;
+            token_counter++ ;
+            p = (*end == ',') ? end + 1 : end ;
         }
-            
-        if (hyphae_counter < 4)
+        if (token_counter == 0)
         {
-            new_hy.can_branch = true;                                            // The i^th segment can extend
-            new_hy.can_extend = true;                                            // The i^th segment can branch
-            new_hy.from_who = -1 ;
-            new_hy.extend_to = -1 ;
-            new_hy.branch_to = -1 ;
-            new_hy.hyphae_ID = hyphae_counter ;
-            fungi.hyphaeSegments.push_back( new_hy );
-        }
-        else
-        {
-            for (int k = 0; k < hyphae_counter; k++)
-            {
-                if (new_hy.x1 == fungi.hyphaeSegments[k].x2 && new_hy.y1 == fungi.hyphaeSegments[k].y2)
-                {
-                    new_hy.can_branch = true ;                                            // The i^th segment can extend
-                    new_hy.can_extend = true ;                                            // The i^th segment can branch
-                    new_hy.from_who = k ;
-                    new_hy.extend_to = -1 ;
-                    new_hy.branch_to = -1 ;
-                    new_hy.hyphae_ID = hyphae_counter ;
-                    fungi.hyphaeSegments[k].can_extend = false ;
-                    fungi.hyphaeSegments[k].extend_to = hyphae_counter ;
-                }
-                else if (std::abs(new_hy.x1 - (fungi.hyphaeSegments[k].x1 + fungi.hyphaeSegments[k].x2)/2.0)<.001 && std::abs(new_hy.y1 - (fungi.hyphaeSegments[k].y1 + fungi.hyphaeSegments[k].y2)/2.0) < .001)
-                {
-                    new_hy.can_branch = true ;                                            // The i^th segment can extend
-                    new_hy.can_extend = true ;                                            // The i^th segment can branch
-                    new_hy.from_who = k ;
-                    new_hy.extend_to = -1 ;
-                    new_hy.branch_to = -1 ;
-                    new_hy.hyphae_ID = hyphae_counter ;
-                    fungi.hyphaeSegments[k].can_branch = false ;
-                    fungi.hyphaeSegments[k].branch_to = hyphae_counter ;
-                }
-            }
-            fungi.hyphaeSegments.push_back( new_hy );
+            continue ;
         }
-        hyphae_counter ++;
+        new_hy.x1 = tmpCoord[0] + fungi.initX ;
+        new_hy.y1 = tmpCoord[1] + fungi.initY ;
+        new_hy.x2 = tmpCoord[2] + fungi.initX ;
+        new_hy.y2 = tmpCoord[3] + fungi.initY ;
+        fungi.hyphaeSegments.push_back( new_hy );
     }
+    Connect_FungalNetwork(fungi.hyphaeSegments) ;
+    Write_FungalNetworkBinary(fungi, fungi.networkBinaryFile) ;
 
     // close input file
     inputFile.close();
@@ -248,3 +212,212 @@ Fungi Load_FungalNetwork ( Fungi fungi)
 }
 //-----------------------------------------------------------------------------------------------------
 
+//The first four segments start the network. A later segment continues segment k if it starts at the end of k,
+//or branches from k if it starts at the middle of k ( within 0.001). Every matching k points to the new segment,
+//and the new segment keeps the last match as its parent, as in the pairwise search.
+void Connect_FungalNetwork(vector<HyphaeSegment> & segments)
+{
+    const double tolerance = 0.001 ;
+    auto cellKey = [tolerance](double x, double y)
+    {
+        uint64_t kx = static_cast<uint32_t>(static_cast<int32_t>(floor(x / tolerance) ) ) ;
+        uint64_t ky = static_cast<uint32_t>(static_cast<int32_t>(floor(y / tolerance) ) ) ;
+        return (kx << 32) | ky ;
+    } ;
+    unordered_map<uint64_t, vector<int> > endCells ;
+    unordered_map<uint64_t, vector<int> > middleCells ;
+    endCells.reserve(segments.size() ) ;
+    middleCells.reserve(segments.size() ) ;
+    vector<int> candidates ;
+
+    for (int n = 0; n < static_cast<int>(segments.size() ); n++)
+    {
+        HyphaeSegment & new_hy = segments[n] ;
+        new_hy.can_branch = true ;
+        new_hy.can_extend = true ;
+        new_hy.from_who = -1 ;
+        new_hy.extend_to = -1 ;
+        new_hy.branch_to = -1 ;
+        new_hy.hyphae_ID = n ;
+        if (n >= 4)
+        {
+            //Exact end points fall in the same cell, middles may be in a neighboring cell
+            candidates.clear() ;
+            auto endIt = endCells.find(cellKey(new_hy.x1, new_hy.y1) ) ;
+            if (endIt != endCells.end() )
+            {
+                candidates.insert(candidates.end(), endIt->second.begin(), endIt->second.end() ) ;
+            }
+            double cx = floor(new_hy.x1 / tolerance) ;
+            double cy = floor(new_hy.y1 / tolerance) ;
+            for (int dx = -1; dx <= 1; dx++)
+            {
+                for (int dy = -1; dy <= 1; dy++)
+                {
+                    auto middleIt = middleCells.find(cellKey( (cx + dx + 0.5) * tolerance, (cy + dy + 0.5) * tolerance) ) ;
+                    if (middleIt != middleCells.end() )
+                    {
+                        candidates.insert(candidates.end(), middleIt->second.begin(), middleIt->second.end() ) ;
+                    }
+                }
+            }
+            sort(candidates.begin(), candidates.end() ) ;
+            candidates.erase(unique(candidates.begin(), candidates.end() ), candidates.end() ) ;
+            for (int k : candidates)
+            {
+                if (new_hy.x1 == segments[k].x2 && new_hy.y1 == segments[k].y2)
+                {
+                    new_hy.from_who = k ;
+                    segments[k].can_extend = false ;
+                    segments[k].extend_to = n ;
+                }
+                else if (std::abs(new_hy.x1 - (segments[k].x1 + segments[k].x2)/2.0) < tolerance && std::abs(new_hy.y1 - (segments[k].y1 + segments[k].y2)/2.0) < tolerance)
+                {
+                    new_hy.from_who = k ;
+                    segments[k].can_branch = false ;
+                    segments[k].branch_to = n ;
+                }
+            }
+        }
+        endCells[cellKey(new_hy.x2, new_hy.y2)].push_back(n) ;
+        middleCells[cellKey( (new_hy.x1 + new_hy.x2) / 2.0, (new_hy.y1 + new_hy.y2) / 2.0)].push_back(n) ;
+    }
+}
+//-----------------------------------------------------------------------------------------------------
+
+static const char fungalNetworkMagic[8] = {'H','Y','P','H','N','E','T','2'} ;
+static const char fungalNetworkMagicV1[8] = {'H','Y','P','H','N','E','T','1'} ;
+
+//Size and FNV-1a hash of the text network the binary was made from
+struct FungalNetworkSource
+{
+    uint64_t bytes ;
+    uint64_t hash ;
+};
+
+static bool FungalNetworkStamp(const string & fileName, FungalNetworkSource & source)
+{
+    std::ifstream inputFile(fileName.c_str(), ios::binary) ;
+    if (!inputFile.is_open() )
+    {
+        return false ;
+    }
+    source.bytes = 0 ;
+    source.hash = 14695981039346656037ull ;
+    vector<char> buffer(1 << 16) ;
+    while (inputFile.read(buffer.data(), buffer.size() ) || inputFile.gcount() > 0)
+    {
+        size_t n = static_cast<size_t>(inputFile.gcount() ) ;
+        for (size_t k = 0; k < n; k++)
+        {
+            source.hash = (source.hash ^ static_cast<unsigned char>(buffer[k]) ) * 1099511628211ull ;
+        }
+        source.bytes += n ;
+    }
+    return true ;
+}
+
+struct FungalNetworkRecord
+{
+    double x1 ;
+    double y1 ;
+    double x2 ;
+    double y2 ;
+    int32_t from_who ;
+    int32_t extend_to ;
+    int32_t branch_to ;
+    int32_t hyphae_ID ;
+    uint8_t can_branch ;
+    uint8_t can_extend ;
+    uint8_t padding[6] ;
+};
+
+bool Read_FungalNetworkBinary(Fungi & fungi, const string & fileName, const string & sourceFile)
+{
+    std::ifstream inputFile(fileName.c_str(), ios::binary) ;
+    if (!inputFile.is_open() )
+    {
+        return false ;
+    }
+    char magic[8] ;
+    uint64_t nSegments = 0 ;
+    FungalNetworkSource stored ;
+    inputFile.read(magic, sizeof(magic) ) ;
+    if (inputFile && memcmp(magic, fungalNetworkMagicV1, sizeof(magic) ) == 0)
+    {
+        cout<<"Rebuilding "<<fileName<<", it does not record its text network"<<endl ;
+        return false ;
+    }
+    inputFile.read(reinterpret_cast<char *>(&nSegments), sizeof(nSegments) ) ;
+    inputFile.read(reinterpret_cast<char *>(&stored), sizeof(stored) ) ;
+    if (!inputFile || memcmp(magic, fungalNetworkMagic, sizeof(magic) ) != 0)
+    {
+        throw SceException("Not a binary fungal network: " + fileName, ConfigValueException) ;
+    }
+    //A binary made from another version of the text network is rebuilt. Without the text file the binary is used as is
+    FungalNetworkSource source ;
+    if (FungalNetworkStamp(sourceFile, source) && (source.bytes != stored.bytes || source.hash != stored.hash) )
+    {
+        cout<<"Rebuilding "<<fileName<<", "<<sourceFile<<" has changed"<<endl ;
+        return false ;
+    }
+    vector<FungalNetworkRecord> records(nSegments) ;
+    inputFile.read(reinterpret_cast<char *>(records.data() ), nSegments * sizeof(FungalNetworkRecord) ) ;
+    if (!inputFile)
+    {
+        throw SceException("Truncated binary fungal network: " + fileName, ConfigValueException) ;
+    }
+    HyphaeSegment new_hy ;
+    fungi.hyphaeSegments.reserve(fungi.hyphaeSegments.size() + nSegments) ;
+    for (const FungalNetworkRecord & record : records)
+    {
+        new_hy.x1 = record.x1 + fungi.initX ;
+        new_hy.y1 = record.y1 + fungi.initY ;
+        new_hy.x2 = record.x2 + fungi.initX ;
+        new_hy.y2 = record.y2 + fungi.initY ;
+        new_hy.from_who = record.from_who ;
+        new_hy.extend_to = record.extend_to ;
+        new_hy.branch_to = record.branch_to ;
+        new_hy.hyphae_ID = record.hyphae_ID ;
+        new_hy.can_branch = record.can_branch != 0 ;
+        new_hy.can_extend = record.can_extend != 0 ;
+        fungi.hyphaeSegments.push_back(new_hy) ;
+    }
+    cout<<"Loaded "<<nSegments<<" hyphae segments from "<<fileName<<endl ;
+    return true ;
+}
+//-----------------------------------------------------------------------------------------------------
+
+void Write_FungalNetworkBinary(const Fungi & fungi, const string & fileName)
+{
+    std::ofstream outputFile(fileName.c_str(), ios::binary) ;
+    if (!outputFile.is_open() )
+    {
+        cout<<"Could not write the binary fungal network "<<fileName<<endl ;
+        return ;
+    }
+    vector<FungalNetworkRecord> records(fungi.hyphaeSegments.size() ) ;
+    for (size_t k = 0; k < records.size(); k++)
+    {
+        const HyphaeSegment & hy = fungi.hyphaeSegments[k] ;
+        FungalNetworkRecord & record = records[k] ;
+        memset(&record, 0, sizeof(record) ) ;
+        record.x1 = hy.x1 - fungi.initX ;
+        record.y1 = hy.y1 - fungi.initY ;
+        record.x2 = hy.x2 - fungi.initX ;
+        record.y2 = hy.y2 - fungi.initY ;
+        record.from_who = hy.from_who ;
+        record.extend_to = hy.extend_to ;
+        record.branch_to = hy.branch_to ;
+        record.hyphae_ID = hy.hyphae_ID ;
+        record.can_branch = hy.can_branch ;
+        record.can_extend = hy.can_extend ;
+    }
+    uint64_t nSegments = records.size() ;
+    FungalNetworkSource source = {0, 0} ;
+    FungalNetworkStamp(fungi.networkFile, source) ;
+    outputFile.write(fungalNetworkMagic, sizeof(fungalNetworkMagic) ) ;
+    outputFile.write(reinterpret_cast<const char *>(&nSegments), sizeof(nSegments) ) ;
+    outputFile.write(reinterpret_cast<const char *>(&source), sizeof(source) ) ;
+    outputFile.write(reinterpret_cast<const char *>(records.data() ), records.size() * sizeof(FungalNetworkRecord) ) ;
+}
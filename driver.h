@@ -18,6 +18,12 @@ Fungi Manual_FungalNetwork ( Fungi fungi) ;    //This is just a template. Modify
 //Load the fungal network based on coordinates of hyphae segments.
 //The coordinates are found from simulating the fungal growth
 Fungi Load_FungalNetwork ( Fungi fungi) ;
+//Parent of every segment through hash maps of the segment ends and middles, same rules as the pairwise search
+void Connect_FungalNetwork (vector<HyphaeSegment> & segments) ;
+//Segments and connections, coordinates relative to the center of the network, and the size and hash of the text
+//network they were made from. Returns false if the file does not exist or sourceFile is not the one it was made from
+bool Read_FungalNetworkBinary (Fungi & fungi, const string & fileName, const string & sourceFile) ;
+void Write_FungalNetworkBinary (const Fungi & fungi, const string & fileName) ;
 
 
 #endif /* driver_h */
@@ -34,7 +34,9 @@ int main (int argc, char* argv[])
    tissueBacteria.UpdateTissue_FromConfigFile() ;
    Fungi fungi;
   
-   srand(time (0)) ;
+   fungi.rng = tissueBacteria.rng ;
+   //rand() is only left to the network generator
+   srand(static_cast<unsigned int>(tissueBacteria.rng.runSeed) ) ;
    cout<<"Search area for slime is "<<tissueBacteria.searchAreaForSlime<<endl ;
     
     //-----------------------------Auto Saving Scripts -----------------------------------------------
@@ -62,11 +64,12 @@ int main (int argc, char* argv[])
     FrequencyOfVisit.open(tissueBacteria.statsFolder +"FrequncyOfVisit.txt") ;
     ofstream strSwitchP (tissueBacteria.statsFolder +"SwitchProbablities.txt" ) ;
     ofstream trajectories ( tissueBacteria.statsFolder +"trajectories.txt") ;
+    tissueBacteria.Start_Output() ;
     
     cout<<"program is running"<<endl  ;
 
     //Print Header to SwitchProbabilities Data File 
-    for (int i=0; i<nbacteria; i++)
+    for (int i=0; i<nbacteria && tissueBacteria.switchLogMode == switchLog_perBacteria; i++)
     {
     ofstream strSwitchP2;
     strSwitchP2.open(tissueBacteria.statsFolder + "WriteSwitchProbabilities_Bacteria" + to_string(i) + ".txt", ios::app);
@@ -99,6 +102,15 @@ int main (int argc, char* argv[])
     inverseDt = inverseDt/ tissueBacteria.updatingFrequency ;
    
    //--------------------------- Initializations -----------------------------------------------------
+    tissueBacteria.InitializeMatrix() ;
+    fungi = driver(fungi) ;
+    vector<HyphaeSegment> hyphaeSegments_main = fungi.hyphaeSegments ;
+    
+    //Bacteria would try to follow hyphae as a highway
+    tissueBacteria.sourceAlongHyphae = false ;
+    //The network is traced first, so the bacteria can start along it
+    tissueBacteria.Find_FungalNetworkTrace2(fungi) ;
+    
     tissueBacteria.Bacteria_Initialization() ;
     tissueBacteria.Update_LJ_NodePositions() ;
     tissueBacteria.Initialize_BacteriaProteinLevel() ;
@@ -106,15 +118,7 @@ int main (int argc, char* argv[])
     tissueBacteria.Update_BacteriaMaxDuration() ;
     tissueBacteria.Initialize_ReversalTimes() ;
     tissueBacteria.Initialize_Pili () ;
-    tissueBacteria.InitializeMatrix() ;
     tissueBacteria.Initialze_AllRandomForce() ;
-
-    fungi = driver(fungi) ;
-    vector<HyphaeSegment> hyphaeSegments_main = fungi.hyphaeSegments ;
-    
-    //Bacteria would try to follow hyphae as a highway
-    tissueBacteria.sourceAlongHyphae = false ;
-    tissueBacteria.Find_FungalNetworkTrace2(fungi) ;
    
    //--------------------------- Chemical diffusion setup -----------------------------------------------------
    
@@ -126,7 +130,8 @@ int main (int argc, char* argv[])
    //Solve diffusion equation using Euler method
    tissueBacteria.chemoProfile = tissueBacteria.TB_Cal_ChemoDiffusion2D(0.0, tissueBacteria.domainx, 0.0, tissueBacteria.domainy ,tissueBacteria.tGrids.numberGridsX , tissueBacteria.tGrids.numberGridsY ,pointSources, tissueBacteria.sourceProduction, tissueBacteria.tGrids.chemo_profile_type ) ;
    //Save source locations in bacteria class. Used to check if the bacteria is within a source region or not
-   tissueBacteria.Pass_PointSources_To_Bacteria(pointSources) ;
+   //sourceChemo holds the same sources and is kept up to date when the network grows
+   tissueBacteria.Pass_PointSources_To_Bacteria(tissueBacteria.sourceChemo) ;
     
     // Change damping coefficient based on the level of liquid/slime in the underlying grid
     tissueBacteria.Update_ViscousDampingCoeff ();
@@ -165,7 +170,10 @@ int main (int argc, char* argv[])
             tissueBacteria.Cal_AllLinearSpring_Forces () ;
             tissueBacteria.Cal_AllBendingSpring_Forces() ;
             tissueBacteria.Cal_AllBacteriaLJ_Forces() ;
-            //tissueBacteria.TermalFluctiation_Forces() ;
+            if (tissueBacteria.thermalNoise)
+            {
+                tissueBacteria.TermalFluctiation_Forces() ;
+            }
             tissueBacteria.Cal_MotorForce () ;
             tissueBacteria.Handle_BacteriaTurnOrientation() ;
             //  tissueBacteria.SlimeTrace() ;
@@ -174,22 +182,23 @@ int main (int argc, char* argv[])
             //  tissueBacteria.PiliForce() ;
             
             
-            if (l%1000==0 && l%inverseDt!=0 && tissueBacteria.chemotacticMechanism == metabolism)
+            //The metabolism model advances .01 per 1000 main steps
+            if (l%tissueBacteria.metabolismUpdateSteps==0 && l%inverseDt!=0 && tissueBacteria.chemotacticMechanism == metabolism)
             {
-               cout<<(l-initialNt)/inverseDt<<endl ;
+               if (l%1000==0)
+               {
+                   cout<<(l-initialNt)/inverseDt<<endl ;
+               }
                //tissueBacteria.UpdateReversalFrequency() ;       // test Effect of chemoattacrant on reversal motion
-               tissueBacteria.Update_MotilityMetabolism_Only(.01) ;
+               tissueBacteria.Update_MotilityMetabolism_Only(.01 * tissueBacteria.metabolismUpdateSteps / 1000.0) ;
             }
             //Write the outputs and call chemotaxis related functions
             else if  (l%inverseDt==0)
             {
                //tissueBacteria.Update_SurfaceCoverage(ProteinLevelFile, FrequencyOfVisit) ; //This would slow down the code bc of high number of grids
                 tissueBacteria.ParaView_Liquid() ;
-               tissueBacteria.BacterialVisualization_ParaView ()  ;
-               tissueBacteria.WriteTrajectoryFile() ;
+               tissueBacteria.Output_Frame() ;
                cout<<(l-initialNt)/inverseDt<<endl ;
-               tissueBacteria.WriteBacteria_AllStats() ;
-               tissueBacteria.WriteSwitchProbabilitiesByBacteria();
                
                 //    cout << coveragePercentage <<endl ;
                
@@ -197,13 +206,25 @@ int main (int argc, char* argv[])
                tissueBacteria.UpdateReversalFrequency() ;       // test Effect of chemoattacrant on reversal motion
                tissueBacteria.Update_MotilityMetabolism(.01) ;
                
+               if (fungi.growing)
+               {
+                   vector<int> newSegments ;
+                   vector<int> gainedTips ;
+                   vector<int> lostTips ;
+                   fungi.Grow_Network(inverseDt * tissueBacteria.dt, newSegments, gainedTips, lostTips) ;
+                   tissueBacteria.Add_FungalSegments(fungi, newSegments, gainedTips, lostTips) ;
+               }
             }
             tissueBacteria.PositionUpdating(tissueBacteria.dt) ;
+            tissueBacteria.Output_TrackedStep() ;
+            tissueBacteria.Update_Analytics() ;
+            tissueBacteria.Update_CoarseField() ;
         }
         
     }
     
    tissueBacteria.WriteNumberReverse() ;
+   tissueBacteria.Stop_Output() ;
    std::chrono::high_resolution_clock::time_point stop = std::chrono::high_resolution_clock::now();
    std::chrono::seconds duration = std::chrono::duration_cast<std::chrono::seconds>(stop - start);
    cout << "Time to simulate "<<nbacteria<<" bacteria is : " << duration.count() << " seconds" << endl;
@@ -0,0 +1,481 @@
+//Offline analysis of the simulator output. Streams over the files of one run, <prefix> = <StatFolderName><AnimationName>:
+//  <prefix>Trajectory.traj       mean squared displacement, density map and, with --source, the first arrival times
+//  <prefix>Stats.frames          mean velocity, modes, reversals and time to / in source of every frame
+//  <prefix>MotilityEvents.bin    turn angle, reversal interval, run, wrap and turn duration histograms
+//Every file is optional. The event log is read by its own thread while the other two files are split over the
+//bacteria between --threads threads. Only a window of maxLag + batch frames of positions is held in memory.
+//The file layouts come from the simulator headers ( TrajectoryCodec.hpp, FrameStore.hpp, BacteriaOutputColumns.hpp,
+//MotilityEventLog.hpp), so the tool reads what the simulator writes. Built on its own:
+//  g++ -std=c++17 -O2 -pthread -I.. -I<common headers> MotilityAnalysis.cpp ../TrajectoryCodec.cpp ../FrameStore.cpp
+//      ../MotilityAnalytics.cpp -o MotilityAnalysis
+//Usage: MotilityAnalysis [--threads n] [--maxlag frames] [--grid nx ny] [--domain x y] [--source x y radius] prefix
+//The results are written next to the inputs, <prefix>Analysis_*.txt
+
+#include "TrajectoryCodec.hpp"
+#include "FrameStore.hpp"
+#include "BacteriaOutputColumns.hpp"
+#include "MotilityEventLog.hpp"
+#include "MotilityAnalytics.hpp"
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <thread>
+
+struct AnalysisOptions
+{
+    string prefix ;
+    int nThreads = 1 ;
+    int maxLag = 64 ;               //frames
+    int batch = 32 ;                //frames decoded before the threads run over them
+    int gridX = 100 ;
+    int gridY = 100 ;
+    double domainX = 1000.0 ;
+    double domainY = 1000.0 ;
+    bool source = false ;
+    double sourceX = 0.0 ;
+    double sourceY = 0.0 ;
+    double sourceRadius = 0.0 ;
+};
+
+//---------------------------------------------------------------------------------------------
+//body(first, last, thread) on nThreads contiguous ranges of [0, n)
+static void ParallelRanges(long n, int nThreads, const function<void(long, long, int)> & body)
+{
+    if (nThreads <= 1 || n < nThreads)
+    {
+        body(0, n, 0) ;
+        return ;
+    }
+    vector<thread> workers ;
+    for (int t = 0; t < nThreads; t++)
+    {
+        workers.emplace_back(body, n * t / nThreads, n * (t + 1) / nThreads, t) ;
+    }
+    for (thread & worker : workers)
+    {
+        worker.join() ;
+    }
+}
+
+//---------------------------------------------------------------------------------------------
+
+static void Analyze_Trajectory(const AnalysisOptions & options)
+{
+    TrajectoryDecoder decoder ;
+    if (decoder.Open(options.prefix + "Trajectory.traj") == false)
+    {
+        cout<<"No "<<options.prefix<<"Trajectory.traj, skipping the MSD and density map"<<endl ;
+        return ;
+    }
+    if (decoder.header.nComponents != 2)
+    {
+        cout<<"Trajectory.traj does not hold x, y center positions"<<endl ;
+        return ;
+    }
+    long nBacteria = static_cast<long>(decoder.header.nPoints) ;
+    long nFrames = decoder.NumberFrames() ;
+    int nThreads = options.nThreads ;
+    int maxLag = options.maxLag ;
+    long windowFrames = maxLag + options.batch ;
+    int nGrids = options.gridX * options.gridY ;
+
+    //frames k of the window at slot k % windowFrames
+    vector<double> window (windowFrames * nBacteria * 2) ;
+    vector<vector<double> > msdSum (nThreads, vector<double>(maxLag + 1, 0.0) ) ;
+    vector<vector<long> > msdCount (nThreads, vector<long>(maxLag + 1, 0) ) ;
+    vector<vector<long> > density (nThreads, vector<long>(nGrids, 0) ) ;
+    vector<double> arrival (nBacteria, -1.0) ;
+    vector<long> arrivedByFrame (nFrames, 0) ;
+    vector<vector<long> > arrivedNow (nThreads) ;
+    double radius2 = options.sourceRadius * options.sourceRadius ;
+
+    vector<double> values ;
+    for (long k0 = 0; k0 < nFrames; k0 += options.batch)
+    {
+        long k1 = min(k0 + options.batch, nFrames) ;
+        for (long k = k0; k < k1; k++)
+        {
+            decoder.Read(k, values) ;
+            copy(values.begin(), values.end(), window.begin() + (k % windowFrames) * nBacteria * 2) ;
+        }
+        ParallelRanges(nBacteria, nThreads, [&](long first, long last, int t)
+        {
+            arrivedNow[t].assign(k1 - k0, 0) ;
+            for (long k = k0; k < k1; k++)
+            {
+                const double * now = &window[(k % windowFrames) * nBacteria * 2] ;
+                for (int lag = 1; lag <= min(static_cast<long>(maxLag), k); lag++)
+                {
+                    const double * before = &window[( (k - lag) % windowFrames) * nBacteria * 2] ;
+                    double sum = 0.0 ;
+                    for (long i = first; i < last; i++)
+                    {
+                        double dx = now[2 * i] - before[2 * i] ;
+                        double dy = now[2 * i + 1] - before[2 * i + 1] ;
+                        sum += dx * dx + dy * dy ;
+                    }
+                    msdSum[t][lag] += sum ;
+                    msdCount[t][lag] += last - first ;
+                }
+                for (long i = first; i < last; i++)
+                {
+                    //positions are not wrapped by the simulator, the map is periodic
+                    double x = fmod(fmod(now[2 * i], options.domainX) + options.domainX, options.domainX) ;
+                    double y = fmod(fmod(now[2 * i + 1], options.domainY) + options.domainY, options.domainY) ;
+                    int m = min(static_cast<int>(x / options.domainX * options.gridX), options.gridX - 1) ;
+                    int n = min(static_cast<int>(y / options.domainY * options.gridY), options.gridY - 1) ;
+                    density[t][n * options.gridX + m]++ ;
+                    if (options.source && arrival[i] < 0.0)
+                    {
+                        //nearest periodic image of the source, like the density map
+                        double dx = now[2 * i] - options.sourceX ;
+                        double dy = now[2 * i + 1] - options.sourceY ;
+                        dx -= options.domainX * round(dx / options.domainX) ;
+                        dy -= options.domainY * round(dy / options.domainY) ;
+                        if (dx * dx + dy * dy <= radius2)
+                        {
+                            arrival[i] = decoder.Frame(k).time - decoder.Frame(0).time ;
+                            arrivedNow[t][k - k0]++ ;
+                        }
+                    }
+                }
+            }
+        }) ;
+        for (int t = 0; t < nThreads && options.source; t++)
+        {
+            for (long k = k0; k < k1 && k - k0 < static_cast<long>(arrivedNow[t].size() ); k++)
+            {
+                arrivedByFrame[k] += arrivedNow[t][k - k0] ;
+            }
+        }
+    }
+    //the lags are in frames, the time of a lag uses the mean frame interval
+    double frameInterval = nFrames > 1 ? (decoder.Frame(nFrames - 1).time - decoder.Frame(0).time) / (nFrames - 1) : 0.0 ;
+
+    ofstream strMSD ( (options.prefix + "Analysis_MSD.txt").c_str() ) ;
+    strMSD<<setprecision(10) ;
+    strMSD<<"#lagFrames\tlag\tMSD\tsamples"<<endl ;
+    for (int lag = 1; lag <= maxLag; lag++)
+    {
+        double sum = 0.0 ;
+        long count = 0 ;
+        for (int t = 0; t < nThreads; t++)
+        {
+            sum += msdSum[t][lag] ;
+            count += msdCount[t][lag] ;
+        }
+        if (count > 0)
+        {
+            strMSD<<lag<<'\t'<<lag * frameInterval<<'\t'<<sum / count<<'\t'<<count<<endl ;
+        }
+    }
+
+    //mean number of bacteria of every grid over the frames, a row per y
+    ofstream strDensity ( (options.prefix + "Analysis_Density.txt").c_str() ) ;
+    strDensity<<setprecision(6) ;
+    strDensity<<"#"<<options.gridX<<" x "<<options.gridY<<" grids over "<<options.domainX<<" x "<<options.domainY
+              <<", mean bacteria per grid over "<<nFrames<<" frames"<<endl ;
+    for (int n = 0; n < options.gridY; n++)
+    {
+        for (int m = 0; m < options.gridX; m++)
+        {
+            long count = 0 ;
+            for (int t = 0; t < nThreads; t++)
+            {
+                count += density[t][n * options.gridX + m] ;
+            }
+            strDensity<<(nFrames > 0 ? static_cast<double>(count) / nFrames : 0.0)<<(m + 1 < options.gridX ? '\t' : '\n') ;
+        }
+    }
+
+    if (options.source)
+    {
+        LogHistogram firstArrival ;
+        firstArrival.Resize("first arrival time", 1.0e-3, 7, 10) ;
+        for (long i = 0; i < nBacteria; i++)
+        {
+            if (arrival[i] >= 0.0)
+            {
+                firstArrival.Add(arrival[i]) ;
+            }
+        }
+        ofstream strSource ( (options.prefix + "Analysis_FirstArrival.txt").c_str() ) ;
+        strSource<<setprecision(10) ;
+        strSource<<"#source "<<options.sourceX<<" "<<options.sourceY<<" radius "<<options.sourceRadius<<", "
+                 <<firstArrival.n<<" of "<<nBacteria<<" bacteria arrived"<<endl ;
+        firstArrival.Write(strSource) ;
+        strSource<<"#time\tfractionArrived"<<endl ;
+        long arrived = 0 ;
+        for (long k = 0; k < nFrames; k++)
+        {
+            arrived += arrivedByFrame[k] ;
+            strSource<<decoder.Frame(k).time<<'\t'<<static_cast<double>(arrived) / nBacteria<<endl ;
+        }
+    }
+    cout<<"Trajectory: "<<nFrames<<" frames of "<<nBacteria<<" bacteria"<<endl ;
+}
+
+//---------------------------------------------------------------------------------------------
+
+static void Analyze_Stats(const AnalysisOptions & options)
+{
+    MappedFrameStore store ;
+    if (store.Open(options.prefix + "Stats.frames") == false)
+    {
+        cout<<"No "<<options.prefix<<"Stats.frames, skipping the frame statistics"<<endl ;
+        return ;
+    }
+    //the columns are looked up by the names the simulator writes them with
+    int column[numberStatsColumns] ;
+    for (int c = 0; c < numberStatsColumns; c++)
+    {
+        column[c] = store.Column(statsColumns[c].name) ;
+    }
+    if (column[stats_velocity] < 0 || column[stats_mode] < 0 || column[stats_numberReverse] < 0 ||
+        column[stats_timeToSource] < 0 || column[stats_timeInSource] < 0)
+    {
+        cout<<"Stats.frames is missing columns of BacteriaOutputColumns.hpp"<<endl ;
+        return ;
+    }
+    long nBacteria = store.NumberBacteria() ;
+    long nFrames = store.NumberFrames() ;
+    int nThreads = options.nThreads ;
+    //velocity, forward, wrap, turn, reversals, in source, time to source
+    const int nSums = 7 ;
+    vector<vector<double> > sums (nThreads, vector<double>(nSums) ) ;
+
+    ofstream strStats ( (options.prefix + "Analysis_Stats.txt").c_str() ) ;
+    strStats<<setprecision(10) ;
+    strStats<<"#frame\ttime\tmeanVelocity\tforward\twrap\tturn\tmeanReversals\tfractionInSource\tmeanTimeToSource"<<endl ;
+    for (long k = 0; k < nFrames; k++)
+    {
+        const double * velocity = store.Float64(column[stats_velocity], k) ;
+        const int32_t * mode = store.Int32(column[stats_mode], k) ;
+        const int32_t * numberReverse = store.Int32(column[stats_numberReverse], k) ;
+        const double * timeToSource = store.Float64(column[stats_timeToSource], k) ;
+        const double * timeInSource = store.Float64(column[stats_timeInSource], k) ;
+        ParallelRanges(nBacteria, nThreads, [&](long first, long last, int t)
+        {
+            vector<double> & sum = sums[t] ;
+            fill(sum.begin(), sum.end(), 0.0) ;
+            for (long i = first; i < last; i++)
+            {
+                sum[0] += velocity[i] ;
+                sum[1] += (mode[i] & 1) != 0 ;
+                sum[2] += (mode[i] & 2) != 0 ;
+                sum[3] += (mode[i] & 4) != 0 ;
+                sum[4] += numberReverse[i] ;
+                sum[5] += timeInSource[i] > 0.0 ;
+                sum[6] += timeToSource[i] ;
+            }
+        }) ;
+        vector<double> total (nSums, 0.0) ;
+        for (int t = 0; t < nThreads; t++)
+        {
+            for (int s = 0; s < nSums; s++)
+            {
+                total[s] += sums[t][s] ;
+            }
+        }
+        strStats<<store.Frame(k).frame<<'\t'<<store.Frame(k).time ;
+        for (int s = 0; s < nSums; s++)
+        {
+            strStats<<'\t'<<total[s] / max(nBacteria, 1L) ;
+        }
+        strStats<<endl ;
+    }
+    cout<<"Stats: "<<nFrames<<" frames of "<<nBacteria<<" bacteria"<<endl ;
+}
+
+//---------------------------------------------------------------------------------------------
+
+static void Analyze_Events(const AnalysisOptions & options)
+{
+    string fileName = options.prefix + "MotilityEvents.bin" ;
+    FILE * file = fopen(fileName.c_str(), "rb") ;
+    if (file == nullptr)
+    {
+        cout<<"No "<<fileName<<", skipping the event histograms"<<endl ;
+        return ;
+    }
+    MotilityLogHeader header ;
+    if (fread(&header, sizeof(header), 1, file) != 1 || strncmp(header.magic, "MOTILLOG", sizeof(header.magic) ) != 0 ||
+        header.recordBytes != sizeof(MotilityLogRecord) )
+    {
+        fclose(file) ;
+        cout<<fileName<<" is not a motility event log of this version"<<endl ;
+        return ;
+    }
+    LogHistogram turnAngle, wrapAngle, reversalInterval, run, wrap, turn ;
+    turnAngle.Resize("turn angle", 1.0e-6, 7, 10) ;
+    wrapAngle.Resize("wrap angle", 1.0e-6, 7, 10) ;
+    reversalInterval.Resize("reversal interval", 1.0e-5, 8, 10) ;
+    run.Resize("run duration", 1.0e-5, 8, 10) ;
+    wrap.Resize("wrap duration", 1.0e-5, 8, 10) ;
+    turn.Resize("turn duration", 1.0e-5, 8, 10) ;
+    long nNegative = 0 ;
+    //the events of a bacterium are written in time order, the simulator handles them in one thread
+    vector<double> lastReversal ;
+    vector<double> runStart ;
+
+    vector<MotilityLogRecord> records (1 << 16) ;
+    long nRecords = 0 ;
+    size_t nRead ;
+    while ( (nRead = fread(records.data(), sizeof(MotilityLogRecord), records.size(), file) ) > 0)
+    {
+        for (size_t r = 0; r < nRead; r++)
+        {
+            const MotilityLogRecord & record = records[r] ;
+            size_t i = static_cast<size_t>(record.bacterium) ;
+            if (i >= lastReversal.size() )
+            {
+                lastReversal.resize(i + 1, -1.0) ;
+                runStart.resize(i + 1, -1.0) ;
+            }
+            if (record.type == motilityLog_reversal || record.type == motilityLog_wrapStart)
+            {
+                if (runStart[i] >= 0.0)
+                {
+                    run.Add(record.time - runStart[i]) ;
+                }
+                runStart[i] = record.type == motilityLog_reversal ? record.time : -1.0 ;
+            }
+            if (record.type == motilityLog_reversal)
+            {
+                if (lastReversal[i] >= 0.0)
+                {
+                    reversalInterval.Add(record.time - lastReversal[i]) ;
+                }
+                lastReversal[i] = record.time ;
+                turnAngle.Add(fabs(record.angle) ) ;
+                nNegative += record.angle < 0.0 ;
+            }
+            else if (record.type == motilityLog_wrapStart)
+            {
+                wrapAngle.Add(fabs(record.angle) ) ;
+            }
+            else if (record.type == motilityLog_wrapEnd)
+            {
+                wrap.Add(record.duration) ;
+            }
+            else if (record.type == motilityLog_turnEnd)
+            {
+                turn.Add(record.duration) ;
+            }
+        }
+        nRecords += nRead ;
+    }
+    fclose(file) ;
+
+    ofstream strEvents ( (options.prefix + "Analysis_Events.txt").c_str() ) ;
+    strEvents<<setprecision(10) ;
+    strEvents<<"#"<<nRecords<<" events, "<<nNegative<<" of "<<turnAngle.n<<" turn angles negative"<<endl ;
+    turnAngle.Write(strEvents) ;
+    reversalInterval.Write(strEvents) ;
+    run.Write(strEvents) ;
+    wrap.Write(strEvents) ;
+    turn.Write(strEvents) ;
+    wrapAngle.Write(strEvents) ;
+    cout<<"Events: "<<nRecords<<" records"<<endl ;
+}
+
+//---------------------------------------------------------------------------------------------
+
+int main(int argc, char * argv[])
+{
+    AnalysisOptions options ;
+    options.nThreads = max(static_cast<int>(thread::hardware_concurrency() ), 1) ;
+    int a = 1 ;
+    for (; a < argc && strncmp(argv[a], "--", 2) == 0; a++)
+    {
+        string option = argv[a] ;
+        int nValues = option == "--grid" || option == "--domain" ? 2 : option == "--source" ? 3 : 1 ;
+        if (a + nValues >= argc)
+        {
+            break ;
+        }
+        if (option == "--threads")
+        {
+            options.nThreads = max(atoi(argv[a + 1]), 1) ;
+        }
+        else if (option == "--maxlag")
+        {
+            options.maxLag = max(atoi(argv[a + 1]), 1) ;
+        }
+        else if (option == "--grid")
+        {
+            options.gridX = max(atoi(argv[a + 1]), 1) ;
+            options.gridY = max(atoi(argv[a + 2]), 1) ;
+        }
+        else if (option == "--domain")
+        {
+            options.domainX = atof(argv[a + 1]) ;
+            options.domainY = atof(argv[a + 2]) ;
+        }
+        else if (option == "--source")
+        {
+            options.source = true ;
+            options.sourceX = atof(argv[a + 1]) ;
+            options.sourceY = atof(argv[a + 2]) ;
+            options.sourceRadius = atof(argv[a + 3]) ;
+        }
+        else
+        {
+            cout<<"Unknown option "<<option<<endl ;
+            return 1 ;
+        }
+        a += nValues ;
+    }
+    if (a != argc - 1)
+    {
+        cout<<"Usage: "<<argv[0]<<" [--threads n] [--maxlag frames] [--grid nx ny] [--domain x y]"
+            <<" [--source x y radius] prefix"<<endl ;
+        cout<<"       prefix is <StatFolderName><AnimationName> of the run"<<endl ;
+        return 1 ;
+    }
+    options.prefix = argv[a] ;
+
+    //the event log is read next to the frame files
+    exception_ptr eventError ;
+    thread events ([&]()
+    {
+        try
+        {
+            Analyze_Events(options) ;
+        }
+        catch (...)
+        {
+            eventError = current_exception() ;
+        }
+    }) ;
+    int status = 0 ;
+    try
+    {
+        Analyze_Stats(options) ;
+        Analyze_Trajectory(options) ;
+    }
+    catch (const exception & e)
+    {
+        cout<<e.what()<<endl ;
+        status = 1 ;
+    }
+    events.join() ;
+    if (eventError)
+    {
+        try
+        {
+            rethrow_exception(eventError) ;
+        }
+        catch (const exception & e)
+        {
+            cout<<e.what()<<endl ;
+            status = 1 ;
+        }
+    }
+    return status ;
+}
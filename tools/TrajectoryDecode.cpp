@@ -0,0 +1,80 @@
+//Prints the frames of a compressed trajectory ( TrajectoryCodec.hpp) as text, one point per line and a blank line
+//after every frame, the layout of trajectories.txt. Built on its own:
+//  g++ -std=c++17 -O2 -I.. -I<common headers> TrajectoryDecode.cpp ../TrajectoryCodec.cpp -o TrajectoryDecode
+//Usage: TrajectoryDecode file.traj [firstFrame [lastFrame]]
+//       TrajectoryDecode --info file.traj
+
+#include "TrajectoryCodec.hpp"
+#include <charconv>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+int main(int argc, char * argv[])
+{
+    bool info = argc > 1 && strcmp(argv[1], "--info") == 0 ;
+    int first = info ? 2 : 1 ;
+    if (argc <= first)
+    {
+        cout<<"Usage: "<<argv[0]<<" file.traj [firstFrame [lastFrame]]"<<endl ;
+        cout<<"       "<<argv[0]<<" --info file.traj"<<endl ;
+        return 1 ;
+    }
+    TrajectoryDecoder decoder ;
+    try
+    {
+        if (decoder.Open(argv[first]) == false)
+        {
+            cout<<"Could not open "<<argv[first]<<endl ;
+            return 1 ;
+        }
+    }
+    catch (const exception & e)
+    {
+        cout<<e.what()<<endl ;
+        return 1 ;
+    }
+    long nFrames = decoder.NumberFrames() ;
+    if (info)
+    {
+        uint64_t codedBytes = 0 ;
+        long nKeyframes = 0 ;
+        for (long k = 0; k < nFrames; k++)
+        {
+            codedBytes += decoder.Frame(k).payloadBytes + sizeof(TrajectoryFrameHeader) ;
+            nKeyframes += decoder.Frame(k).keyframe ;
+        }
+        uint64_t rawBytes = nFrames * decoder.NumberValues() * sizeof(double) ;
+        cout<<"points "<<decoder.header.nPoints<<", components "<<decoder.header.nComponents<<", quantum "
+            <<decoder.header.quantum<<endl ;
+        cout<<"frames "<<nFrames<<", keyframes "<<nKeyframes<<" ( every "<<decoder.header.keyframeInterval<<")"<<endl ;
+        if (nFrames > 0)
+        {
+            cout<<"time "<<decoder.Frame(0).time<<" to "<<decoder.Frame(nFrames - 1).time<<endl ;
+        }
+        cout<<"coded "<<codedBytes<<" bytes, float64 "<<rawBytes<<" bytes, ratio "
+            <<(codedBytes > 0 ? static_cast<double>(rawBytes) / codedBytes : 0.0)<<endl ;
+        return 0 ;
+    }
+    long firstFrame = argc > first + 1 ? atol(argv[first + 1]) : 0 ;
+    long lastFrame = argc > first + 2 ? atol(argv[first + 2]) : nFrames - 1 ;
+    lastFrame = min(lastFrame, nFrames - 1) ;
+
+    vector<double> values ;
+    vector<char> text ;
+    int nComponents = static_cast<int>(decoder.header.nComponents) ;
+    for (long k = max(firstFrame, 0L); k <= lastFrame; k++)
+    {
+        decoder.Read(k, values) ;
+        text.resize(values.size() * 26 + 64) ;
+        char * out = text.data() ;
+        for (size_t m = 0; m < values.size(); m++)
+        {
+            out = to_chars(out, out + 25, values[m]).ptr ;
+            *out++ = (m + 1) % nComponents == 0 ? '\n' : '\t' ;
+        }
+        *out++ = '\n' ;
+        fwrite(text.data(), 1, out - text.data(), stdout) ;
+    }
+    return 0 ;
+}